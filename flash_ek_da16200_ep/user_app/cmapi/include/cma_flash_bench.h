@@ -0,0 +1,76 @@
+/**
+ ****************************************************************************************
+ *
+ * @file cma_flash_bench.h
+ *
+ * @brief Micro-benchmark for the user flash functions.
+ *
+ * Copyright (c) 2016-2024 Renesas Electronics. All rights reserved.
+ *
+ * This software ("Software") is owned by Renesas Electronics.
+ *
+ * By using this Software you agree that Renesas Electronics retains all
+ * intellectual property and proprietary rights in and to this Software and any
+ * use, reproduction, disclosure or distribution of the Software without express
+ * written permission or a license agreement from Renesas Electronics is
+ * strictly prohibited. This Software is solely for use on or in conjunction
+ * with Renesas Electronics products.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE
+ * SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. EXCEPT AS OTHERWISE
+ * PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * RENESAS ELECTRONICS BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL,
+ * OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ *
+ ****************************************************************************************
+ */
+
+
+#ifndef CMA_FLASH_BENCH_H_
+
+#define CMA_FLASH_BENCH_H_
+
+#include "cma_flash.h"
+
+/* Latency histogram : bucket n counts samples in [2^n, 2^(n+1)) usec, bucket 0 is < 2 usec */
+#define CMA_FLASH_BENCH_HIST_BUCKETS    24
+
+typedef struct
+{
+    const char *name;
+    uint32_t size;
+    uint32_t iterations;
+    uint32_t failures;
+    uint32_t kbytes_per_sec;
+    uint32_t p50_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+    uint32_t erases;
+    uint16_t hist[CMA_FLASH_BENCH_HIST_BUCKETS];
+} cma_flash_bench_result_t;
+
+/**
+ ****************************************************************************************
+ * @brief Run flash micro-benchmark and print out results.
+ *
+ * Covers cold open (driver init and release from deep power down) and warm open,
+ * sequential and random read/write from 16 bytes to 64 KB
+ * with aligned and unaligned offsets, and erase-heavy patterns.
+ * Each case reports throughput, p50/p99/max latency, erase count and a latency histogram.
+ *
+ * Contents of the given area are destroyed. cma_flash_init is required before.
+ *
+ * @param[in] start address of area for test (sector aligned).
+ * @param[in] size of area for test (at least 64 KB + 1 sector).
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_flash_bench_run(uint32_t startAddress, uint32_t areaLength);
+
+#endif /* CMA_FLASH_BENCH_H_ */
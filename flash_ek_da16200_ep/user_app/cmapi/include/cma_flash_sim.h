@@ -0,0 +1,83 @@
+/**
+ ****************************************************************************************
+ *
+ * @file cma_flash_sim.h
+ *
+ * @brief Simulated SFLASH backend for host builds.
+ *
+ * Copyright (c) 2016-2024 Renesas Electronics. All rights reserved.
+ *
+ * This software ("Software") is owned by Renesas Electronics.
+ *
+ * By using this Software you agree that Renesas Electronics retains all
+ * intellectual property and proprietary rights in and to this Software and any
+ * use, reproduction, disclosure or distribution of the Software without express
+ * written permission or a license agreement from Renesas Electronics is
+ * strictly prohibited. This Software is solely for use on or in conjunction
+ * with Renesas Electronics products.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE
+ * SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. EXCEPT AS OTHERWISE
+ * PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * RENESAS ELECTRONICS BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL,
+ * OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ *
+ ****************************************************************************************
+ */
+
+
+#ifndef CMA_FLASH_SIM_H_
+
+#define CMA_FLASH_SIM_H_
+
+#include <stdint.h>
+
+/*
+ *****************************************************
+ * RAM backed replacement of cma_flash.c for host builds (-DCMA_FLASH_SIM).
+ * It keeps the cma_flash API and its sector read-modify-write semantic, and
+ * advances a virtual clock with typical SFLASH timings instead of real time.
+ ******************************************************
+ */
+
+/* Simulated area : same range as the user area of DA16200 (0x3be000 ~ 0x3ec000) */
+#define CMA_FLASH_SIM_BASE              0x3BE000
+#define CMA_FLASH_SIM_SIZE              0x2E000
+
+/* Typical timings of the serial flash (nsec) */
+#define CMA_FLASH_SIM_OPEN_NS           5000        /* bus setup */
+#define CMA_FLASH_SIM_PROBE_NS          60000       /* parameter read on the first open after init */
+#define CMA_FLASH_SIM_RELEASE_NS        30000       /* release from deep power down */
+#define CMA_FLASH_SIM_READ_BYTE_NS      50          /* 1-4-4 bus */
+#define CMA_FLASH_SIM_READ_CMD_NS       2000
+#define CMA_FLASH_SIM_PROG_PAGE_NS      400000      /* 256 bytes page program */
+#define CMA_FLASH_SIM_ERASE_SECTOR_NS   45000000    /* 4KB sector erase */
+
+/**
+ ****************************************************************************************
+ * @brief Fill simulated flash with 0xFF and clear virtual clock.
+ *
+ * @param[in] None.
+ *
+ * @return None.
+ ****************************************************************************************
+ */
+void cma_flash_sim_reset(void);
+
+/**
+ ****************************************************************************************
+ * @brief Get virtual time spent in simulated flash operations.
+ *
+ * @param[in] None.
+ *
+ * @return elapsed time(nanosecond).
+ ****************************************************************************************
+ */
+uint64_t cma_flash_sim_elapsed_ns(void);
+
+#endif /* CMA_FLASH_SIM_H_ */
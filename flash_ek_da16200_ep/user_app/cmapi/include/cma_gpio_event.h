@@ -0,0 +1,130 @@
+/**
+ ****************************************************************************************
+ *
+ * @file cma_gpio_event.h
+ *
+ * @brief Timestamped GPIO interrupt event queue.
+ *
+ * Copyright (c) 2016-2024 Renesas Electronics. All rights reserved.
+ *
+ * This software ("Software") is owned by Renesas Electronics.
+ *
+ * By using this Software you agree that Renesas Electronics retains all
+ * intellectual property and proprietary rights in and to this Software and any
+ * use, reproduction, disclosure or distribution of the Software without express
+ * written permission or a license agreement from Renesas Electronics is
+ * strictly prohibited. This Software is solely for use on or in conjunction
+ * with Renesas Electronics products.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE
+ * SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. EXCEPT AS OTHERWISE
+ * PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * RENESAS ELECTRONICS BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL,
+ * OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ *
+ ****************************************************************************************
+ */
+
+#ifndef CMA_GPIO_EVENT_H_
+
+#define CMA_GPIO_EVENT_H_
+
+#include "cma_gpio.h"
+
+/* Number of events in queue (power of 2) */
+#ifndef CMA_GPIO_EVENT_QUEUE_SIZE
+#define CMA_GPIO_EVENT_QUEUE_SIZE       64
+#endif
+
+/* Time base of events : DWT cycle counter, wraps after 2^32 cycles (35 s at 120 MHz) */
+#ifndef CMA_GPIO_EVENT_CPU_HZ
+#define CMA_GPIO_EVENT_CPU_HZ           120000000
+#endif
+
+#define CMA_GPIO_EVENT_TICKS_TO_US(ticks)   ((ticks) / (CMA_GPIO_EVENT_CPU_HZ / 1000000))
+
+/* Edge of a pin taken in interrupt */
+typedef struct
+{
+    uint32_t time;              /* DWT cycles */
+    uint8_t port;
+    uint8_t pin;
+    uint8_t level;              /* level read in interrupt, 1: high */
+    uint8_t reserved;
+} cma_gpio_event_t;
+
+/* Called in interrupt after an event is queued, e.g. to notify the consumer task */
+typedef void (*cma_gpio_event_notify_t)(void *arg);
+
+/**
+ ****************************************************************************************
+ * @brief Init event queue and start time base.
+ *
+ * @param[in] function called in interrupt for each event (can be NULL).
+ * @param[in] argument of notify function.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_gpio_event_init(cma_gpio_event_notify_t notify, void *arg);
+
+/**
+ ****************************************************************************************
+ * @brief Queue edges of a pin.
+ *
+ * The pin is set as input with interrupt, cma_gpio_set_func and pull are done by caller.
+ * With bothEdges, polarity is set in interrupt from the level read there, so press and
+ * release of a button are both queued. A change during the interrupt is queued as well.
+ *
+ * @param[in] Port number.
+ * @param[in] GPIO pin number.
+ * @param[in] CMA_INT_EDGE_ACTIVE_HIGH or CMA_INT_EDGE_ACTIVE_LOW (first edge).
+ * @param[in] 1 for both edges.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_gpio_event_add(CMA_GPIO_PORT_TYPE port, CMA_GPIO_PIN_TYPE pin, CMA_INT_TYPE int_type,
+                                   uint8_t bothEdges);
+
+/**
+ ****************************************************************************************
+ * @brief Stop queuing edges of a pin. Events already queued are kept.
+ *
+ * @param[in] Port number.
+ * @param[in] GPIO pin number.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_gpio_event_remove(CMA_GPIO_PORT_TYPE port, CMA_GPIO_PIN_TYPE pin);
+
+/**
+ ****************************************************************************************
+ * @brief Take queued events, oldest first. Only one task may read.
+ *
+ * @param[out] events.
+ * @param[in] maximum number of events.
+ *
+ * @return number of events.
+ ****************************************************************************************
+ */
+uint32_t cma_gpio_event_read(cma_gpio_event_t *events, uint32_t maxEvents);
+
+/**
+ ****************************************************************************************
+ * @brief Get number of events lost because the queue was full since last call.
+ *
+ * @param[in] None.
+ *
+ * @return number of events lost.
+ ****************************************************************************************
+ */
+uint32_t cma_gpio_event_dropped(void);
+
+#endif /* CMA_GPIO_EVENT_H_ */
@@ -0,0 +1,457 @@
+/**
+ ****************************************************************************************
+ *
+ * @file cma_flash_bench.c
+ *
+ * @brief Micro-benchmark for the user flash functions.
+ *
+ * Copyright (c) 2016-2024 Renesas Electronics. All rights reserved.
+ *
+ * This software ("Software") is owned by Renesas Electronics.
+ *
+ * By using this Software you agree that Renesas Electronics retains all
+ * intellectual property and proprietary rights in and to this Software and any
+ * use, reproduction, disclosure or distribution of the Software without express
+ * written permission or a license agreement from Renesas Electronics is
+ * strictly prohibited. This Software is solely for use on or in conjunction
+ * with Renesas Electronics products.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE
+ * SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. EXCEPT AS OTHERWISE
+ * PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * RENESAS ELECTRONICS BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL,
+ * OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ *
+ ****************************************************************************************
+ */
+
+
+#if defined(CMA_FLASH_SIM)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cma_flash_sim.h"
+
+#define OS_MALLOC(size) malloc(size)
+#define OS_FREE(addr) free(addr)
+#define LOG(level, ...) do { printf(__VA_ARGS__); printf("\n"); } while (0)
+#else
+#include "sdk_type.h"
+#include "da16x_system.h"
+#include "da16x_types.h"
+#include "cma_osal.h"
+#include "cma_debug.h"
+#endif
+#include "cma_flash_bench.h"
+
+#ifndef CMA_FLASH_BENCH_CPU_HZ
+#define CMA_FLASH_BENCH_CPU_HZ          120000000
+#endif
+
+#define CMA_FLASH_BENCH_SECTOR_SIZE     4096
+#define CMA_FLASH_BENCH_MIN_SIZE        16
+#define CMA_FLASH_BENCH_MAX_SIZE        (64 * 1024)
+#define CMA_FLASH_BENCH_UNALIGNED       3       /* breaks both word and sector alignment */
+#define CMA_FLASH_BENCH_BYTES_PER_CASE  (64 * 1024)
+#define CMA_FLASH_BENCH_MIN_ITERATIONS  4
+#define CMA_FLASH_BENCH_MAX_ITERATIONS  32
+#define CMA_FLASH_BENCH_OPEN_ITERATIONS 8
+#define CMA_FLASH_BENCH_SEED            0x2545F491
+
+typedef enum
+{
+    CMA_FLASH_BENCH_OP_READ,
+    CMA_FLASH_BENCH_OP_WRITE,
+    CMA_FLASH_BENCH_OP_ERASE
+} CMA_FLASH_BENCH_OP;
+
+typedef enum
+{
+    CMA_FLASH_BENCH_SEQUENTIAL,
+    CMA_FLASH_BENCH_RANDOM,
+    CMA_FLASH_BENCH_SCATTER     /* one op per sector, every op costs an erase on write */
+} CMA_FLASH_BENCH_PATTERN;
+
+struct cma_flash_bench_ctx_t
+{
+    void *handle;
+    uint8_t *buffer;
+    uint32_t buffer_size;
+    uint32_t start;
+    uint32_t length;
+    uint32_t seed;
+    uint32_t samples[CMA_FLASH_BENCH_MAX_ITERATIONS];
+};
+
+/*
+ *****************************************************
+ * Time base : DWT cycle counter on target, virtual clock of the simulated flash on host.
+ ******************************************************
+ */
+#if defined(CMA_FLASH_SIM)
+#define CMA_FLASH_BENCH_TICKS_PER_US    1
+
+static void cmai_flash_bench_timer_init(void)
+{
+}
+
+static uint32_t cmai_flash_bench_ticks(void)
+{
+    return (uint32_t) (cma_flash_sim_elapsed_ns () / 1000);
+}
+#else
+#define CMA_FLASH_BENCH_TICKS_PER_US    (CMA_FLASH_BENCH_CPU_HZ / 1000000)
+
+static void cmai_flash_bench_timer_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static uint32_t cmai_flash_bench_ticks(void)
+{
+    return DWT->CYCCNT;
+}
+#endif
+
+static uint32_t cmai_flash_bench_elapsed_us(uint32_t start_ticks)
+{
+    return (cmai_flash_bench_ticks () - start_ticks) / CMA_FLASH_BENCH_TICKS_PER_US;
+}
+
+static uint32_t cmai_flash_bench_random(struct cma_flash_bench_ctx_t *ctx)
+{
+    /* xorshift32 : reproducible between runs and between target and host */
+    ctx->seed ^= ctx->seed << 13;
+    ctx->seed ^= ctx->seed >> 17;
+    ctx->seed ^= ctx->seed << 5;
+
+    return ctx->seed;
+}
+
+static uint32_t cmai_flash_bench_iterations(uint32_t size)
+{
+    uint32_t iterations = CMA_FLASH_BENCH_BYTES_PER_CASE / size;
+
+    if (iterations < CMA_FLASH_BENCH_MIN_ITERATIONS)
+        iterations = CMA_FLASH_BENCH_MIN_ITERATIONS;
+    else if (iterations > CMA_FLASH_BENCH_MAX_ITERATIONS)
+        iterations = CMA_FLASH_BENCH_MAX_ITERATIONS;
+
+    return iterations;
+}
+
+static uint32_t cmai_flash_bench_address(struct cma_flash_bench_ctx_t *ctx, CMA_FLASH_BENCH_PATTERN pattern,
+        uint32_t index, uint32_t size, uint32_t misalign)
+{
+    /* span of valid start offsets, size + misalign never exceeds the area (checked by caller) */
+    uint32_t span = ctx->length - size - misalign;
+    uint32_t offset;
+
+    switch (pattern)
+    {
+        case CMA_FLASH_BENCH_RANDOM:
+            offset = cmai_flash_bench_random (ctx) % (span + 1);
+            if (misalign == 0)
+                offset &= ~0x3UL;
+        break;
+        case CMA_FLASH_BENCH_SCATTER:
+            offset = (index * CMA_FLASH_BENCH_SECTOR_SIZE) % (span + 1);
+            offset -= offset % CMA_FLASH_BENCH_SECTOR_SIZE;
+        break;
+        case CMA_FLASH_BENCH_SEQUENTIAL:
+        default:
+            offset = (index * size) % (span + 1);
+            if (misalign == 0)
+                offset &= ~0x3UL;
+        break;
+    }
+
+    return ctx->start + offset + misalign;
+}
+
+static void cmai_flash_bench_sort(uint32_t *samples, uint32_t count)
+{
+    for (uint32_t i = 1; i < count; i++)
+    {
+        uint32_t value = samples[i];
+        uint32_t j = i;
+
+        while (j > 0 && samples[j - 1] > value)
+        {
+            samples[j] = samples[j - 1];
+            j--;
+        }
+        samples[j] = value;
+    }
+}
+
+static void cmai_flash_bench_summarize(struct cma_flash_bench_ctx_t *ctx, cma_flash_bench_result_t *result,
+        uint32_t count, uint64_t total_us, uint64_t total_bytes)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t bucket = 0;
+        uint32_t value = ctx->samples[i];
+
+        while (value > 1 && bucket < (CMA_FLASH_BENCH_HIST_BUCKETS - 1))
+        {
+            value >>= 1;
+            bucket++;
+        }
+        result->hist[bucket]++;
+    }
+
+    cmai_flash_bench_sort (ctx->samples, count);
+
+    if (count > 0)
+    {
+        result->p50_us = ctx->samples[((count - 1) * 50) / 100];
+        result->p99_us = ctx->samples[((count - 1) * 99) / 100];
+        result->max_us = ctx->samples[count - 1];
+    }
+
+    if (total_us > 0)
+        result->kbytes_per_sec = (uint32_t) ((total_bytes * 1000000ULL) / (total_us * 1024ULL));
+}
+
+static void cmai_flash_bench_print(cma_flash_bench_result_t *result)
+{
+    char hist[CMA_FLASH_BENCH_HIST_BUCKETS * 12];
+    uint32_t pos = 0;
+
+    LOG(LOG_INFO, "%-16s %6u %4u %4u %8u %9u %9u %9u %6u", result->name, (unsigned) result->size,
+        (unsigned) result->iterations, (unsigned) result->failures, (unsigned) result->kbytes_per_sec,
+        (unsigned) result->p50_us, (unsigned) result->p99_us, (unsigned) result->max_us, (unsigned) result->erases);
+
+    hist[0] = '\0';
+    for (uint32_t i = 0; i < CMA_FLASH_BENCH_HIST_BUCKETS; i++)
+    {
+        if (result->hist[i] != 0)
+        {
+            pos += (uint32_t) snprintf (&hist[pos], sizeof(hist) - pos, " <%luus:%u", (unsigned long) (2UL << i),
+                                        (unsigned) result->hist[i]);
+        }
+    }
+    LOG(LOG_INFO, "    hist%s", hist);
+}
+
+static void cmai_flash_bench_open(struct cma_flash_bench_ctx_t *ctx, const char *name, uint8_t cold)
+{
+    cma_flash_bench_result_t result;
+    uint64_t total_us = 0;
+    uint32_t count = 0;
+
+    memset (&result, 0, sizeof(result));
+    result.name = name;
+    result.iterations = CMA_FLASH_BENCH_OPEN_ITERATIONS;
+
+    for (uint32_t i = 0; i < CMA_FLASH_BENCH_OPEN_ITERATIONS; i++)
+    {
+        uint32_t erase_count = 0;
+        uint32_t start;
+
+        if (cold)
+        {
+            /* flash is in deep power down and resources are released like before a wake-up */
+            cma_flash_power_down (ctx->handle);
+            cma_flash_close (ctx->handle);
+            cma_flash_delete ();
+        }
+        else
+        {
+            cma_flash_close (ctx->handle);
+            erase_count = cma_flash_get_erase_count ();
+        }
+
+        start = cmai_flash_bench_ticks ();
+        if (cold)
+        {
+            /* erase count restarts from 0 */
+            cma_flash_init ();
+        }
+        ctx->handle = cma_flash_open ();
+        ctx->samples[count] = cmai_flash_bench_elapsed_us (start);
+        result.erases += cma_flash_get_erase_count () - erase_count;
+
+        if (ctx->handle == NULL)
+        {
+            result.failures++;
+            continue;
+        }
+
+        total_us += ctx->samples[count];
+        count++;
+    }
+
+    cmai_flash_bench_summarize (ctx, &result, count, total_us, 0);
+    cmai_flash_bench_print (&result);
+}
+
+static void cmai_flash_bench_case(struct cma_flash_bench_ctx_t *ctx, const char *name, CMA_FLASH_BENCH_OP op,
+        CMA_FLASH_BENCH_PATTERN pattern, uint32_t size, uint32_t misalign)
+{
+    cma_flash_bench_result_t result;
+    uint64_t total_us = 0;
+    uint64_t total_bytes = 0;
+    uint32_t erase_count;
+    uint32_t count = 0;
+
+    if (ctx->handle == NULL || size > ctx->buffer_size || (size + misalign) > ctx->length)
+        return;
+
+    memset (&result, 0, sizeof(result));
+    result.name = name;
+    result.size = size;
+    result.iterations = cmai_flash_bench_iterations (size);
+
+    erase_count = cma_flash_get_erase_count ();
+
+    for (uint32_t i = 0; i < result.iterations; i++)
+    {
+        uint32_t address = cmai_flash_bench_address (ctx, pattern, i, size, misalign);
+        CMA_STATUS_TYPE ret;
+        uint32_t start;
+
+        if (op == CMA_FLASH_BENCH_OP_WRITE)
+            memset (ctx->buffer, (int) (i & 0xFF), size);
+
+        start = cmai_flash_bench_ticks ();
+        switch (op)
+        {
+            case CMA_FLASH_BENCH_OP_READ:
+                ret = cma_flash_read (ctx->handle, address, ctx->buffer, size);
+            break;
+            case CMA_FLASH_BENCH_OP_WRITE:
+                ret = cma_flash_write (ctx->handle, address, ctx->buffer, size);
+            break;
+            case CMA_FLASH_BENCH_OP_ERASE:
+            default:
+                ret = cma_flash_erase (ctx->handle, address, size);
+            break;
+        }
+        ctx->samples[count] = cmai_flash_bench_elapsed_us (start);
+
+        if (ret != CMA_STATUS_OK)
+        {
+            result.failures++;
+            continue;
+        }
+
+        total_us += ctx->samples[count];
+        total_bytes += size;
+        count++;
+    }
+
+    result.erases = cma_flash_get_erase_count () - erase_count;
+
+    cmai_flash_bench_summarize (ctx, &result, count, total_us, total_bytes);
+    cmai_flash_bench_print (&result);
+}
+
+CMA_STATUS_TYPE cma_flash_bench_run(uint32_t startAddress, uint32_t areaLength)
+{
+    static const struct
+    {
+        const char *name;
+        CMA_FLASH_BENCH_OP op;
+        CMA_FLASH_BENCH_PATTERN pattern;
+        uint32_t misalign;
+    } cases[] =
+    {
+    { "read seq", CMA_FLASH_BENCH_OP_READ, CMA_FLASH_BENCH_SEQUENTIAL, 0 },
+    { "read seq unal", CMA_FLASH_BENCH_OP_READ, CMA_FLASH_BENCH_SEQUENTIAL, CMA_FLASH_BENCH_UNALIGNED },
+    { "read rand", CMA_FLASH_BENCH_OP_READ, CMA_FLASH_BENCH_RANDOM, 0 },
+    { "read rand unal", CMA_FLASH_BENCH_OP_READ, CMA_FLASH_BENCH_RANDOM, CMA_FLASH_BENCH_UNALIGNED },
+    { "write seq", CMA_FLASH_BENCH_OP_WRITE, CMA_FLASH_BENCH_SEQUENTIAL, 0 },
+    { "write seq unal", CMA_FLASH_BENCH_OP_WRITE, CMA_FLASH_BENCH_SEQUENTIAL, CMA_FLASH_BENCH_UNALIGNED },
+    { "write rand", CMA_FLASH_BENCH_OP_WRITE, CMA_FLASH_BENCH_RANDOM, 0 },
+    { "write rand unal", CMA_FLASH_BENCH_OP_WRITE, CMA_FLASH_BENCH_RANDOM, CMA_FLASH_BENCH_UNALIGNED }, };
+    struct cma_flash_bench_ctx_t *ctx;
+
+    if ((startAddress % CMA_FLASH_BENCH_SECTOR_SIZE) != 0
+            || areaLength < (CMA_FLASH_BENCH_MAX_SIZE + CMA_FLASH_BENCH_SECTOR_SIZE))
+    {
+        LOG(LOG_ERR, "flash bench : invalid area 0x%x (0x%x)", (unsigned) startAddress, (unsigned) areaLength);
+        return CMA_STATUS_FAIL;
+    }
+
+    ctx = OS_MALLOC(sizeof(struct cma_flash_bench_ctx_t));
+    if (ctx == NULL)
+        return CMA_STATUS_FAIL;
+
+    memset (ctx, 0, sizeof(struct cma_flash_bench_ctx_t));
+    ctx->start = startAddress;
+    ctx->length = areaLength;
+    ctx->seed = CMA_FLASH_BENCH_SEED;
+
+    /* Large sizes are skipped when heap is short */
+    for (ctx->buffer_size = CMA_FLASH_BENCH_MAX_SIZE; ctx->buffer_size >= CMA_FLASH_BENCH_MIN_SIZE;
+            ctx->buffer_size >>= 1)
+    {
+        ctx->buffer = OS_MALLOC(ctx->buffer_size);
+        if (ctx->buffer)
+            break;
+    }
+
+    if (ctx->buffer == NULL)
+    {
+        OS_FREE(ctx);
+        return CMA_STATUS_FAIL;
+    }
+
+    if (ctx->buffer_size < CMA_FLASH_BENCH_MAX_SIZE)
+    {
+        LOG(LOG_WARN, "flash bench : sizes over %u bytes are skipped", (unsigned) ctx->buffer_size);
+    }
+
+    cmai_flash_bench_timer_init ();
+
+    LOG(LOG_INFO, "%-16s %6s %4s %4s %8s %9s %9s %9s %6s", "case", "size", "iter", "fail", "KB/s", "p50(us)",
+        "p99(us)", "max(us)", "erase");
+
+    ctx->handle = cma_flash_open ();
+    cmai_flash_bench_open (ctx, "open cold", 1);
+    cmai_flash_bench_open (ctx, "open warm", 0);
+
+    for (uint32_t c = 0; c < (sizeof(cases) / sizeof(cases[0])); c++)
+    {
+        for (uint32_t size = CMA_FLASH_BENCH_MIN_SIZE; size <= CMA_FLASH_BENCH_MAX_SIZE; size <<= 2)
+        {
+            cmai_flash_bench_case (ctx, cases[c].name, cases[c].op, cases[c].pattern, size, cases[c].misalign);
+        }
+    }
+
+    /* Erase-heavy patterns */
+    cmai_flash_bench_case (ctx, "erase sector", CMA_FLASH_BENCH_OP_ERASE, CMA_FLASH_BENCH_SEQUENTIAL,
+                           CMA_FLASH_BENCH_SECTOR_SIZE, 0);
+    cmai_flash_bench_case (ctx, "erase 64K", CMA_FLASH_BENCH_OP_ERASE, CMA_FLASH_BENCH_SEQUENTIAL,
+                           CMA_FLASH_BENCH_MAX_SIZE, 0);
+    cmai_flash_bench_case (ctx, "erase partial", CMA_FLASH_BENCH_OP_ERASE, CMA_FLASH_BENCH_RANDOM,
+                           CMA_FLASH_BENCH_MIN_SIZE, CMA_FLASH_BENCH_UNALIGNED);
+    cmai_flash_bench_case (ctx, "write scatter", CMA_FLASH_BENCH_OP_WRITE, CMA_FLASH_BENCH_SCATTER,
+                           CMA_FLASH_BENCH_MIN_SIZE, 0);
+
+    if (ctx->handle)
+        cma_flash_close (ctx->handle);
+
+    OS_FREE(ctx->buffer);
+    OS_FREE(ctx);
+
+    return CMA_STATUS_OK;
+}
+
+#if defined(CMA_FLASH_SIM)
+int main(void)
+{
+    cma_flash_init ();
+
+    return (cma_flash_bench_run (CMA_FLASH_SIM_BASE, CMA_FLASH_SIM_SIZE) == CMA_STATUS_OK) ? 0 : 1;
+}
+#endif /* CMA_FLASH_SIM */
@@ -0,0 +1,273 @@
+/**
+ ****************************************************************************************
+ *
+ * @file cma_flash_sim.c
+ *
+ * @brief Simulated SFLASH backend for host builds.
+ *
+ * Copyright (c) 2016-2024 Renesas Electronics. All rights reserved.
+ *
+ * This software ("Software") is owned by Renesas Electronics.
+ *
+ * By using this Software you agree that Renesas Electronics retains all
+ * intellectual property and proprietary rights in and to this Software and any
+ * use, reproduction, disclosure or distribution of the Software without express
+ * written permission or a license agreement from Renesas Electronics is
+ * strictly prohibited. This Software is solely for use on or in conjunction
+ * with Renesas Electronics products.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE
+ * SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. EXCEPT AS OTHERWISE
+ * PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * RENESAS ELECTRONICS BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL,
+ * OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ *
+ ****************************************************************************************
+ */
+
+
+#if defined(CMA_FLASH_SIM)
+
+#include <string.h>
+#include "cma_flash.h"
+#include "cma_flash_sim.h"
+
+#define CMA_SECTOR_SIZE 4096
+#define CMA_PROG_PAGE_SIZE 256
+
+struct cma_flash_sim_t
+{
+    uint8_t mem[CMA_FLASH_SIM_SIZE];
+    uint32_t erase_count;
+    uint64_t elapsed_ns;
+    uint8_t filled;
+    uint8_t init;
+    uint8_t opened;
+    uint8_t probed;
+    uint8_t powered_down;
+};
+
+static struct cma_flash_sim_t cma_flash_sim;
+
+static uint8_t* cmai_flash_sim_addr(uint32_t address, uint32_t length)
+{
+    if (address < CMA_FLASH_SIM_BASE || length > CMA_FLASH_SIM_SIZE
+            || (address - CMA_FLASH_SIM_BASE) > (CMA_FLASH_SIM_SIZE - length))
+    {
+        return NULL;
+    }
+
+    return &cma_flash_sim.mem[address - CMA_FLASH_SIM_BASE];
+}
+
+static uint32_t cmai_flash_read(uint32_t address, uint8_t *buffer, uint32_t length)
+{
+    uint8_t *src = cmai_flash_sim_addr (address, length);
+
+    if (src == NULL)
+        return 0;
+
+    memcpy (buffer, src, length);
+    cma_flash_sim.elapsed_ns += CMA_FLASH_SIM_READ_CMD_NS + (uint64_t) length * CMA_FLASH_SIM_READ_BYTE_NS;
+
+    return length;
+}
+
+static uint32_t cmai_flash_write(uint32_t address, uint8_t *data, uint32_t length)
+{
+    uint8_t *dst = cmai_flash_sim_addr (address, length);
+
+    if (dst == NULL)
+        return 0;
+
+    /* NOR program can only clear bits */
+    for (uint32_t i = 0; i < length; i++)
+        dst[i] &= data[i];
+
+    cma_flash_sim.elapsed_ns += (uint64_t) ((length + CMA_PROG_PAGE_SIZE - 1) / CMA_PROG_PAGE_SIZE)
+            * CMA_FLASH_SIM_PROG_PAGE_NS;
+
+    return length;
+}
+
+static uint32_t cmai_flash_erase_sector(uint32_t address)
+{
+    uint8_t *dst = cmai_flash_sim_addr (address, CMA_SECTOR_SIZE);
+
+    if (dst == NULL)
+        return 0;
+
+    memset (dst, 0xFF, CMA_SECTOR_SIZE);
+    cma_flash_sim.erase_count++;
+    cma_flash_sim.elapsed_ns += CMA_FLASH_SIM_ERASE_SECTOR_NS;
+
+    return CMA_SECTOR_SIZE;
+}
+
+/* Same sector based read-modify-write as cma_flash.c, data == NULL means erase */
+static CMA_STATUS_TYPE cmai_flash_update(uint32_t startAddress, uint8_t *newData, uint32_t dataLength)
+{
+    static uint8_t sectorBuffer[CMA_SECTOR_SIZE];
+    uint32_t endAddress = startAddress + dataLength - 1;
+    uint32_t startSector = startAddress / CMA_SECTOR_SIZE;
+    uint32_t endSector = endAddress / CMA_SECTOR_SIZE;
+
+    for (uint32_t sector = startSector; sector <= endSector; sector++)
+    {
+        uint32_t sectorStart = sector * CMA_SECTOR_SIZE;
+        uint32_t sectorEnd = sectorStart + CMA_SECTOR_SIZE - 1;
+        uint32_t newStartOffset = (sectorStart < startAddress) ? (startAddress - sectorStart) : 0;
+        uint32_t newEndOffset = (sectorEnd > endAddress) ? (endAddress - sectorStart + 1) : CMA_SECTOR_SIZE;
+        uint32_t newDataOffset = (sectorStart < startAddress) ? 0 : (sectorStart - startAddress);
+
+        if (cmai_flash_read (sectorStart, sectorBuffer, CMA_SECTOR_SIZE) != CMA_SECTOR_SIZE)
+            return CMA_STATUS_FAIL;
+
+        if (newData)
+            memcpy (&sectorBuffer[newStartOffset], &newData[newDataOffset], newEndOffset - newStartOffset);
+        else
+            memset (&sectorBuffer[newStartOffset], 0xFF, newEndOffset - newStartOffset);
+
+        if (cmai_flash_erase_sector (sectorStart) != CMA_SECTOR_SIZE)
+            return CMA_STATUS_FAIL;
+
+        if (cmai_flash_write (sectorStart, sectorBuffer, CMA_SECTOR_SIZE) != CMA_SECTOR_SIZE)
+            return CMA_STATUS_FAIL;
+    }
+
+    return CMA_STATUS_OK;
+}
+
+void cma_flash_sim_reset(void)
+{
+    memset (cma_flash_sim.mem, 0xFF, sizeof(cma_flash_sim.mem));
+    cma_flash_sim.elapsed_ns = 0;
+}
+
+uint64_t cma_flash_sim_elapsed_ns(void)
+{
+    return cma_flash_sim.elapsed_ns;
+}
+
+CMA_STATUS_TYPE cma_flash_init(void)
+{
+    /* Contents and virtual clock are kept when the driver is deleted and init again */
+    if (!cma_flash_sim.filled)
+    {
+        cma_flash_sim_reset ();
+        cma_flash_sim.filled = 1;
+    }
+
+    cma_flash_sim.init = 1;
+
+    /* Driver parameters are read again by the next open */
+    cma_flash_sim.probed = 0;
+    cma_flash_sim.erase_count = 0;
+
+    return CMA_STATUS_OK;
+}
+
+CMA_STATUS_TYPE cma_flash_delete(void)
+{
+    cma_flash_sim.init = 0;
+
+    return CMA_STATUS_OK;
+}
+
+void* cma_flash_open(void)
+{
+    if (!cma_flash_sim.init)
+        return NULL;
+
+    cma_flash_sim.opened = 1;
+    cma_flash_sim.elapsed_ns += CMA_FLASH_SIM_OPEN_NS;
+
+    if (!cma_flash_sim.probed)
+    {
+        cma_flash_sim.probed = 1;
+        cma_flash_sim.elapsed_ns += CMA_FLASH_SIM_PROBE_NS;
+    }
+
+    if (cma_flash_sim.powered_down)
+    {
+        cma_flash_sim.powered_down = 0;
+        cma_flash_sim.elapsed_ns += CMA_FLASH_SIM_RELEASE_NS;
+    }
+
+    return (void*) &cma_flash_sim;
+}
+
+CMA_STATUS_TYPE cma_flash_write(void *handle, uint32_t startAddress, uint8_t *newData, uint32_t dataLength)
+{
+    if (handle != &cma_flash_sim || !cma_flash_sim.opened || newData == NULL || dataLength == 0)
+        return CMA_STATUS_FAIL;
+
+    return cmai_flash_update (startAddress, newData, dataLength);
+}
+
+CMA_STATUS_TYPE cma_flash_read(void *handle, uint32_t startAddress, uint8_t *readData, uint32_t dataLength)
+{
+    if (handle != &cma_flash_sim || !cma_flash_sim.opened)
+        return CMA_STATUS_FAIL;
+
+    if (cmai_flash_read (startAddress, readData, dataLength) != dataLength)
+        return CMA_STATUS_FAIL;
+
+    return CMA_STATUS_OK;
+}
+
+CMA_STATUS_TYPE cma_flash_erase(void *handle, uint32_t startAddress, uint32_t dataLength)
+{
+    if (handle != &cma_flash_sim || !cma_flash_sim.opened || dataLength == 0)
+        return CMA_STATUS_FAIL;
+
+    return cmai_flash_update (startAddress, NULL, dataLength);
+}
+
+CMA_STATUS_TYPE cma_flash_close(void *handle)
+{
+    if (handle != &cma_flash_sim || !cma_flash_sim.opened)
+        return CMA_STATUS_FAIL;
+
+    cma_flash_sim.opened = 0;
+
+    return CMA_STATUS_OK;
+}
+
+CMA_STATUS_TYPE cma_flash_power_down(void *handle)
+{
+    if (handle != &cma_flash_sim || !cma_flash_sim.opened)
+        return CMA_STATUS_FAIL;
+
+    cma_flash_sim.powered_down = 1;
+
+    return CMA_STATUS_OK;
+}
+
+const uint8_t* cma_flash_map(void *handle, uint32_t startAddress, uint32_t dataLength)
+{
+    if (handle != &cma_flash_sim || dataLength == 0)
+        return NULL;
+
+    return cmai_flash_sim_addr (startAddress, dataLength);
+}
+
+CMA_STATUS_TYPE cma_flash_unmap(void *handle, const uint8_t *mapped)
+{
+    if (handle != &cma_flash_sim || mapped == NULL)
+        return CMA_STATUS_FAIL;
+
+    return CMA_STATUS_OK;
+}
+
+uint32_t cma_flash_get_erase_count(void)
+{
+    return cma_flash_sim.erase_count;
+}
+
+#endif /* CMA_FLASH_SIM */
@@ -0,0 +1,251 @@
+/**
+ ****************************************************************************************
+ *
+ * @file cma_gpio_event.c
+ *
+ * @brief Timestamped GPIO interrupt event queue.
+ *
+ * Copyright (c) 2016-2024 Renesas Electronics. All rights reserved.
+ *
+ * This software ("Software") is owned by Renesas Electronics.
+ *
+ * By using this Software you agree that Renesas Electronics retains all
+ * intellectual property and proprietary rights in and to this Software and any
+ * use, reproduction, disclosure or distribution of the Software without express
+ * written permission or a license agreement from Renesas Electronics is
+ * strictly prohibited. This Software is solely for use on or in conjunction
+ * with Renesas Electronics products.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE
+ * SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. EXCEPT AS OTHERWISE
+ * PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * RENESAS ELECTRONICS BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL,
+ * OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ *
+ ****************************************************************************************
+ */
+
+#include "sdk_type.h"
+#include "da16x_system.h"
+#include "da16x_types.h"
+#include "gpio.h"
+#include "cma_gpio_event.h"
+
+#if (CMA_GPIO_EVENT_QUEUE_SIZE & (CMA_GPIO_EVENT_QUEUE_SIZE - 1)) != 0
+#error "CMA_GPIO_EVENT_QUEUE_SIZE must be a power of 2"
+#endif
+
+#define CMA_GPIO_EVENT_QUEUE_MASK       (CMA_GPIO_EVENT_QUEUE_SIZE - 1)
+
+/* Reads of a both-edge pin after setting its polarity, in one interrupt */
+#define CMA_GPIO_EVENT_RESYNC_MAX       4
+
+/*
+ *****************************************************
+ * Single producer / single consumer ring.
+ *
+ * head is only written in GPIO interrupt and tail only by the reading task, so no lock is
+ * needed. GPIO interrupts of all ports must have the same priority (default of SDK) so that
+ * one interrupt never preempts another one in the middle of a push.
+ ******************************************************
+ */
+static cma_gpio_event_t cma_gpio_event_queue[CMA_GPIO_EVENT_QUEUE_SIZE];
+static volatile uint32_t cma_gpio_event_head;
+static volatile uint32_t cma_gpio_event_tail;
+static volatile uint32_t cma_gpio_event_lost;     /* written in interrupt */
+static uint32_t cma_gpio_event_lost_reported;     /* written by reader */
+
+static cma_gpio_event_notify_t cma_gpio_event_notify;
+static void *cma_gpio_event_notify_arg;
+
+/* pins queued on both edges */
+static uint16_t cma_gpio_event_both_edges[CMA_GPIO_PORT_MAX];
+
+static void cmai_gpio_event_push(CMA_GPIO_PORT_TYPE port, CMA_GPIO_PIN_TYPE pin, uint8_t level)
+{
+    uint32_t head = cma_gpio_event_head;
+    cma_gpio_event_t *event;
+
+    if ((head - cma_gpio_event_tail) >= CMA_GPIO_EVENT_QUEUE_SIZE)
+    {
+        cma_gpio_event_lost++;
+        return;
+    }
+
+    event = &cma_gpio_event_queue[head & CMA_GPIO_EVENT_QUEUE_MASK];
+    event->time = DWT->CYCCNT;
+    event->port = (uint8_t) port;
+    event->pin = (uint8_t) pin;
+    event->level = level;
+    event->reserved = 0;
+
+    /* event must be visible before the reader sees the new head */
+    __DMB ();
+    cma_gpio_event_head = head + 1;
+}
+
+/* Wait for the edge leaving the given level */
+static void cmai_gpio_event_set_polarity(CMA_GPIO_PORT_TYPE port, CMA_GPIO_PIN_TYPE pin, uint8_t level)
+{
+    uint32_t ioctldata[2] =
+    { 0, };
+
+    GPIO_IOCTL (cma_gpio_handle[port], GPIO_GET_INTR_MODE, &ioctldata[0]);
+    /* interrupt pol 1: high active, 0: low active */
+    if (level)
+    {
+        ioctldata[1] &= ~(0x01 << pin);
+    }
+    else
+    {
+        ioctldata[1] |= (0x01 << pin);
+    }
+    GPIO_IOCTL (cma_gpio_handle[port], GPIO_SET_INTR_MODE, &ioctldata[0]);
+}
+
+static void cmai_gpio_event_handler(CMA_GPIO_PORT_TYPE port, CMA_GPIO_PIN_TYPE pin)
+{
+    uint8_t level = cma_gpio_fast_read (port, pin);
+    uint8_t now;
+
+    cmai_gpio_event_push (port, pin, level);
+
+    if (cma_gpio_event_both_edges[port] & (0x01 << pin))
+    {
+        /*
+         * Polarity follows the sampled level, not the previous polarity, so a glitch shorter
+         * than interrupt latency does not put the queue out of phase with the pin. An edge
+         * before the new polarity is set is not seen by hardware, so the pin is read again
+         * and the change is queued here. Bounded in case the pin keeps toggling.
+         */
+        for (uint32_t retry = 0; retry < CMA_GPIO_EVENT_RESYNC_MAX; retry++)
+        {
+            cmai_gpio_event_set_polarity (port, pin, level);
+
+            now = cma_gpio_fast_read (port, pin);
+            if (now == level)
+            {
+                break;
+            }
+
+            level = now;
+            cmai_gpio_event_push (port, pin, level);
+        }
+    }
+
+    if (cma_gpio_event_notify != NULL)
+    {
+        cma_gpio_event_notify (cma_gpio_event_notify_arg);
+    }
+}
+
+/* callback param is the pin number, so one handler per port */
+static void cmai_gpio_event_isr_a(void *param)
+{
+    cmai_gpio_event_handler (CMA_GPIO_PORT_A, (CMA_GPIO_PIN_TYPE) (uint32_t) param);
+}
+
+static void cmai_gpio_event_isr_b(void *param)
+{
+    cmai_gpio_event_handler (CMA_GPIO_PORT_B, (CMA_GPIO_PIN_TYPE) (uint32_t) param);
+}
+
+static void cmai_gpio_event_isr_c(void *param)
+{
+    cmai_gpio_event_handler (CMA_GPIO_PORT_C, (CMA_GPIO_PIN_TYPE) (uint32_t) param);
+}
+
+static void *const cma_gpio_event_isr[CMA_GPIO_PORT_MAX] =
+{ (void*) cmai_gpio_event_isr_a, (void*) cmai_gpio_event_isr_b, (void*) cmai_gpio_event_isr_c };
+
+CMA_STATUS_TYPE cma_gpio_event_init(cma_gpio_event_notify_t notify, void *arg)
+{
+    cma_gpio_event_notify = notify;
+    cma_gpio_event_notify_arg = arg;
+    cma_gpio_event_tail = cma_gpio_event_head;
+    cma_gpio_event_lost_reported = cma_gpio_event_lost;
+
+    /* cycle counter is free running, it is not cleared so other users are not disturbed */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    return CMA_STATUS_OK;
+}
+
+CMA_STATUS_TYPE cma_gpio_event_add(CMA_GPIO_PORT_TYPE port, CMA_GPIO_PIN_TYPE pin, CMA_INT_TYPE int_type,
+                                   uint8_t bothEdges)
+{
+    if ((uint32_t) port >= CMA_GPIO_PORT_MAX || cma_gpio_open_port (port) != CMA_STATUS_OK)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    if (bothEdges)
+    {
+        if (int_type != CMA_INT_EDGE_ACTIVE_HIGH && int_type != CMA_INT_EDGE_ACTIVE_LOW)
+        {
+            return CMA_STATUS_FAIL;
+        }
+        cma_gpio_event_both_edges[port] |= (uint16_t) (0x01 << pin);
+    }
+    else
+    {
+        cma_gpio_event_both_edges[port] &= (uint16_t) ~(0x01 << pin);
+    }
+
+    return cma_gpio_set_interrupt (port, pin, int_type, cma_gpio_event_isr[port]);
+}
+
+CMA_STATUS_TYPE cma_gpio_event_remove(CMA_GPIO_PORT_TYPE port, CMA_GPIO_PIN_TYPE pin)
+{
+    if ((uint32_t) port >= CMA_GPIO_PORT_MAX)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    cma_gpio_event_both_edges[port] &= (uint16_t) ~(0x01 << pin);
+
+    return cma_gpio_set_interrupt_disable (port, pin);
+}
+
+uint32_t cma_gpio_event_read(cma_gpio_event_t *events, uint32_t maxEvents)
+{
+    uint32_t tail = cma_gpio_event_tail;
+    uint32_t count = cma_gpio_event_head - tail;
+    uint32_t i;
+
+    if (count > maxEvents)
+    {
+        count = maxEvents;
+    }
+
+    /* events must not be read before the head they were published with */
+    __DMB ();
+
+    for (i = 0; i < count; i++)
+    {
+        events[i] = cma_gpio_event_queue[(tail + i) & CMA_GPIO_EVENT_QUEUE_MASK];
+    }
+
+    /* slots must be copied before the writer can reuse them */
+    __DMB ();
+    cma_gpio_event_tail = tail + count;
+
+    return count;
+}
+
+uint32_t cma_gpio_event_dropped(void)
+{
+    uint32_t lost = cma_gpio_event_lost;
+    uint32_t count = lost - cma_gpio_event_lost_reported;
+
+    /* counter is only written in interrupt, so it is not cleared here */
+    cma_gpio_event_lost_reported = lost;
+
+    return count;
+}
@@ -40,6 +40,8 @@
 #include "cma_gpio.h"
 #include "cma_osal.h"
 #include "cma_flash.h"
+#include "cma_flash_bench.h"
+#include "cma_gpio_event.h"
 #include "user_hw_pin_config.h"
 #include "user_flash.h"
 
@@ -50,6 +52,17 @@
 
 #define USER_FLASH_WRITE_READ_INT       (1 << 0)
 
+/* Button edges taken from event queue at a time */
+#define USER_FLASH_EVENT_BATCH          (8)
+
+/* Run flash micro-benchmark on button press instead of write/read test (destroys user area) */
+#define USER_FLASH_BENCH_ENABLE         (0)
+
+/* Last 2 sectors of user area keep integrity index of the rest */
+#define USER_FLASH_INDEX_SECTORS        (2)
+#define USER_FLASH_DATA_LENGTH          (SFLASH_ALLOC_SIZE_USER - USER_FLASH_INDEX_SECTORS * SF_SECTOR_SZ)
+#define USER_FLASH_INDEX_ADDRESS        (SFLASH_USER_AREA_START + USER_FLASH_DATA_LENGTH)
+
 int32_t debug_level = LOG_INFO;
 
 /* Local variable */
@@ -57,9 +70,9 @@ static OS_TASK xTask = NULL;
 
 /* Local functions */
 
-static void user_flash_write_read_int_handler(void *param)
+static void user_flash_write_read_event_notify(void *arg)
 {
-    DA16X_UNUSED_ARG(param);
+    DA16X_UNUSED_ARG(arg);
 
     if (xTask)
     {
@@ -77,13 +90,43 @@ static void user_gpio_sets_interrupt(void)
 
     cma_gpio_set_input (USER_FLASH_WRITE_READ_GIPO_PORT, USER_FLASH_WRITE_READ_GPIO_NUM, CMA_GPIO_PULL_UP);
 
-    if (cma_gpio_set_interrupt (USER_FLASH_WRITE_READ_GIPO_PORT, USER_FLASH_WRITE_READ_GPIO_NUM,
-                                CMA_INT_EDGE_ACTIVE_LOW, user_flash_write_read_int_handler) == CMA_STATUS_FAIL)
+    cma_gpio_event_init (user_flash_write_read_event_notify, NULL);
+
+    if (cma_gpio_event_add (USER_FLASH_WRITE_READ_GIPO_PORT, USER_FLASH_WRITE_READ_GPIO_NUM,
+                            CMA_INT_EDGE_ACTIVE_LOW, 0) == CMA_STATUS_FAIL)
     {
         configASSERT(0);
     }
 }
 
+/* Drain all queued button edges, returns number of edges read plus edges dropped on overflow */
+static uint32_t user_flash_write_read_events(void)
+{
+    cma_gpio_event_t events[USER_FLASH_EVENT_BATCH];
+    uint32_t count, total = 0, first = 0, last = 0, lost;
+
+    while ((count = cma_gpio_event_read (events, USER_FLASH_EVENT_BATCH)) > 0)
+    {
+        if (total == 0)
+        {
+            first = events[0].time;
+        }
+        last = events[count - 1].time;
+        total += count;
+    }
+
+    lost = cma_gpio_event_dropped ();
+
+    if (total > 1 || lost > 0)
+    {
+        /* bouncing contact or repeated presses are handled once */
+        LOG(LOG_DBG, "button %d edges in %d us, %d lost", total,
+            CMA_GPIO_EVENT_TICKS_TO_US(last - first), lost);
+    }
+
+    return total + lost;
+}
+
 static void user_flash_write_read_op(void)
 {
     void *handle = NULL;
@@ -92,10 +135,10 @@ static void user_flash_write_read_op(void)
     uint32_t size, sector, offset;
     CMA_STATUS_TYPE ret;
 
-    /*0x3be000 ~ 0x3ec000 */
+    /*0x3be000 ~ 0x3ea000, index sectors are not touched */
     size = 0x100;
     offset = rand () % SF_SECTOR_SZ;
-    sector = rand () % ((SFLASH_ALLOC_SIZE_USER / SF_SECTOR_SZ) - 1);
+    sector = rand () % ((USER_FLASH_DATA_LENGTH / SF_SECTOR_SZ) - 1);
     address = SFLASH_USER_AREA_START + sector * SF_SECTOR_SZ + offset - size;
 
     LOG(LOG_INFO, "\r\noffset = 0x%x sector = 0x%x address = 0x%x", offset, sector, address);
@@ -146,6 +189,36 @@ static void user_flash_write_read_op(void)
     LOG(LOG_INFO, "Completed!");
 }
 
+static void user_flash_index_op(void)
+{
+    void *handle = NULL;
+    uint32_t damaged = 0;
+    OS_TICK_TIME start;
+    CMA_STATUS_TYPE ret;
+
+    start = OS_GET_TICK_COUNT();
+
+    handle = cma_flash_open ();
+    cma_assert(handle);
+
+    ret = cma_flash_index_open (handle, SFLASH_USER_AREA_START, USER_FLASH_DATA_LENGTH, USER_FLASH_INDEX_ADDRESS);
+    if (ret == CMA_STATUS_OK)
+    {
+        ret = cma_flash_index_check (handle, &damaged);
+    }
+
+    cma_flash_close (handle);
+
+    if (ret != CMA_STATUS_OK)
+    {
+        LOG(LOG_ERR, "Flash index check failed!");
+        return;
+    }
+
+    LOG(LOG_INFO, "Flash index check: %d damaged sector(s), %d ms", damaged,
+        OS_TICKS_2_MS(OS_GET_TICK_COUNT() - start));
+}
+
 static void user_flash_task(void *arg)
 {
     DA16X_UNUSED_ARG(arg);
@@ -159,6 +232,8 @@ static void user_flash_task(void *arg)
     if (wdog_id < 0)
         return;
 
+    user_flash_index_op ();
+
     user_gpio_sets_interrupt ();
 
     for (;;)
@@ -184,9 +259,17 @@ static void user_flash_task(void *arg)
         /* Resume watchdog */
         da16x_sys_watchdog_notify_and_resume (wdog_id);
 
-        if (notif & USER_FLASH_WRITE_READ_INT)
+        if ((notif & USER_FLASH_WRITE_READ_INT) && user_flash_write_read_events () > 0)
         {
+#if USER_FLASH_BENCH_ENABLE
+            /* Erase-heavy cases take longer than watchdog period */
+            da16x_sys_watchdog_suspend (wdog_id);
+            cma_flash_index_close ();
+            cma_flash_bench_run (SFLASH_USER_AREA_START, USER_FLASH_DATA_LENGTH);
+            da16x_sys_watchdog_notify_and_resume (wdog_id);
+#else
             user_flash_write_read_op ();
+#endif
         }
 
     }
@@ -0,0 +1,119 @@
+/**
+ ****************************************************************************************
+ *
+ * @file cma_button.h
+ *
+ * @brief Button debounce and press classification.
+ *
+ * Copyright (c) 2016-2024 Renesas Electronics. All rights reserved.
+ *
+ * This software ("Software") is owned by Renesas Electronics.
+ *
+ * By using this Software you agree that Renesas Electronics retains all
+ * intellectual property and proprietary rights in and to this Software and any
+ * use, reproduction, disclosure or distribution of the Software without express
+ * written permission or a license agreement from Renesas Electronics is
+ * strictly prohibited. This Software is solely for use on or in conjunction
+ * with Renesas Electronics products.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE
+ * SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. EXCEPT AS OTHERWISE
+ * PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * RENESAS ELECTRONICS BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL,
+ * OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ *
+ ****************************************************************************************
+ */
+
+#ifndef CMA_BUTTON_H_
+
+#define CMA_BUTTON_H_
+
+#include "cma_gpio.h"
+
+/* Maximum number of buttons */
+#ifndef CMA_BUTTON_MAX
+#define CMA_BUTTON_MAX                  4
+#endif
+
+/* Sampling period while a button is active */
+#ifndef CMA_BUTTON_SCAN_MS
+#define CMA_BUTTON_SCAN_MS              10
+#endif
+
+/* Level must be stable this long to be taken */
+#ifndef CMA_BUTTON_DEBOUNCE_MS
+#define CMA_BUTTON_DEBOUNCE_MS          30
+#endif
+
+typedef enum
+{
+    CMA_BUTTON_EVENT_PRESS = 0,     /* debounced press */
+    CMA_BUTTON_EVENT_RELEASE,       /* debounced release */
+    CMA_BUTTON_EVENT_SHORT,         /* released before long_ms, not followed by a double press
+                                       (sent before LONG if the second press is held) */
+    CMA_BUTTON_EVENT_DOUBLE,        /* second short press released in double_ms */
+    CMA_BUTTON_EVENT_LONG,          /* held for long_ms, sent while still held */
+    CMA_BUTTON_EVENT_HOLD_REPEAT,   /* sent every repeat_ms after long event while held */
+} CMA_BUTTON_EVENT;
+
+/* Called in timer task, must not block */
+typedef void (*cma_button_callback_t)(uint8_t id, CMA_BUTTON_EVENT event, void *arg);
+
+typedef struct
+{
+    CMA_GPIO_PORT_TYPE port;
+    CMA_GPIO_PIN_TYPE pin;
+    CMA_GPIO_PULL_STATE pull;
+    CMA_GPIO_LEVEL_TYPE active_level;   /* level when pressed */
+    uint16_t long_ms;                   /* 0: no long event */
+    uint16_t repeat_ms;                 /* 0: no hold-repeat event */
+    uint16_t double_ms;                 /* 0: no double event, short is sent at release */
+    cma_button_callback_t callback;
+    void *arg;
+} cma_button_config_t;
+
+/**
+ ****************************************************************************************
+ * @brief Add a button.
+ *
+ * The pin is set as input with interrupt, cma_gpio_set_func is done by caller.
+ * All buttons are sampled by a single timer, which only runs from a press until every
+ * button is released and classified.
+ *
+ * @param[in] button configuration.
+ * @param[out] button id given to callback.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_button_add(const cma_button_config_t *config, uint8_t *id);
+
+/**
+ ****************************************************************************************
+ * @brief Remove a button. Interrupt of the pin is disabled.
+ *
+ * @param[in] button id.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_button_remove(uint8_t id);
+
+/**
+ ****************************************************************************************
+ * @brief Check if a button is pressed (debounced).
+ *
+ * @param[in] button id.
+ *
+ * @return 1: pressed, 0: released.
+ ****************************************************************************************
+ */
+uint8_t cma_button_is_pressed(uint8_t id);
+
+#endif /* CMA_BUTTON_H_ */
@@ -0,0 +1,303 @@
+/**
+ ****************************************************************************************
+ *
+ * @file cma_button.c
+ *
+ * @brief Button debounce and press classification.
+ *
+ * Copyright (c) 2016-2024 Renesas Electronics. All rights reserved.
+ *
+ * This software ("Software") is owned by Renesas Electronics.
+ *
+ * By using this Software you agree that Renesas Electronics retains all
+ * intellectual property and proprietary rights in and to this Software and any
+ * use, reproduction, disclosure or distribution of the Software without express
+ * written permission or a license agreement from Renesas Electronics is
+ * strictly prohibited. This Software is solely for use on or in conjunction
+ * with Renesas Electronics products.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE
+ * SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. EXCEPT AS OTHERWISE
+ * PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * RENESAS ELECTRONICS BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL,
+ * OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ *
+ ****************************************************************************************
+ */
+
+#include "sdk_type.h"
+#include "da16x_system.h"
+#include "da16x_types.h"
+#include "cma_osal.h"
+#include "cma_debug.h"
+#include "cma_button.h"
+
+typedef struct
+{
+    cma_button_config_t config;
+    uint8_t used;
+    uint8_t pressed;        /* debounced state */
+    uint8_t clicks;         /* short presses waiting for double_ms */
+    uint8_t long_sent;
+    uint16_t bounce_ms;     /* time raw level differs from debounced state */
+    uint16_t held_ms;
+    uint16_t gap_ms;
+    uint16_t repeat_ms;
+} cma_button_t;
+
+static cma_button_t cma_button[CMA_BUTTON_MAX];
+static OS_TIMER cma_button_timer = NULL;
+
+/* set in interrupt when scan timer is started, cleared by timer when every button is idle */
+static volatile uint8_t cma_button_scanning;
+
+static void cmai_button_event(uint8_t id, CMA_BUTTON_EVENT event)
+{
+    cma_button_t *button = &cma_button[id];
+
+    if (button->config.callback != NULL)
+    {
+        button->config.callback (id, event, button->config.arg);
+    }
+}
+
+static uint8_t cmai_button_raw_pressed(cma_button_t *button)
+{
+    return cma_gpio_get_input (button->config.port, button->config.pin) == button->config.active_level;
+}
+
+static void cmai_button_on_press(uint8_t id)
+{
+    cma_button_t *button = &cma_button[id];
+
+    button->held_ms = 0;
+    button->repeat_ms = 0;
+    button->long_sent = 0;
+    cmai_button_event (id, CMA_BUTTON_EVENT_PRESS);
+}
+
+static void cmai_button_on_release(uint8_t id)
+{
+    cma_button_t *button = &cma_button[id];
+
+    cmai_button_event (id, CMA_BUTTON_EVENT_RELEASE);
+
+    if (button->long_sent)
+    {
+        button->clicks = 0;
+        return;
+    }
+
+    if (button->config.double_ms == 0)
+    {
+        cmai_button_event (id, CMA_BUTTON_EVENT_SHORT);
+    }
+    else if (++button->clicks >= 2)
+    {
+        button->clicks = 0;
+        cmai_button_event (id, CMA_BUTTON_EVENT_DOUBLE);
+    }
+    else
+    {
+        button->gap_ms = 0;
+    }
+}
+
+/* returns 1 while the button still needs sampling */
+static uint8_t cmai_button_scan(uint8_t id)
+{
+    cma_button_t *button = &cma_button[id];
+    const cma_button_config_t *config = &button->config;
+
+    if (cmai_button_raw_pressed (button) != button->pressed)
+    {
+        button->bounce_ms += CMA_BUTTON_SCAN_MS;
+        if (button->bounce_ms >= CMA_BUTTON_DEBOUNCE_MS)
+        {
+            button->bounce_ms = 0;
+            button->pressed = !button->pressed;
+            if (button->pressed)
+            {
+                cmai_button_on_press (id);
+            }
+            else
+            {
+                cmai_button_on_release (id);
+            }
+        }
+    }
+    else
+    {
+        button->bounce_ms = 0;
+    }
+
+    if (button->pressed)
+    {
+        if (!button->long_sent)
+        {
+            button->held_ms += CMA_BUTTON_SCAN_MS;
+            if (config->long_ms != 0 && button->held_ms >= config->long_ms)
+            {
+                /* A click waiting for its double can no longer get one, it was a short press */
+                if (button->clicks != 0)
+                {
+                    button->clicks = 0;
+                    cmai_button_event (id, CMA_BUTTON_EVENT_SHORT);
+                }
+
+                button->long_sent = 1;
+                cmai_button_event (id, CMA_BUTTON_EVENT_LONG);
+            }
+        }
+        else if (config->repeat_ms != 0)
+        {
+            button->repeat_ms += CMA_BUTTON_SCAN_MS;
+            if (button->repeat_ms >= config->repeat_ms)
+            {
+                button->repeat_ms = 0;
+                cmai_button_event (id, CMA_BUTTON_EVENT_HOLD_REPEAT);
+            }
+        }
+    }
+    else if (button->clicks != 0 && button->bounce_ms == 0)
+    {
+        button->gap_ms += CMA_BUTTON_SCAN_MS;
+        if (button->gap_ms >= config->double_ms)
+        {
+            button->clicks = 0;
+            cmai_button_event (id, CMA_BUTTON_EVENT_SHORT);
+        }
+    }
+
+    return button->pressed || button->clicks != 0 || button->bounce_ms != 0;
+}
+
+static void cmai_button_timer_callback(TimerHandle_t pxTime)
+{
+    uint8_t id, active = 0;
+
+    DA16X_UNUSED_ARG(pxTime);
+
+    for (id = 0; id < CMA_BUTTON_MAX; id++)
+    {
+        if (cma_button[id].used)
+        {
+            active |= cmai_button_scan (id);
+        }
+    }
+
+    if (active)
+    {
+        return;
+    }
+
+    /* Stop before clearing the flag, so a press from now on starts the timer again. A press
+     * between the last sample and the flag is caught by sampling once more. */
+    OS_TIMER_STOP(cma_button_timer, 0);
+    cma_button_scanning = 0;
+
+    for (id = 0; id < CMA_BUTTON_MAX; id++)
+    {
+        if (cma_button[id].used && cmai_button_raw_pressed (&cma_button[id]))
+        {
+            cma_button_scanning = 1;
+            OS_TIMER_START(cma_button_timer, 0);
+            break;
+        }
+    }
+}
+
+static void cmai_button_int_handler(void *param)
+{
+    DA16X_UNUSED_ARG(param);
+
+    /* every button is sampled by timer, so the pin is not needed */
+    if (!cma_button_scanning)
+    {
+        cma_button_scanning = 1;
+        OS_TIMER_START_FROM_ISR(cma_button_timer);
+    }
+}
+
+CMA_STATUS_TYPE cma_button_add(const cma_button_config_t *config, uint8_t *id)
+{
+    CMA_INT_TYPE int_type;
+    uint8_t i;
+
+    if (config == NULL || id == NULL)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    if (cma_button_timer == NULL)
+    {
+        cma_button_timer = OS_TIMER_CREATE("CMA_BUTTON", portCONVERT_MS_2_TICKS(CMA_BUTTON_SCAN_MS), pdTRUE,
+                                           (void* )0, cmai_button_timer_callback);
+        if (cma_button_timer == NULL)
+        {
+            return CMA_STATUS_FAIL;
+        }
+    }
+
+    for (i = 0; i < CMA_BUTTON_MAX; i++)
+    {
+        if (!cma_button[i].used)
+        {
+            break;
+        }
+    }
+
+    if (i == CMA_BUTTON_MAX)
+    {
+        LOG(LOG_ERR, "No free button (max %d)", CMA_BUTTON_MAX);
+        return CMA_STATUS_FAIL;
+    }
+
+    if (cma_gpio_set_input (config->port, config->pin, config->pull) == CMA_STATUS_FAIL)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    memset (&cma_button[i], 0, sizeof(cma_button_t));
+    cma_button[i].config = *config;
+    cma_button[i].used = 1;
+
+    int_type = (config->active_level == CMA_GPIO_LEVEL_HIGH) ? CMA_INT_EDGE_ACTIVE_HIGH : CMA_INT_EDGE_ACTIVE_LOW;
+    if (cma_gpio_set_interrupt (config->port, config->pin, int_type, cmai_button_int_handler) == CMA_STATUS_FAIL)
+    {
+        cma_button[i].used = 0;
+        return CMA_STATUS_FAIL;
+    }
+
+    *id = i;
+
+    return CMA_STATUS_OK;
+}
+
+CMA_STATUS_TYPE cma_button_remove(uint8_t id)
+{
+    if (id >= CMA_BUTTON_MAX || !cma_button[id].used)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    cma_gpio_set_interrupt_disable (cma_button[id].config.port, cma_button[id].config.pin);
+    cma_button[id].used = 0;
+
+    return CMA_STATUS_OK;
+}
+
+uint8_t cma_button_is_pressed(uint8_t id)
+{
+    if (id >= CMA_BUTTON_MAX || !cma_button[id].used)
+    {
+        return 0;
+    }
+
+    return cma_button[id].pressed;
+}
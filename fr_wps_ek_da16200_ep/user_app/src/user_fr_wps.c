@@ -40,6 +40,7 @@
 #include "nvedit.h"
 #include "cma_debug.h"
 #include "cma_gpio.h"
+#include "cma_button.h"
 #include "cma_osal.h"
 #include "user_hw_pin_config.h"
 #include "user_fr_wps.h"
@@ -49,24 +50,18 @@
 #define USER_FR_WPS_TASK_STACK_SZ   	(256 * 4)
 #define USER_FR_WPS_TASK_PRI        	OS_TASK_PRIORITY_USER
 
-#define USER_FACTORY_RESET_INT          (1 << 0)
-#define USER_FACTORY_RESET_RUN          (1 << 1)
-#define USER_WPS_INT                    (1 << 2)
-#define USER_RTC_WAKEUP2_PIN_INT        (1 << 3)
+#define USER_FACTORY_RESET_PRESS        (1 << 0)
+#define USER_FACTORY_RESET_RELEASE      (1 << 1)
+#define USER_FACTORY_RESET_RUN          (1 << 2)
+#define USER_WPS_INT                    (1 << 3)
+#define USER_RTC_WAKEUP2_PIN_INT        (1 << 4)
 
 #define USER_FACTORY_RESET_TIME         5000  /* 5 sec */
 
-typedef enum
-{
-    USER_FACTORY_STATE_PRESS,
-    USER_FACTORY_STATE_RELEASE
-} USER_FACTORY_STATE;
-
 int32_t debug_level = LOG_INFO;
 
 /* Local variable */
 static OS_TASK xTask = NULL;
-static OS_TIMER user_factory_reset_timer = NULL;
 
 /* Local functions */
 static CMA_STATUS_TYPE user_wps_setup(char *macaddr)
@@ -123,59 +118,73 @@ static void user_rtc_wakeup2_pin_int_handler(void *param)
     }
 }
 
-static void user_wps_int_handler(void *param)
+/* Called in timer task */
+static void user_factory_reset_button_callback(uint8_t id, CMA_BUTTON_EVENT event, void *arg)
 {
-    DA16X_UNUSED_ARG(param);
+    uint32_t bits = 0;
 
-    if (xTask)
+    DA16X_UNUSED_ARG(id);
+    DA16X_UNUSED_ARG(arg);
+
+    switch (event)
     {
-        OS_TASK_NOTIFY_FROM_ISR(xTask, USER_WPS_INT, OS_NOTIFY_SET_BITS);
+        case CMA_BUTTON_EVENT_PRESS:
+            bits = USER_FACTORY_RESET_PRESS;
+        break;
+        case CMA_BUTTON_EVENT_RELEASE:
+            bits = USER_FACTORY_RESET_RELEASE;
+        break;
+        case CMA_BUTTON_EVENT_LONG:
+            bits = USER_FACTORY_RESET_RUN;
+        break;
+        default:
+        break;
     }
-}
 
-static void user_factory_reset_int_handler(void *param)
-{
-    DA16X_UNUSED_ARG(param);
-
-    if (xTask)
+    if (xTask && bits)
     {
-        OS_TASK_NOTIFY_FROM_ISR(xTask, USER_FACTORY_RESET_INT, OS_NOTIFY_SET_BITS);
+        OS_TASK_NOTIFY(xTask, bits, OS_NOTIFY_SET_BITS);
     }
 }
 
-static void user_factory_reset_timer_callback(TimerHandle_t pxTime)
+/* Called in timer task */
+static void user_wps_button_callback(uint8_t id, CMA_BUTTON_EVENT event, void *arg)
 {
-    DA16X_UNUSED_ARG(pxTime);
+    DA16X_UNUSED_ARG(id);
+    DA16X_UNUSED_ARG(arg);
 
-    if (xTask)
+    if (xTask && event == CMA_BUTTON_EVENT_SHORT)
     {
-        OS_TASK_NOTIFY_FROM_ISR(xTask, USER_FACTORY_RESET_RUN, OS_NOTIFY_SET_BITS);
+        OS_TASK_NOTIFY(xTask, USER_WPS_INT, OS_NOTIFY_SET_BITS);
     }
 }
 
 static void user_gpio_sets_interrupt(void)
 {
+    cma_button_config_t button;
+    uint8_t id;
+
     if (cma_gpio_set_rtc_wakeup_pin (CMA_RTC_WAKEUP2_PIN, CMA_INT_EDGE_ACTIVE_LOW, user_rtc_wakeup2_pin_int_handler)
             == CMA_STATUS_FAIL)
     {
         configASSERT(0);
     }
 
-    user_factory_reset_timer = OS_TIMER_CREATE("USER_FT_RESET", portCONVERT_MS_2_TICKS(USER_FACTORY_RESET_TIME), pdTRUE,
-                                               (void* )0, user_factory_reset_timer_callback);
-
     if (cma_gpio_set_func (USER_FACTORY_GPIO_FUNC_PIN) == CMA_STATUS_FAIL)
     {
         configASSERT(0);
     }
 
-    if (cma_gpio_set_input (USER_FACTORY_GIPO_PORT, USER_FACTORY_GPIO_NUM, CMA_GPIO_HIGH_Z) == CMA_STATUS_FAIL)
-    {
-        configASSERT(0);
-    }
+    /* Factory reset : held for 5 sec */
+    memset (&button, 0, sizeof(cma_button_config_t));
+    button.port = USER_FACTORY_GIPO_PORT;
+    button.pin = USER_FACTORY_GPIO_NUM;
+    button.pull = CMA_GPIO_HIGH_Z;
+    button.active_level = CMA_GPIO_LEVEL_LOW;
+    button.long_ms = USER_FACTORY_RESET_TIME;
+    button.callback = user_factory_reset_button_callback;
 
-    if (cma_gpio_set_interrupt (USER_FACTORY_GIPO_PORT, USER_FACTORY_GPIO_NUM, CMA_INT_EDGE_ACTIVE_LOW,
-                                user_factory_reset_int_handler) == CMA_STATUS_FAIL)
+    if (cma_button_add (&button, &id) == CMA_STATUS_FAIL)
     {
         configASSERT(0);
     }
@@ -185,13 +194,15 @@ static void user_gpio_sets_interrupt(void)
         configASSERT(0);
     }
 
-    if (cma_gpio_set_input (USER_WPS_GIPO_PORT, USER_WPS_GPIO_NUM, CMA_GPIO_HIGH_Z) == CMA_STATUS_FAIL)
-    {
-        configASSERT(0);
-    }
+    /* WPS : short press */
+    memset (&button, 0, sizeof(cma_button_config_t));
+    button.port = USER_WPS_GIPO_PORT;
+    button.pin = USER_WPS_GPIO_NUM;
+    button.pull = CMA_GPIO_HIGH_Z;
+    button.active_level = CMA_GPIO_LEVEL_LOW;
+    button.callback = user_wps_button_callback;
 
-    if (cma_gpio_set_interrupt (USER_WPS_GIPO_PORT, USER_WPS_GPIO_NUM, CMA_INT_EDGE_ACTIVE_LOW, user_wps_int_handler)
-            == CMA_STATUS_FAIL)
+    if (cma_button_add (&button, &id) == CMA_STATUS_FAIL)
     {
         configASSERT(0);
     }
@@ -202,7 +213,6 @@ static void user_fr_wps_task(void *arg)
     DA16X_UNUSED_ARG(arg);
 
     int8_t wdog_id;
-    USER_FACTORY_STATE factory_rest_state = USER_FACTORY_STATE_RELEASE;
 
     LOG(LOG_INFO, "Start user_fr_wps_task!");
 
@@ -234,39 +244,14 @@ static void user_fr_wps_task(void *arg)
         /* Resume watchdog */
         da16x_sys_watchdog_notify_and_resume (wdog_id);
 
-        if (notif & USER_FACTORY_RESET_INT)
+        if (notif & USER_FACTORY_RESET_PRESS)
+        {
+            LOG(LOG_INFO, "Factory reset : Pressed \n");
+        }
+
+        if (notif & USER_FACTORY_RESET_RELEASE)
         {
-            if (factory_rest_state == USER_FACTORY_STATE_RELEASE)
-            {
-                if (cma_gpio_get_input (USER_FACTORY_GIPO_PORT, USER_FACTORY_GPIO_NUM) == CMA_GPIO_LEVEL_LOW)
-                {
-                    factory_rest_state = USER_FACTORY_STATE_PRESS;
-                    if (cma_gpio_set_interrupt (USER_FACTORY_GIPO_PORT, USER_FACTORY_GPIO_NUM, CMA_INT_EDGE_ACTIVE_HIGH,
-                                                user_factory_reset_int_handler) == CMA_STATUS_FAIL)
-                    {
-                        configASSERT(0);
-                    }
-
-                    OS_TIMER_START(user_factory_reset_timer, portCONVERT_MS_2_TICKS(USER_FACTORY_RESET_TIME));
-                    LOG(LOG_INFO, "Factory reset : Pressed \n");
-                }
-                else
-                {
-                    LOG(LOG_INFO, "Factory reset : Already released \n");
-                }
-            }
-            else if (factory_rest_state == USER_FACTORY_STATE_PRESS)
-            {
-                OS_TIMER_STOP(user_factory_reset_timer, 0);
-                if (cma_gpio_set_interrupt (USER_FACTORY_GIPO_PORT, USER_FACTORY_GPIO_NUM, CMA_INT_EDGE_ACTIVE_LOW,
-                                            user_factory_reset_int_handler) == CMA_STATUS_FAIL)
-                {
-                    configASSERT(0);
-                }
-
-                factory_rest_state = USER_FACTORY_STATE_RELEASE;
-                LOG(LOG_INFO, "Factory reset : Released\n");
-            }
+            LOG(LOG_INFO, "Factory reset : Released\n");
         }
 
         if (notif & USER_FACTORY_RESET_RUN)
@@ -33,8 +33,12 @@
 #ifndef CMA_DEBUG_H_
 #define CMA_DEBUG_H_
 
+#if defined(CMA_SLEEP_SIM)
+#include "cma_sleep_sim.h"
+#else
 #include "da16x_system.h"
 #include "task.h"
+#endif
 
 #define configLOG_SIMPLE	(1)
 
@@ -68,6 +72,18 @@ void cma_assert_func(const uint8_t *pcFileName, uint32_t ulLineNumber);
 
 extern int32_t debug_level;
 
+/* Class of wake-up reason returned by da16x_boot_get_wakeupmode */
+typedef enum
+{
+    CMA_WAKEUP_CLASS_POWER_ON,
+    CMA_WAKEUP_CLASS_RESET,
+    CMA_WAKEUP_CLASS_TIMER,
+    CMA_WAKEUP_CLASS_EXTERNAL,
+    CMA_WAKEUP_CLASS_SENSOR,
+    CMA_WAKEUP_CLASS_WATCHDOG,
+    CMA_WAKEUP_CLASS_UNKNOWN
+} CMA_WAKEUP_CLASS;
+
 /**
  ****************************************************************************************
  * @brief Start a function for checking lowest heap with interval periodically.
@@ -100,4 +116,37 @@ void cma_heap_check_stop(void);
  */
 void cma_printout_wakeup_reason(void);
 
+/**
+ ****************************************************************************************
+ * @brief Get description of wakeup reason.
+ *
+ * @param[in] wakeup reason (da16x_boot_get_wakeupmode).
+ *
+ * @return description, "unknown" for a code not in the table.
+ ****************************************************************************************
+ */
+const char* cma_wakeup_reason_name(uint32_t reason);
+
+/**
+ ****************************************************************************************
+ * @brief Get class of wakeup reason.
+ *
+ * @param[in] wakeup reason (da16x_boot_get_wakeupmode).
+ *
+ * @return class, CMA_WAKEUP_CLASS_UNKNOWN for a code not in the table.
+ ****************************************************************************************
+ */
+CMA_WAKEUP_CLASS cma_wakeup_reason_class(uint32_t reason);
+
+/**
+ ****************************************************************************************
+ * @brief Get name of wakeup class.
+ *
+ * @param[in] class.
+ *
+ * @return name.
+ ****************************************************************************************
+ */
+const char* cma_wakeup_class_name(CMA_WAKEUP_CLASS cls);
+
 #endif /* CMA_DEBUG_H_ */
@@ -0,0 +1,285 @@
+/**
+ ****************************************************************************************
+ *
+ * @file cma_flash.h
+ *
+ * @brief User Flash functions.
+ *
+ * Copyright (c) 2016-2024 Renesas Electronics. All rights reserved.
+ *
+ * This software ("Software") is owned by Renesas Electronics.
+ *
+ * By using this Software you agree that Renesas Electronics retains all
+ * intellectual property and proprietary rights in and to this Software and any
+ * use, reproduction, disclosure or distribution of the Software without express
+ * written permission or a license agreement from Renesas Electronics is
+ * strictly prohibited. This Software is solely for use on or in conjunction
+ * with Renesas Electronics products.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE
+ * SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. EXCEPT AS OTHERWISE
+ * PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * RENESAS ELECTRONICS BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL,
+ * OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ *
+ ****************************************************************************************
+ */
+
+#ifndef CMA_FLASH_H_
+
+#define CMA_FLASH_H_
+
+#if defined(CMA_FLASH_SIM)
+#include <stdint.h>
+#else
+#include "da16x_types.h"
+#include "da16200_ioconfig.h"
+#endif
+#include "cma_status.h"
+
+/* Maximum number of sectors covered by the integrity index */
+#define CMA_FLASH_INDEX_MAX_SECTORS     128
+
+/* Maximum number of ranges mapped at the same time */
+#define CMA_FLASH_MAP_MAX               4
+
+typedef enum
+{
+    CMA_FLASH_INDEX_STATE_UNTRACKED = 0,
+    CMA_FLASH_INDEX_STATE_VALID,
+    CMA_FLASH_INDEX_STATE_INFLIGHT,
+    CMA_FLASH_INDEX_STATE_DAMAGED
+} CMA_FLASH_INDEX_STATE;
+
+/**
+ ****************************************************************************************
+ * @brief Init resource for flash driver.
+ *
+ * @param[in] None
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_flash_init(void);
+
+/**
+ ****************************************************************************************
+ * @brief Delete resource for flash driver.
+ *
+ * @param[in] None
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_flash_delete(void);
+
+/**
+ ****************************************************************************************
+ * @brief Open flash driver.
+ *
+ * @param[in] None.
+ *
+ * @return handle pointer.
+ ****************************************************************************************
+ */
+void* cma_flash_open(void);
+
+/**
+ ****************************************************************************************
+ * @brief Write data to flash.
+ *
+ * @param[in] handle pointer.
+ * @param[in] address of flash.
+ * @param[in] data pointer.
+ * @param[in] size of data.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_flash_write(void *handle, uint32_t startAddress, uint8_t *newData, uint32_t dataLength);
+
+/**
+ ****************************************************************************************
+ * @brief read data from flash.
+ *
+ * @param[in] handle pointer.
+ * @param[in] address of flash.
+ * @param[in] data pointer.
+ * @param[in] size of data.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_flash_read(void *handle, uint32_t startAddress, uint8_t *readData, uint32_t dataLength);
+
+/**
+ ****************************************************************************************
+ * @brief erase data in flash.
+ *
+ * @param[in] handle pointer.
+ * @param[in] address of flash.
+ * @param[in] size of data.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_flash_erase(void *handle, uint32_t startAddress, uint32_t dataLength);
+
+/**
+ ****************************************************************************************
+ * @brief Program data into erased area without erasing the sector.
+ *
+ * Bits can only be cleared, so the area must be erased before (e.g. append-only logs).
+ * Sectors tracked by integrity index must be written with cma_flash_write instead.
+ *
+ * @param[in] handle pointer.
+ * @param[in] start address of flash.
+ * @param[in] data pointer.
+ * @param[in] data length.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_flash_program(void *handle, uint32_t startAddress, uint8_t *data, uint32_t dataLength);
+
+/**
+ ****************************************************************************************
+ * @brief close flash driver.
+ *
+ * @param[in] handle pointer.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_flash_close(void *handle);
+
+/**
+ ****************************************************************************************
+ * @brief Put flash in deep power down, it is released by the next cma_flash_open.
+ *
+ * @param[in] handle pointer, closed after.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_flash_power_down(void *handle);
+
+/**
+ ****************************************************************************************
+ * @brief Get number of sectors erased since cma_flash_init.
+ *
+ * @param[in] None.
+ *
+ * @return erase count.
+ ****************************************************************************************
+ */
+uint32_t cma_flash_get_erase_count(void);
+
+/**
+ ****************************************************************************************
+ * @brief Open integrity index of a data area.
+ *
+ * The index keeps CRC and generation of each sector of the area in two sectors at indexAddress.
+ * It is updated whenever cma_flash_write or cma_flash_erase touches a sector of the area.
+ * If no valid index is found, it is built once by reading the whole area.
+ * Index state is in RAM, so it is read again from its sectors on each boot, also after a
+ * wake-up from sleep 3. Examples using DPM do not open an index.
+ *
+ * @param[in] handle pointer.
+ * @param[in] start address of data area (sector aligned).
+ * @param[in] size of data area.
+ * @param[in] address of 2 sectors for index (outside data area).
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_flash_index_open(void *handle, uint32_t areaStart, uint32_t areaLength, uint32_t indexAddress);
+
+/**
+ ****************************************************************************************
+ * @brief Boot-time integrity check.
+ *
+ * Only sectors whose write was in-flight at reset are read. They are committed if the new
+ * contents were written, rolled back if the old contents are intact, or marked as damaged.
+ *
+ * @param[in] handle pointer.
+ * @param[out] number of damaged sectors (can be NULL).
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_flash_index_check(void *handle, uint32_t *damagedSectors);
+
+/**
+ ****************************************************************************************
+ * @brief Full integrity check. Every sector of the area is read and compared with the index.
+ *
+ * @param[in] handle pointer.
+ * @param[out] number of damaged sectors (can be NULL).
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_flash_index_verify(void *handle, uint32_t *damagedSectors);
+
+/**
+ ****************************************************************************************
+ * @brief Get integrity state of the sector including the address.
+ *
+ * A damaged sector becomes valid again when it is rewritten with cma_flash_write.
+ *
+ * @param[in] address of flash.
+ *
+ * @return state of sector.
+ ****************************************************************************************
+ */
+CMA_FLASH_INDEX_STATE cma_flash_index_get_state(uint32_t address);
+
+/**
+ ****************************************************************************************
+ * @brief Close integrity index. Writes are not tracked any more.
+ *
+ * @param[in] None.
+ *
+ * @return None.
+ ****************************************************************************************
+ */
+void cma_flash_index_close(void);
+
+/**
+ ****************************************************************************************
+ * @brief Map a range of user area for read in place.
+ *
+ * Returns a pointer into the XIP cache window, so read-only data (tables, certificates)
+ * can be used without copying it into heap. The range must not be written while it is
+ * mapped. Writes or erases of a mapped range through cma_flash invalidate the cache, and
+ * the cache is invalidated here if the flash was updated since, so a range written while
+ * unmapped is not read from stale cache lines.
+ *
+ * @param[in] handle pointer.
+ * @param[in] start address of flash (user area).
+ * @param[in] data length.
+ *
+ * @return const pointer to mapped data or NULL.
+ ****************************************************************************************
+ */
+const uint8_t* cma_flash_map(void *handle, uint32_t startAddress, uint32_t dataLength);
+
+/**
+ ****************************************************************************************
+ * @brief Unmap a range mapped by cma_flash_map.
+ *
+ * @param[in] handle pointer.
+ * @param[in] pointer returned by cma_flash_map.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_flash_unmap(void *handle, const uint8_t *mapped);
+
+#endif /* CMA_FLASH_H_ */
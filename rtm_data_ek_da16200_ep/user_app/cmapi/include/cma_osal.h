@@ -33,7 +33,9 @@
 #ifndef USER_OSAL_H_
 #define USER_OSAL_H_
 
+#if !defined(CMA_SLEEP_SIM)
 #define FREERTOS
+#endif
 
 #if defined(FREERTOS)
 
@@ -1298,6 +1300,41 @@ typedef enum
 
 #endif
 
+#if defined(CMA_SLEEP_SIM)
+#include "cma_sleep_sim.h"
+/*
+ * Host simulation of DPM (cma_sleep_sim.c). There is one task, so mutexes are always
+ * taken and waiting for an event advances the virtual RTC up to the timeout.
+ */
+# define OS_MUTEX                void*
+# define OS_MUTEX_CREATE_SUCCESS 1
+# define OS_MUTEX_FOREVER        0xFFFFFFFF
+# define OS_MUTEX_CREATE(mutex)  do { (mutex) = (void*) 1; } while (0)
+# define OS_MUTEX_GET(mutex, timeout) cma_sleep_sim_nop(mutex)
+# define OS_MUTEX_PUT(mutex)     cma_sleep_sim_nop(mutex)
+
+# define OS_EVENT                void*
+# define OS_EVENT_FOREVER        0xFFFFFFFF
+# define OS_EVENT_CREATE(event)  do { (event) = (void*) 1; } while (0)
+# define OS_EVENT_SIGNAL(event)  cma_sleep_sim_nop(event)
+# define OS_EVENT_WAIT(event, timeout) cma_sleep_sim_wait(timeout)
+
+# define OS_TIMER                void*
+# define OS_TIMER_FOREVER        0xFFFFFFFF
+# define OS_TIMER_CREATE(name, period, reload, timer_id, callback) ((void) (callback), (OS_TIMER) NULL)
+# define OS_TIMER_START(timer, timeout) cma_sleep_sim_nop(timer)
+# define OS_TIMER_STOP(timer, timeout) cma_sleep_sim_nop(timer)
+# define OS_TIMER_DELETE(timer, timeout) cma_sleep_sim_nop(timer)
+
+# define OS_PERIOD_MS            1
+# define OS_TIME_TO_TICKS(time_in_ms) (time_in_ms)
+# define OS_GET_TICK_COUNT()     cma_sleep_sim_tick()
+# define OS_MALLOC               malloc
+# define OS_FREE                 free
+# define OS_ASSERT               configASSERT
+
+#endif /* CMA_SLEEP_SIM */
+
 /**
  * \brief Cast any pointer to unsigned int value
  */
@@ -0,0 +1,136 @@
+/**
+ ****************************************************************************************
+ *
+ * @file cma_rtm_counter.h
+ *
+ * @brief Counters in retention memory with checkpoints in flash.
+ *
+ * Copyright (c) 2016-2024 Renesas Electronics. All rights reserved.
+ *
+ * This software ("Software") is owned by Renesas Electronics.
+ *
+ * By using this Software you agree that Renesas Electronics retains all
+ * intellectual property and proprietary rights in and to this Software and any
+ * use, reproduction, disclosure or distribution of the Software without express
+ * written permission or a license agreement from Renesas Electronics is
+ * strictly prohibited. This Software is solely for use on or in conjunction
+ * with Renesas Electronics products.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE
+ * SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. EXCEPT AS OTHERWISE
+ * PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * RENESAS ELECTRONICS BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL,
+ * OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ *
+ ****************************************************************************************
+ */
+
+#ifndef CMA_RTM_COUNTER_H_
+
+#define CMA_RTM_COUNTER_H_
+
+#include "da16x_types.h"
+#include "cma_status.h"
+#include "cma_sleep.h"
+
+/* Maximum number of counters */
+#define CMA_RTM_COUNTER_MAX             16
+
+/*
+ *****************************************************
+ * Counters are incremented in retention memory and checkpointed to a flash log of
+ * 2 sectors. Checkpoints are appended into erased area, and a sector is erased only
+ * when the log is full. Latest values are restored from the log when retention
+ * memory is lost (power-on reset, sleep 2).
+ ******************************************************
+ */
+
+/* Checkpoint policy, 0 disables each condition */
+typedef struct
+{
+    uint32_t every_count;       /* after N increments */
+    uint32_t every_sec;         /* after T seconds (RTC time, including sleep) */
+    uint8_t before_sleep2;      /* before CMA_SLEEP_TYPE_2 */
+} cma_rtm_counter_policy_t;
+
+/**
+ ****************************************************************************************
+ * @brief Open counters. cma_rtm_data_init and cma_flash_init must be called before.
+ *
+ * @param[in] start address of flash log (2 sectors, sector aligned)
+ * @return Success or Fail
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_rtm_counter_init(uint32_t flashAddress);
+
+/**
+ ****************************************************************************************
+ * @brief Open a counter, its value is kept or restored from flash.
+ *
+ * @param[in] unique name for the counter
+ * @param[in] checkpoint policy
+ * @param[out] id of counter
+ * @return Success or Fail
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_rtm_counter_open(const char *tag, const cma_rtm_counter_policy_t *policy, uint32_t *id);
+
+/**
+ ****************************************************************************************
+ * @brief Add to a counter. A checkpoint is written when the policy requires it.
+ *
+ * @param[in] id of counter
+ * @param[in] value to add
+ * @return value of counter
+ ****************************************************************************************
+ */
+uint32_t cma_rtm_counter_add(uint32_t id, uint32_t delta);
+
+/**
+ ****************************************************************************************
+ * @brief Set a counter, e.g. to keep a value that is not a count.
+ * The value is written at the next checkpoint of cma_rtm_counter_checkpoint, or of
+ * the every_sec and before_sleep2 policies.
+ * @param[in] id of counter
+ * @param[in] value
+ * @return Success or Fail
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_rtm_counter_set(uint32_t id, uint32_t value);
+
+/**
+ ****************************************************************************************
+ * @brief Get value of a counter.
+ *
+ * @param[in] id of counter
+ * @return value of counter
+ ****************************************************************************************
+ */
+uint32_t cma_rtm_counter_get(uint32_t id);
+
+/**
+ ****************************************************************************************
+ * @brief Write checkpoints of all counters changed since their last checkpoint.
+ *
+ * @param[in] None
+ * @return Success or Fail
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_rtm_counter_checkpoint(void);
+
+/**
+ ****************************************************************************************
+ * @brief Apply policies before sleep. Call before cma_sleep_trigger.
+ *
+ * @param[in] sleep type
+ * @return Success or Fail
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_rtm_counter_sleep(CMA_SLEEP_TYPE type);
+
+#endif /* CMA_RTM_COUNTER_H_ */
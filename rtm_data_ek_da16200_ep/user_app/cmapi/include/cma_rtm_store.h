@@ -0,0 +1,115 @@
+/**
+ ****************************************************************************************
+ *
+ * @file cma_rtm_store.h
+ *
+ * @brief Tiered state store on retention memory and flash.
+ *
+ * Copyright (c) 2016-2024 Renesas Electronics. All rights reserved.
+ *
+ * This software ("Software") is owned by Renesas Electronics.
+ *
+ * By using this Software you agree that Renesas Electronics retains all
+ * intellectual property and proprietary rights in and to this Software and any
+ * use, reproduction, disclosure or distribution of the Software without express
+ * written permission or a license agreement from Renesas Electronics is
+ * strictly prohibited. This Software is solely for use on or in conjunction
+ * with Renesas Electronics products.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE
+ * SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. EXCEPT AS OTHERWISE
+ * PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * RENESAS ELECTRONICS BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL,
+ * OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ *
+ ****************************************************************************************
+ */
+
+#ifndef CMA_RTM_STORE_H_
+
+#define CMA_RTM_STORE_H_
+
+#include "da16x_types.h"
+#include "cma_status.h"
+
+/* Maximum number of records in store */
+#define CMA_RTM_STORE_RECORD_MAX        16
+
+/* Free slots of the largest record kept in a compacted half when a record is added */
+#define CMA_RTM_STORE_HEADROOM_SLOTS    4
+
+/*
+ *****************************************************
+ * Records are kept in retention memory (hot) or in a flash area (cold).
+ * Accesses are counted per record, and cma_rtm_store_rebalance moves the most
+ * used records into retention memory and the others into flash.
+ * Read and write are the same wherever the record is.
+ *
+ * Flash area is an append-only log in two halves, each value written to flash is a slot
+ * with tag hash, size and checks. A write of a cold record programs erased area, and a
+ * half is erased only when the other one is full (latest slots are copied there), so
+ * writing N bytes erases a half about once per ((half size - used) / (N + 20)) writes, where
+ * used is the latest slots of all records. A new record is refused when used would leave less
+ * than CMA_RTM_STORE_HEADROOM_SLOTS slots of the largest record free, so even a full store
+ * erases at most once per CMA_RTM_STORE_HEADROOM_SLOTS writes.
+ * Directory is in retention memory and is rebuilt from the latest slots when it is lost.
+ * A record then reads its last value written to flash, a record that never left
+ * retention memory is lost with it.
+ ******************************************************
+ */
+
+/**
+ ****************************************************************************************
+ * @brief Open store. cma_rtm_data_init and cma_flash_init must be called before.
+ *
+ * @param[in] bytes of retention memory for hot records
+ * @param[in] start address of flash area for cold records (sector aligned)
+ * @param[in] size of flash area (multiple of 2 sectors)
+ * @return Success or Fail
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_rtm_store_init(uint32_t rtmBudget, uint32_t flashAddress, uint32_t flashLength);
+
+/**
+ ****************************************************************************************
+ * @brief Write a record. A new record is placed in retention memory if it fits, otherwise in flash.
+ *
+ * @param[in] unique name for the record
+ * @param[in] data
+ * @param[in] size of data (fixed after first write)
+ * @return Success or Fail
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_rtm_store_write(const char *tag, const void *data, uint16_t len);
+
+/**
+ ****************************************************************************************
+ * @brief Read a record.
+ *
+ * @param[in] unique name for the record
+ * @param[out] data
+ * @param[in] size of data
+ * @return Success or Fail (not found or different size)
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_rtm_store_read(const char *tag, void *data, uint16_t len);
+
+/**
+ ****************************************************************************************
+ * @brief Place the most accessed records in retention memory, e.g. before sleep.
+ *
+ * Access counts are halved after each call, so placement follows recent usage.
+ * Each record moved out of retention memory is appended to the flash log.
+ *
+ * @param[in] None
+ * @return Success or Fail
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_rtm_store_rebalance(void);
+
+#endif /* CMA_RTM_STORE_H_ */
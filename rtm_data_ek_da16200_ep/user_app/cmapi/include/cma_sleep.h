@@ -33,18 +33,174 @@
 #ifndef CMA_SLEEP_H_
 #define CMA_SLEEP_H_
 
+#if defined(CMA_SLEEP_SIM)
+#include <stdint.h>
+#else
 #include "da16x_types.h"
 #include "da16200_ioconfig.h"
+#endif
+#include "cma_status.h"
+
+/* Maximum number of wake requests */
+#define CMA_SLEEP_REQUEST_MAX           8
+
+/* Deadlines within this window of the earliest one are served by the same wake-up */
+#ifndef CMA_SLEEP_REQUEST_MERGE_MS
+#define CMA_SLEEP_REQUEST_MERGE_MS      500
+#endif
+
+/* Maximum number of wake locks */
+#define CMA_SLEEP_LOCK_MAX              8
+
+/* Maximum number of pre-sleep and post-wake hooks */
+#define CMA_SLEEP_HOOK_MAX              8
+
+/* Number of runs an optional hook is deferred after it exceeded its budget */
+#ifndef CMA_SLEEP_HOOK_DEFER_MAX
+#define CMA_SLEEP_HOOK_DEFER_MAX        4
+#endif
+
+/* Hook flags */
+#define CMA_SLEEP_HOOK_MANDATORY        0x00    /* always run */
+#define CMA_SLEEP_HOOK_OPTIONAL         0x01    /* deferred after budget overrun */
+
+/*
+ * Cost model of CMA_SLEEP_TYPE_AUTO. Currents are typical values (nA) and should be
+ * measured on the board. Boot times (millisecond) are used until they are measured.
+ */
+#ifndef CMA_SLEEP_CURRENT_ACTIVE
+#define CMA_SLEEP_CURRENT_ACTIVE        25000000
+#endif
+#ifndef CMA_SLEEP_CURRENT_SLEEP2
+#define CMA_SLEEP_CURRENT_SLEEP2        1800
+#endif
+#ifndef CMA_SLEEP_CURRENT_SLEEP3
+#define CMA_SLEEP_CURRENT_SLEEP3        3400
+#endif
+#ifndef CMA_SLEEP_COLD_BOOT_DEFAULT
+#define CMA_SLEEP_COLD_BOOT_DEFAULT     250
+#endif
+#ifndef CMA_SLEEP_WARM_BOOT_DEFAULT
+#define CMA_SLEEP_WARM_BOOT_DEFAULT     50
+#endif
+
+/* Boot costs are saved again when one moved by more than 1/2^N of its saved value */
+#ifndef CMA_SLEEP_BOOT_SAVE_SHIFT
+#define CMA_SLEEP_BOOT_SAVE_SHIFT       3
+#endif
+
+/* Number of sleep cycles in rolling window of accounting */
+#ifndef CMA_SLEEP_ACCOUNT_DEPTH
+#define CMA_SLEEP_ACCOUNT_DEPTH         16
+#endif
+
+/* Maximum number of init steps measured by cma_sleep_resume_end */
+#define CMA_SLEEP_RESUME_STEP_MAX       8
+
+/* Maximum number of distinct wake-up reasons counted */
+#ifndef CMA_SLEEP_WAKE_REASON_MAX
+#define CMA_SLEEP_WAKE_REASON_MAX       16
+#endif
+
+/* Events per cycle at which the adaptive interval is halved */
+#ifndef CMA_SLEEP_ADAPT_BUSY_DEFAULT
+#define CMA_SLEEP_ADAPT_BUSY_DEFAULT    2
+#endif
+
+/* No pending wake request */
+#define CMA_SLEEP_REQUEST_NONE          0xFFFFFFFF
 
 typedef enum
 {
     CMA_SLEEP_TYPE_2,
-    CMA_SLEEP_TYPE_3
+    CMA_SLEEP_TYPE_3,
+    CMA_SLEEP_TYPE_AUTO         /* chosen by cma_sleep_auto_select */
 } CMA_SLEEP_TYPE;
 
+typedef enum
+{
+    CMA_SLEEP_HOOK_PRE_SLEEP,
+    CMA_SLEEP_HOOK_POST_WAKE
+} CMA_SLEEP_HOOK_TYPE;
+
+/* Pre-sleep hook or post-wake hook, type is never CMA_SLEEP_TYPE_AUTO */
+typedef void (*cma_sleep_hook_t)(CMA_SLEEP_TYPE type, void *arg);
+
+/* Boot costs kept outside retention memory, times in millisecond, 0 if not measured */
+typedef struct
+{
+    uint32_t cold_boot;
+    uint32_t warm_boot;
+} cma_sleep_boot_cost_t;
+
+/* Load saved boot costs, Fail if none */
+typedef CMA_STATUS_TYPE (*cma_sleep_boot_load_t)(cma_sleep_boot_cost_t *cost);
+
+/* Save boot costs, e.g. in flash */
+typedef void (*cma_sleep_boot_save_t)(const cma_sleep_boot_cost_t *cost);
+
+/* Sleep 2 cycle in progress kept outside retention memory, times in millisecond */
+typedef struct
+{
+    uint32_t sleep_time;        /* RTC time at power down, low 32 bits */
+    uint32_t awake;
+    uint32_t requested;
+} cma_sleep_pending_t;
+
+/* Load the saved cycle, Fail if none */
+typedef CMA_STATUS_TYPE (*cma_sleep_pending_load_t)(cma_sleep_pending_t *pending);
+
+/* Save the cycle, e.g. in flash */
+typedef void (*cma_sleep_pending_save_t)(const cma_sleep_pending_t *pending);
+
+/* One sleep cycle, times in millisecond */
+typedef struct
+{
+    uint32_t awake;             /* from wake-up (including boot) to sleep */
+    uint32_t requested;         /* requested sleep time, 0 for external wake-up only */
+    uint32_t actual;            /* measured sleep time */
+    uint8_t type;               /* CMA_SLEEP_TYPE */
+    uint8_t reason;             /* wake-up reason (da16x_boot_get_wakeupmode) */
+    uint16_t reserved;
+} cma_sleep_cycle_t;
+
+/* Rolling averages over the last CMA_SLEEP_ACCOUNT_DEPTH cycles */
+typedef struct
+{
+    uint32_t cycles;            /* cycles recorded since retention memory was initialized */
+    uint32_t samples;           /* cycles in rolling window */
+    uint32_t avg_awake;         /* millisecond */
+    uint32_t avg_sleep;         /* millisecond */
+    uint32_t duty_cycle;        /* awake time per 10000 */
+    uint32_t avg_current;       /* estimated from CMA_SLEEP_CURRENT_* (nA) */
+    int32_t avg_late;           /* actual minus requested sleep time of RTC timer wake-ups (millisecond) */
+    uint32_t early_wakes;       /* cycles in rolling window woken by another source before the timer */
+} cma_sleep_account_t;
+
+/* Wake-ups by one reason */
+typedef struct
+{
+    uint32_t count;
+    uint32_t last_time;         /* RTC time(second) of last wake-up */
+    uint8_t reason;             /* da16x_boot_get_wakeupmode */
+    uint8_t reserved[3];
+} cma_sleep_wake_stats_t;
+
+/* Statistics of a wake lock, times in millisecond */
+typedef struct
+{
+    uint32_t acquire_count;     /* number of times the lock was taken while free */
+    uint32_t timeout_count;     /* number of times the lock was released by timeout */
+    uint32_t total_hold;
+    uint32_t max_hold;
+} cma_sleep_lock_stats_t;
+
+/* Called from cma_sleep_request_dispatch when the deadline of the request expired */
+typedef void (*cma_sleep_wake_handler_t)(void *arg);
+
 /**
  ****************************************************************************************
- * @brief init sleep api.
+ * @brief init sleep api. Further calls are ignored.
  *
  * @param[in] None.
  *
@@ -57,6 +213,8 @@ void cma_sleep_init(void);
  ****************************************************************************************
  * @brief Trigger sleep.
  *
+ * Waits until no wake lock is held and runs pre-sleep hooks.
+ *
  * @param[in] sleep type.
  * @param[in] wakeup time(millisecond).
  *
@@ -65,4 +223,457 @@ void cma_sleep_init(void);
  */
 void cma_sleep_trigger(CMA_SLEEP_TYPE type, uint64_t wakeup_time);
 
+/**
+ ****************************************************************************************
+ * @brief Register a wake request.
+ *
+ * Deadlines are kept in retention memory, so they survive sleep 3. The request must be
+ * registered again with the same name after each boot to attach the handler.
+ * cma_rtm_data_init should be called before.
+ *
+ * @param[in] name of request.
+ * @param[in] handler called when deadline expired.
+ * @param[in] argument of handler.
+ * @param[out] request id.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_sleep_request_register(const char *name, cma_sleep_wake_handler_t handler, void *arg,
+                                           uint32_t *id);
+
+/**
+ ****************************************************************************************
+ * @brief Set deadline of a wake request.
+ *
+ * @param[in] request id.
+ * @param[in] time from now to deadline(millisecond). 0 cancels the request.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_sleep_request_set(uint32_t id, uint32_t delay);
+
+/**
+ ****************************************************************************************
+ * @brief Get time until the earliest deadline.
+ *
+ * @param[in] None.
+ *
+ * @return time(millisecond), 0 if a deadline expired or CMA_SLEEP_REQUEST_NONE.
+ ****************************************************************************************
+ */
+uint32_t cma_sleep_request_next(void);
+
+/**
+ ****************************************************************************************
+ * @brief Call handlers of expired requests.
+ *
+ * Requests expiring within CMA_SLEEP_REQUEST_MERGE_MS are served as well. A request is
+ * cleared before its handler is called, so the handler can set the next deadline.
+ *
+ * @param[in] None.
+ *
+ * @return number of handlers called.
+ ****************************************************************************************
+ */
+uint32_t cma_sleep_request_dispatch(void);
+
+/**
+ ****************************************************************************************
+ * @brief Sleep until the earliest deadline of all wake requests.
+ *
+ * Does not sleep if a deadline already expired, cma_sleep_request_dispatch should be
+ * called first.
+ *
+ * @param[in] sleep type.
+ *
+ * @return Fail if not sleeping.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_sleep_request_sleep(CMA_SLEEP_TYPE type);
+
+/**
+ ****************************************************************************************
+ * @brief Create a wake lock.
+ *
+ * @param[in] name of lock (kept as pointer).
+ * @param[out] lock id.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_sleep_lock_create(const char *name, uint32_t *id);
+
+/**
+ ****************************************************************************************
+ * @brief Acquire a wake lock. Locks are reference counted, sleep is entered only when no lock is held.
+ *
+ * @param[in] lock id.
+ * @param[in] time after which the lock is released anyway(millisecond). 0 for no timeout.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_sleep_lock_acquire(uint32_t id, uint32_t timeout);
+
+/**
+ ****************************************************************************************
+ * @brief Release a wake lock.
+ *
+ * @param[in] lock id.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_sleep_lock_release(uint32_t id);
+
+/**
+ ****************************************************************************************
+ * @brief Get number of held wake locks.
+ *
+ * @param[in] None.
+ *
+ * @return number of locks.
+ ****************************************************************************************
+ */
+uint32_t cma_sleep_lock_held(void);
+
+/**
+ ****************************************************************************************
+ * @brief Get statistics of a wake lock.
+ *
+ * @param[in] lock id.
+ * @param[out] statistics.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_sleep_lock_get_stats(uint32_t id, cma_sleep_lock_stats_t *stats);
+
+/**
+ ****************************************************************************************
+ * @brief Print statistics of all wake locks.
+ *
+ * @param[in] None.
+ *
+ * @return None.
+ ****************************************************************************************
+ */
+void cma_sleep_lock_print(void);
+
+/**
+ ****************************************************************************************
+ * @brief Register a pre-sleep or post-wake hook.
+ *
+ * Hooks run in order of priority (lower first). Pre-sleep hooks run in cma_sleep_trigger,
+ * post-wake hooks in cma_sleep_hook_run. The time of each run is measured, an optional hook
+ * which exceeded its budget is skipped for the next CMA_SLEEP_HOOK_DEFER_MAX runs.
+ * Statistics are kept in retention memory, cma_rtm_data_init should be called before.
+ *
+ * @param[in] pre-sleep or post-wake.
+ * @param[in] name of hook (kept as pointer).
+ * @param[in] priority.
+ * @param[in] time budget(microsecond).
+ * @param[in] flags (CMA_SLEEP_HOOK_MANDATORY or CMA_SLEEP_HOOK_OPTIONAL).
+ * @param[in] hook function.
+ * @param[in] argument of hook.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_sleep_hook_register(CMA_SLEEP_HOOK_TYPE when, const char *name, uint8_t priority, uint32_t budget,
+                                        uint8_t flags, cma_sleep_hook_t func, void *arg);
+
+/**
+ ****************************************************************************************
+ * @brief Run hooks of a chain.
+ *
+ * @param[in] pre-sleep or post-wake.
+ * @param[in] sleep type entered or woken up from.
+ *
+ * @return time spent(microsecond).
+ ****************************************************************************************
+ */
+uint32_t cma_sleep_hook_run(CMA_SLEEP_HOOK_TYPE when, CMA_SLEEP_TYPE type);
+
+/**
+ ****************************************************************************************
+ * @brief Print time spent per hook and totals of each chain.
+ *
+ * @param[in] None.
+ *
+ * @return None.
+ ****************************************************************************************
+ */
+void cma_sleep_hook_print(void);
+
+/**
+ ****************************************************************************************
+ * @brief Tell whether state in retention memory must survive the sleep.
+ *
+ * Pending wake requests always need retention.
+ *
+ * @param[in] 1 if required.
+ *
+ * @return None.
+ ****************************************************************************************
+ */
+void cma_sleep_set_retention(uint8_t required);
+
+/**
+ ****************************************************************************************
+ * @brief Set where boot costs are kept when retention memory is lost.
+ *
+ * Averages in retention memory restart after sleep 2 or power off. With a store, they
+ * are loaded on the first boot after the loss and saved by cma_sleep_boot_done when one
+ * moved by more than 1/2^CMA_SLEEP_BOOT_SAVE_SHIFT, so flash is not written on each boot.
+ * Should be called before cma_sleep_boot_done.
+ *
+ * @param[in] load function, NULL for none.
+ * @param[in] save function, NULL for none.
+ *
+ * @return None.
+ ****************************************************************************************
+ */
+void cma_sleep_set_boot_store(cma_sleep_boot_load_t load, cma_sleep_boot_save_t save);
+
+/**
+ ****************************************************************************************
+ * @brief Set where a sleep 2 cycle is kept until the wake-up.
+ *
+ * The cycle in progress is in retention memory, so a sleep 2 cycle is lost with it.
+ * With a store, cma_sleep_trigger saves it before sleep 2 and cma_sleep_boot_done loads
+ * it after a wake-up from sleep 2, the power down time is rebuilt from the RTC counter.
+ * Then the cycle is recorded and its RTC timer wake-up gives the cold boot time.
+ * It is not loaded after power on, reset or watchdog, which do not end a sleep.
+ * Should be called before cma_sleep_boot_done.
+ *
+ * @param[in] load function, NULL for none.
+ * @param[in] save function, NULL for none. Called with the sleep mutex held.
+ *
+ * @return None.
+ ****************************************************************************************
+ */
+void cma_sleep_set_pending_store(cma_sleep_pending_load_t load, cma_sleep_pending_save_t save);
+
+/**
+ ****************************************************************************************
+ * @brief Measure boot time. Should be called once the application is ready after boot.
+ *
+ * Boot time is taken with RTC counter from the wake-up, so ROM boot, image load and
+ * init before the scheduler are included. It is recorded as warm resume cost if retention
+ * memory was kept, or as cold boot cost otherwise. Wake-up time is known after power on
+ * (RTC counter starts at 0) and after an RTC timer wake-up from a cycle started with
+ * cma_sleep_trigger (from sleep 2 only with cma_sleep_set_pending_store), other boots
+ * are not timed and averages are kept.
+ * Measurements are averaged in retention memory, cma_rtm_data_init should be called before.
+ * Averages are restored and saved through the store of cma_sleep_set_boot_store if any.
+ * Sleep cycle accounting starts with the first call, the cycle ended by this wake-up is recorded.
+ * The wake-up reason is counted, see cma_sleep_wake_read.
+ *
+ * @param[in] None.
+ *
+ * @return None.
+ ****************************************************************************************
+ */
+void cma_sleep_boot_done(void);
+
+/**
+ ****************************************************************************************
+ * @brief Select sleep type for CMA_SLEEP_TYPE_AUTO.
+ *
+ * Sleep 3 is selected if retention is required or the interval is shorter than the
+ * break-even time, where the extra sleep 3 current costs as much as a cold boot.
+ *
+ * @param[in] wakeup time(millisecond), 0 for external wake-up only.
+ *
+ * @return CMA_SLEEP_TYPE_2 or CMA_SLEEP_TYPE_3.
+ ****************************************************************************************
+ */
+CMA_SLEEP_TYPE cma_sleep_auto_select(uint64_t wakeup_time);
+
+/**
+ ****************************************************************************************
+ * @brief Get rolling averages of sleep cycles, e.g. for telemetry.
+ *
+ * Cycles are kept in retention memory, so history restarts after sleep 2 or reset.
+ * The sleep 2 cycle itself is recorded if a store is set with cma_sleep_set_pending_store.
+ *
+ * @param[out] averages.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_sleep_account_get(cma_sleep_account_t *account);
+
+/**
+ ****************************************************************************************
+ * @brief Read recorded sleep cycles, oldest first.
+ *
+ * @param[out] buffer of cycles.
+ * @param[in] maximum number of cycles.
+ *
+ * @return number of cycles read.
+ ****************************************************************************************
+ */
+uint32_t cma_sleep_account_read(cma_sleep_cycle_t *cycles, uint32_t maxCycles);
+
+/**
+ ****************************************************************************************
+ * @brief Print recorded sleep cycles and rolling averages.
+ *
+ * @param[in] None.
+ *
+ * @return None.
+ ****************************************************************************************
+ */
+void cma_sleep_account_print(void);
+
+/**
+ ****************************************************************************************
+ * @brief Check if this boot is a wake-up from sleep with retention memory kept.
+ *
+ * Reset and watchdog wake-ups are not resumes even if retention memory was kept,
+ * so cached configuration is rebuilt after them.
+ *
+ * @param[in] None.
+ *
+ * @return 1 if resumed, 0 if not.
+ ****************************************************************************************
+ */
+uint8_t cma_sleep_is_resume(void);
+
+/**
+ ****************************************************************************************
+ * @brief Start measuring an init step.
+ *
+ * @param[in] None.
+ *
+ * @return start time to pass to cma_sleep_resume_end.
+ ****************************************************************************************
+ */
+uint32_t cma_sleep_resume_begin(void);
+
+/**
+ ****************************************************************************************
+ * @brief End measuring an init step.
+ *
+ * Times of the full init and of the resume path are averaged separately in retention
+ * memory, so cma_sleep_resume_print can report the time saved by the resume path.
+ * cma_sleep_init and cma_rtm_data_init should be called before.
+ *
+ * @param[in] name of step (static string).
+ * @param[in] value returned by cma_sleep_resume_begin.
+ * @param[in] 1 if the step took the resume path, 0 if full init was done.
+ *
+ * @return None.
+ ****************************************************************************************
+ */
+void cma_sleep_resume_end(const char *name, uint32_t start, uint8_t resumed);
+
+/**
+ ****************************************************************************************
+ * @brief Print full init and resume times of the measured steps.
+ *
+ * @param[in] None.
+ *
+ * @return None.
+ ****************************************************************************************
+ */
+void cma_sleep_resume_print(void);
+
+/**
+ ****************************************************************************************
+ * @brief Read wake-up reasons counted by cma_sleep_boot_done, most frequent first.
+ *
+ * Counts are kept in retention memory, so they restart after sleep 2 or power off.
+ *
+ * @param[out] buffer of reasons.
+ * @param[in] maximum number of reasons.
+ *
+ * @return number of reasons read.
+ ****************************************************************************************
+ */
+uint32_t cma_sleep_wake_read(cma_sleep_wake_stats_t *stats, uint32_t maxStats);
+
+/**
+ ****************************************************************************************
+ * @brief Get count and last time of a wake-up reason.
+ *
+ * @param[in] reason (da16x_boot_get_wakeupmode).
+ * @param[out] statistics, count is 0 if the reason was not seen.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_sleep_wake_get(uint8_t reason, cma_sleep_wake_stats_t *stats);
+
+/**
+ ****************************************************************************************
+ * @brief Print histogram of wake-up reasons with their decoded names.
+ *
+ * @param[in] None.
+ *
+ * @return None.
+ ****************************************************************************************
+ */
+void cma_sleep_wake_print(void);
+
+/**
+ ****************************************************************************************
+ * @brief Configure adaptive sleep interval.
+ *
+ * The interval is halved after a cycle with at least busyEvents events and doubled after
+ * a cycle without event, within minInterval and maxInterval. State is kept in retention
+ * memory, it starts at minInterval. Wake-ups by external signal or sensor are counted
+ * as events. Should be called on each boot after cma_rtm_data_init.
+ *
+ * @param[in] minimum interval(millisecond).
+ * @param[in] maximum interval(millisecond).
+ * @param[in] events per cycle to shorten the interval, 0 for CMA_SLEEP_ADAPT_BUSY_DEFAULT.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_sleep_adapt_init(uint32_t minInterval, uint32_t maxInterval, uint32_t busyEvents);
+
+/**
+ ****************************************************************************************
+ * @brief Count an event (GPIO interrupt, received packet ...) for adaptive interval.
+ *
+ * Can be called from task or from interrupt of any priority allowed to call FreeRTOS
+ * FromISR functions (not above configMAX_SYSCALL_INTERRUPT_PRIORITY).
+ *
+ * @param[in] None.
+ *
+ * @return None.
+ ****************************************************************************************
+ */
+void cma_sleep_adapt_event(void);
+
+/**
+ ****************************************************************************************
+ * @brief End the cycle and get the next wake-up interval.
+ *
+ * Call once per cycle, e.g. cma_sleep_trigger(type, cma_sleep_adapt_next()).
+ *
+ * @param[in] None.
+ *
+ * @return interval(millisecond), minimum interval if not configured.
+ ****************************************************************************************
+ */
+uint32_t cma_sleep_adapt_next(void);
+
+/**
+ ****************************************************************************************
+ * @brief Get current adaptive interval without ending the cycle.
+ *
+ * @param[in] None.
+ *
+ * @return interval(millisecond).
+ ****************************************************************************************
+ */
+uint32_t cma_sleep_adapt_interval(void);
+
 #endif /* CMA_SLEEP_H_ */
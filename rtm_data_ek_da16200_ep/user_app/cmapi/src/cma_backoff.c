@@ -0,0 +1,243 @@
+/**
+ ****************************************************************************************
+ *
+ * @file cma_backoff.c
+ *
+ * @brief Backoff policy of DPM abnormal wake-up.
+ *
+ * Copyright (c) 2016-2024 Renesas Electronics. All rights reserved.
+ *
+ * This software ("Software") is owned by Renesas Electronics.
+ *
+ * By using this Software you agree that Renesas Electronics retains all
+ * intellectual property and proprietary rights in and to this Software and any
+ * use, reproduction, disclosure or distribution of the Software without express
+ * written permission or a license agreement from Renesas Electronics is
+ * strictly prohibited. This Software is solely for use on or in conjunction
+ * with Renesas Electronics products.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE
+ * SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. EXCEPT AS OTHERWISE
+ * PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * RENESAS ELECTRONICS BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL,
+ * OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ *
+ ****************************************************************************************
+ */
+
+#include "sdk_type.h"
+#include "da16x_system.h"
+#include "rtc.h"
+#include "cma_debug.h"
+#include "cma_rtm_data.h"
+#include "cma_backoff.h"
+
+#define CMA_BACKOFF_TAG                 "cma_backoff"
+#define CMA_BACKOFF_MAGIC               0x464B4342  /* "BCKF" */
+
+/* Success rate is a moving average per 1024, 1/8 weight of new result */
+#define CMA_BACKOFF_RATE_ONE            1024
+
+/* State in retention memory */
+struct cma_backoff_state_t
+{
+    uint32_t magic;
+    uint32_t seed;
+    uint32_t attempts;
+    uint32_t successes;
+    uint32_t success_rate;
+};
+
+/* No OS calls here, the table is filled before the scheduler starts */
+static unsigned long long *cma_backoff_table;
+static uint32_t cma_backoff_count;
+static uint32_t cma_backoff_boot_seed;
+static struct cma_backoff_state_t *cma_backoff_state;
+
+static uint32_t cmai_backoff_random(uint32_t *x)
+{
+    /* xorshift32 */
+    *x ^= *x << 13;
+    *x ^= *x >> 17;
+    *x ^= *x << 5;
+
+    return *x;
+}
+
+/* Spread close device values (e.g. consecutive MAC addresses) over the whole seed range */
+static uint32_t cmai_backoff_mix(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7FEB352D;
+    x ^= x >> 15;
+    x *= 0x846CA68B;
+    x ^= x >> 16;
+
+    return x;
+}
+
+static uint32_t cmai_backoff_scale(void)
+{
+    uint32_t rate = CMA_BACKOFF_RATE_ONE;
+
+    if (cma_backoff_state != NULL)
+    {
+        rate = cma_backoff_state->success_rate;
+    }
+
+    return 1 + ((CMA_BACKOFF_RATE_ONE - rate) * (CMA_BACKOFF_SCALE_MAX - 1)) / CMA_BACKOFF_RATE_ONE;
+}
+
+static void cmai_backoff_refill(void)
+{
+    uint64_t interval, jitter;
+    uint32_t x, scale;
+
+    if (cma_backoff_table == NULL || cma_backoff_count == 0)
+    {
+        return;
+    }
+
+    x = (cma_backoff_state != NULL) ? cma_backoff_state->seed : cma_backoff_boot_seed;
+    if (x == 0)
+    {
+        x = 0x9E3779B9;
+    }
+
+    scale = cmai_backoff_scale ();
+    interval = (uint64_t) CMA_BACKOFF_BASE * scale;
+
+    cma_backoff_table[0] = CMA_BACKOFF_INITIAL;
+
+    for (uint32_t i = 1; i < cma_backoff_count; i++)
+    {
+        uint64_t value = (interval < CMA_BACKOFF_MAX) ? interval : CMA_BACKOFF_MAX;
+
+        /* Same seed gives same jitter, so a device keeps its place in the fleet */
+        jitter = value * CMA_BACKOFF_JITTER / 100;
+        if (jitter > 0)
+        {
+            value = value - jitter + (cmai_backoff_random (&x) % (2 * jitter + 1));
+        }
+
+        if (value < 1)
+        {
+            value = 1;
+        }
+        else if (value > CMA_BACKOFF_INTERVAL_LIMIT)
+        {
+            value = CMA_BACKOFF_INTERVAL_LIMIT;
+        }
+
+        cma_backoff_table[i] = value;
+        interval *= 2;
+    }
+
+    if (CMA_BACKOFF_GIVE_UP && cma_backoff_count > 1)
+    {
+        cma_backoff_table[cma_backoff_count - 1] = CMA_BACKOFF_NO_WAKEUP;
+    }
+}
+
+void cma_backoff_fill(unsigned long long *table, uint32_t count)
+{
+    cma_backoff_table = table;
+    cma_backoff_count = count;
+    cma_backoff_boot_seed = cmai_backoff_mix (CMA_BACKOFF_DEVICE_SEED());
+
+    cmai_backoff_refill ();
+}
+
+CMA_STATUS_TYPE cma_backoff_init(void)
+{
+    if (cma_backoff_state == NULL)
+    {
+        if (cma_rtm_data_alloc_and_read ((uint8_t*) CMA_BACKOFF_TAG, (uint8_t**) &cma_backoff_state,
+                                         sizeof(struct cma_backoff_state_t)) != CMA_STATUS_OK)
+        {
+            cma_backoff_state = NULL;
+            return CMA_STATUS_FAIL;
+        }
+
+        if (cma_backoff_state->magic != CMA_BACKOFF_MAGIC || cma_backoff_state->success_rate > CMA_BACKOFF_RATE_ONE)
+        {
+            memset (cma_backoff_state, 0, sizeof(struct cma_backoff_state_t));
+            cma_backoff_state->magic = CMA_BACKOFF_MAGIC;
+            cma_backoff_state->seed = cma_backoff_boot_seed;
+            cma_backoff_state->success_rate = CMA_BACKOFF_RATE_ONE;
+        }
+    }
+
+    cmai_backoff_refill ();
+
+    return CMA_STATUS_OK;
+}
+
+void cma_backoff_report(uint8_t success)
+{
+    if (cma_backoff_state == NULL)
+    {
+        return;
+    }
+
+    cma_backoff_state->attempts++;
+    cma_backoff_state->success_rate -= cma_backoff_state->success_rate / 8;
+
+    if (success)
+    {
+        cma_backoff_state->successes++;
+        cma_backoff_state->success_rate += CMA_BACKOFF_RATE_ONE / 8;
+    }
+
+    cmai_backoff_refill ();
+
+    LOG(LOG_DBG, "reconnection %s, success rate %d/1024, scale %d", success ? "done" : "failed",
+        cma_backoff_state->success_rate, cmai_backoff_scale ());
+}
+
+CMA_STATUS_TYPE cma_backoff_get_stats(cma_backoff_stats_t *stats)
+{
+    if (stats == NULL || cma_backoff_state == NULL)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    stats->attempts = cma_backoff_state->attempts;
+    stats->successes = cma_backoff_state->successes;
+    stats->success_rate = cma_backoff_state->success_rate;
+    stats->scale = cmai_backoff_scale ();
+    stats->seed = cma_backoff_state->seed;
+
+    return CMA_STATUS_OK;
+}
+
+void cma_backoff_print(void)
+{
+    cma_backoff_stats_t stats;
+
+    if (cma_backoff_get_stats (&stats) == CMA_STATUS_OK)
+    {
+        PRINTF("reconnections %d/%d, success rate %d/1024, scale %d, seed 0x%08x\n", stats.successes,
+               stats.attempts, stats.success_rate, stats.scale, stats.seed);
+    }
+
+    if (cma_backoff_table == NULL)
+    {
+        return;
+    }
+
+    PRINTF("%-6s %10s\n", "retry", "wait(s)");
+
+    for (uint32_t i = 1; i < cma_backoff_count; i++)
+    {
+        if (cma_backoff_table[i] == CMA_BACKOFF_NO_WAKEUP)
+            PRINTF("%-6d %10s\n", i, "no wakeup");
+        else
+            PRINTF("%-6d %10d\n", i, (uint32_t) cma_backoff_table[i]);
+    }
+}
@@ -0,0 +1,1155 @@
+/**
+ ****************************************************************************************
+ *
+ * @file cma_flash.c
+ *
+ * @brief User flash Functions.
+ *
+ * Copyright (c) 2016-2024 Renesas Electronics. All rights reserved.
+ *
+ * This software ("Software") is owned by Renesas Electronics.
+ *
+ * By using this Software you agree that Renesas Electronics retains all
+ * intellectual property and proprietary rights in and to this Software and any
+ * use, reproduction, disclosure or distribution of the Software without express
+ * written permission or a license agreement from Renesas Electronics is
+ * strictly prohibited. This Software is solely for use on or in conjunction
+ * with Renesas Electronics products.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE
+ * SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. EXCEPT AS OTHERWISE
+ * PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * RENESAS ELECTRONICS BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL,
+ * OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ *
+ ****************************************************************************************
+ */
+
+#include <stddef.h>
+#include "sdk_type.h"
+#include "da16x_system.h"
+#include "da16x_types.h"
+#include "sflash.h"
+#include "sys_image.h"
+#include "environ.h"
+#include "gpio.h"
+#include "cma_osal.h"
+#include "cma_debug.h"
+#include "cma_flash.h"
+
+#define CMA_SECTOR_SIZE 4096
+#define CMA_PAGE_SIZE CMA_SECTOR_SIZE
+
+OS_MUTEX cma_flash_mutex = NULL;
+static uint32_t cma_flash_erase_count;
+
+/*
+ *****************************************************
+ * Usage : init -> open -> read/write -> close -> delete
+ * init -> (open -> read/write -> close -> open -> ...) -> delete
+ ******************************************************
+ */
+
+CMA_STATUS_TYPE cma_flash_init(void)
+{
+    if (cma_flash_mutex == NULL)
+    {
+        OS_MUTEX_CREATE(cma_flash_mutex);
+    }
+
+    cma_flash_erase_count = 0;
+
+    return CMA_STATUS_OK;
+}
+
+CMA_STATUS_TYPE cma_flash_delete(void)
+{
+    if (cma_flash_mutex != NULL)
+    {
+        OS_MUTEX_DELETE(cma_flash_mutex);
+    }
+
+    cma_flash_mutex = NULL;
+
+    return CMA_STATUS_OK;
+}
+
+static void cmai_flash_enable_write(HANDLE handle, uint32_t address, uint32_t length)
+{
+    uint32_t ioctldata[8];
+    uint32_t busmode;
+
+    if (handle)
+    {
+        // write mode
+        busmode = SFLASH_BUS_3BADDR | SFLASH_BUS_111;
+        SFLASH_IOCTL (handle, SFLASH_BUS_CONTROL, &busmode);
+
+        ioctldata[0] = address;
+        ioctldata[1] = length;
+        SFLASH_IOCTL (handle, SFLASH_SET_UNLOCK, ioctldata);
+    }
+}
+
+static void cmai_flash_disable_write(HANDLE handle, uint32_t address, uint32_t length)
+{
+    uint32_t ioctldata[8];
+    uint32_t busmode;
+
+    if (handle)
+    {
+        ioctldata[0] = address;
+        ioctldata[1] = length;
+        SFLASH_IOCTL (handle, SFLASH_SET_LOCK, ioctldata);
+
+        // read mode
+        busmode = SFLASH_BUS_3BADDR | SFLASH_BUS_144;
+        SFLASH_IOCTL (handle, SFLASH_BUS_CONTROL, &busmode);
+    }
+}
+
+static uint32_t cmai_flash_read(HANDLE handle, uint32_t address, uint8_t *buffer, uint32_t length)
+{
+    uint32_t busmode;
+    uint32_t ret = 0;
+
+    if (handle)
+    {
+        busmode = SFLASH_BUS_3BADDR | SFLASH_BUS_144;
+        SFLASH_IOCTL (handle, SFLASH_BUS_CONTROL, &busmode);
+
+        ret = SFLASH_READ (handle, address, (void*) buffer, length);
+    }
+
+    return ret;
+}
+
+static uint32_t cmai_flash_write(HANDLE handle, uint32_t address, uint8_t *data, uint32_t length)
+{
+    uint32_t ret = 0;
+
+    if (handle)
+    {
+        cmai_flash_enable_write (handle, address, length);
+
+        ret = SFLASH_WRITE (handle, address, data, length);
+
+        cmai_flash_disable_write (handle, address, length);
+    }
+
+    return ret;
+}
+
+static uint32_t cmai_flash_erase_sector(HANDLE handle, uint32_t address, uint32_t size)
+{
+    uint32_t ioctldata[8];
+    uint32_t busmode;
+    uint32_t ret = 0;
+
+    if (handle)
+    {
+        busmode = SFLASH_BUS_3BADDR | SFLASH_BUS_111;
+        SFLASH_IOCTL (handle, SFLASH_BUS_CONTROL, &busmode);
+
+        cmai_flash_enable_write (handle, address, CMA_SECTOR_SIZE);
+
+        ioctldata[0] = address;
+        ioctldata[1] = size;
+        size = SFLASH_IOCTL (handle, SFLASH_CMD_ERASE, ioctldata);
+        cma_flash_erase_count++;
+
+        cmai_flash_disable_write (handle, address, CMA_SECTOR_SIZE);
+    }
+
+    return ret;
+}
+
+/*
+ *****************************************************
+ * Integrity index
+ *
+ * Two index sectors are used alternately. Each one holds a header, a snapshot of
+ * per-sector CRC/generation and a journal. Before a tracked sector is erased a record
+ * with the new CRC is appended (in-flight), and its commit byte is programmed to 0x00
+ * after the sector is written. Records are programmed into erased area, so the index
+ * sector is erased only when the journal is full and a new snapshot is taken.
+ ******************************************************
+ */
+#define CMA_FLASH_INDEX_MAGIC           0x58444946  /* "FIDX" */
+#define CMA_FLASH_INDEX_HEADER_SIZE     32
+#define CMA_FLASH_INDEX_RECORD_SIZE     16
+#define CMA_FLASH_INDEX_COMMITTED       0x00
+#define CMA_FLASH_INDEX_UNUSED          0xFFFF
+
+struct cma_flash_index_header_t
+{
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t area_start;
+    uint32_t sector_count;
+    uint32_t snapshot_crc;
+    uint32_t reserved[2];
+    uint32_t header_crc;
+};
+
+struct cma_flash_index_entry_t
+{
+    uint32_t crc;
+    uint32_t prev_crc;
+    uint16_t generation;
+    uint8_t state;
+    uint8_t reserved;
+};
+
+struct cma_flash_index_record_t
+{
+    uint16_t sector;
+    uint16_t generation;
+    uint32_t crc;
+    uint32_t prev_crc;
+    uint16_t check;
+    uint8_t reserved;
+    uint8_t commit;
+};
+
+struct cma_flash_index_t
+{
+    uint32_t area_start;
+    uint32_t sector_count;
+    uint32_t block_address[2];
+    uint32_t active;
+    uint32_t sequence;
+    uint32_t journal_start;
+    uint32_t journal_offset;
+    uint32_t *record_offset;    /* offset of in-flight record, 0 if none */
+    struct cma_flash_index_entry_t *entry;
+};
+
+static struct cma_flash_index_t *cma_flash_index = NULL;
+
+static const uint32_t cma_flash_crc32_table[16] =
+{ 0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C, 0xEDB88320,
+  0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C };
+
+static uint32_t cmai_flash_crc32(const uint8_t *data, uint32_t length)
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (uint32_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ cma_flash_crc32_table[crc & 0x0F];
+        crc = (crc >> 4) ^ cma_flash_crc32_table[crc & 0x0F];
+    }
+
+    return ~crc;
+}
+
+static uint16_t cmai_flash_index_record_check(struct cma_flash_index_record_t *record)
+{
+    return (uint16_t) cmai_flash_crc32 ((uint8_t*) record, offsetof(struct cma_flash_index_record_t, check));
+}
+
+static uint32_t cmai_flash_index_block(void)
+{
+    return cma_flash_index->block_address[cma_flash_index->active];
+}
+
+static CMA_STATUS_TYPE cmai_flash_index_snapshot(HANDLE handle)
+{
+    struct cma_flash_index_header_t header;
+    uint32_t snapshot_size = cma_flash_index->sector_count * sizeof(struct cma_flash_index_entry_t);
+    uint32_t target = cma_flash_index->active ^ 1;
+    uint32_t address = cma_flash_index->block_address[target];
+
+    cmai_flash_erase_sector (handle, address, CMA_SECTOR_SIZE);
+
+    if (cmai_flash_write (handle, address + CMA_FLASH_INDEX_HEADER_SIZE, (uint8_t*) cma_flash_index->entry,
+                          snapshot_size) != snapshot_size)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    /* Header is written last, so a block without header is never used */
+    memset (&header, 0xFF, sizeof(header));
+    header.magic = CMA_FLASH_INDEX_MAGIC;
+    header.sequence = cma_flash_index->sequence + 1;
+    header.area_start = cma_flash_index->area_start;
+    header.sector_count = cma_flash_index->sector_count;
+    header.snapshot_crc = cmai_flash_crc32 ((uint8_t*) cma_flash_index->entry, snapshot_size);
+    header.header_crc = cmai_flash_crc32 ((uint8_t*) &header, offsetof(struct cma_flash_index_header_t, header_crc));
+
+    if (cmai_flash_write (handle, address, (uint8_t*) &header, sizeof(header)) != sizeof(header))
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    cma_flash_index->active = target;
+    cma_flash_index->sequence = header.sequence;
+    cma_flash_index->journal_offset = cma_flash_index->journal_start;
+    memset (cma_flash_index->record_offset, 0, cma_flash_index->sector_count * sizeof(uint32_t));
+
+    return CMA_STATUS_OK;
+}
+
+static uint32_t cmai_flash_index_append(HANDLE handle, uint32_t sector, uint16_t generation, uint32_t crc,
+        uint32_t prev_crc, uint8_t commit)
+{
+    struct cma_flash_index_entry_t *entry = &cma_flash_index->entry[sector];
+    struct cma_flash_index_record_t record;
+    uint32_t offset;
+
+    if ((cma_flash_index->journal_offset + CMA_FLASH_INDEX_RECORD_SIZE) > CMA_SECTOR_SIZE)
+    {
+        if (cmai_flash_index_snapshot (handle) != CMA_STATUS_OK)
+            return 0;
+    }
+
+    record.sector = (uint16_t) sector;
+    record.generation = generation;
+    record.crc = crc;
+    record.prev_crc = prev_crc;
+    record.check = cmai_flash_index_record_check (&record);
+    record.reserved = 0xFF;
+    record.commit = commit;
+
+    offset = cma_flash_index->journal_offset;
+    if (cmai_flash_write (handle, cmai_flash_index_block () + offset, (uint8_t*) &record, sizeof(record))
+            != sizeof(record))
+    {
+        return 0;
+    }
+    cma_flash_index->journal_offset += CMA_FLASH_INDEX_RECORD_SIZE;
+
+    entry->crc = record.crc;
+    entry->prev_crc = record.prev_crc;
+    entry->generation = record.generation;
+    entry->state = (commit == CMA_FLASH_INDEX_COMMITTED) ? CMA_FLASH_INDEX_STATE_VALID : CMA_FLASH_INDEX_STATE_INFLIGHT;
+    cma_flash_index->record_offset[sector] = (commit == CMA_FLASH_INDEX_COMMITTED) ? 0 : offset;
+
+    return offset;
+}
+
+static void cmai_flash_index_commit(HANDLE handle, uint32_t sector)
+{
+    uint8_t commit = CMA_FLASH_INDEX_COMMITTED;
+    uint32_t offset = cma_flash_index->record_offset[sector];
+
+    if (offset != 0)
+    {
+        /* commit byte is programmed in place, 0xFF -> 0x00 needs no erase */
+        cmai_flash_write (handle, cmai_flash_index_block () + offset + offsetof(struct cma_flash_index_record_t, commit),
+                          &commit, 1);
+        cma_flash_index->record_offset[sector] = 0;
+        cma_flash_index->entry[sector].state = CMA_FLASH_INDEX_STATE_VALID;
+    }
+    else
+    {
+        struct cma_flash_index_entry_t *entry = &cma_flash_index->entry[sector];
+
+        cmai_flash_index_append (handle, sector, entry->generation, entry->crc, entry->prev_crc,
+                                 CMA_FLASH_INDEX_COMMITTED);
+    }
+}
+
+static int32_t cmai_flash_index_sector(uint32_t sectorAddress)
+{
+    if (cma_flash_index == NULL || sectorAddress < cma_flash_index->area_start)
+        return -1;
+
+    if ((sectorAddress - cma_flash_index->area_start) / CMA_SECTOR_SIZE >= cma_flash_index->sector_count)
+        return -1;
+
+    return (int32_t) ((sectorAddress - cma_flash_index->area_start) / CMA_SECTOR_SIZE);
+}
+
+/* Called with new contents of the sector before it is erased */
+static void cmai_flash_index_begin(HANDLE handle, uint32_t sectorAddress, uint8_t *sectorData)
+{
+    int32_t sector = cmai_flash_index_sector (sectorAddress);
+
+    if (sector >= 0)
+    {
+        struct cma_flash_index_entry_t *entry = &cma_flash_index->entry[sector];
+
+        /* previous write never completed : its old contents are still the fallback */
+        cmai_flash_index_append (handle, (uint32_t) sector, entry->generation + 1,
+                                 cmai_flash_crc32 (sectorData, CMA_SECTOR_SIZE),
+                                 (entry->state == CMA_FLASH_INDEX_STATE_INFLIGHT) ? entry->prev_crc : entry->crc, 0xFF);
+    }
+}
+
+/* Called after the sector is written successfully */
+static void cmai_flash_index_end(HANDLE handle, uint32_t sectorAddress)
+{
+    int32_t sector = cmai_flash_index_sector (sectorAddress);
+
+    if (sector >= 0 && cma_flash_index->entry[sector].state == CMA_FLASH_INDEX_STATE_INFLIGHT)
+    {
+        cmai_flash_index_commit (handle, (uint32_t) sector);
+    }
+}
+
+static CMA_STATUS_TYPE cmai_flash_index_load(uint8_t *block, uint32_t *sequence)
+{
+    struct cma_flash_index_header_t *header = (struct cma_flash_index_header_t*) block;
+    uint32_t snapshot_size = cma_flash_index->sector_count * sizeof(struct cma_flash_index_entry_t);
+
+    if (header->magic != CMA_FLASH_INDEX_MAGIC || header->area_start != cma_flash_index->area_start
+            || header->sector_count != cma_flash_index->sector_count
+            || header->header_crc
+                    != cmai_flash_crc32 (block, offsetof(struct cma_flash_index_header_t, header_crc))
+            || header->snapshot_crc != cmai_flash_crc32 (block + CMA_FLASH_INDEX_HEADER_SIZE, snapshot_size))
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    *sequence = header->sequence;
+
+    return CMA_STATUS_OK;
+}
+
+static void cmai_flash_index_replay(uint8_t *block)
+{
+    uint32_t offset;
+
+    memcpy (cma_flash_index->entry, block + CMA_FLASH_INDEX_HEADER_SIZE,
+            cma_flash_index->sector_count * sizeof(struct cma_flash_index_entry_t));
+    memset (cma_flash_index->record_offset, 0, cma_flash_index->sector_count * sizeof(uint32_t));
+
+    for (offset = cma_flash_index->journal_start; offset + CMA_FLASH_INDEX_RECORD_SIZE <= CMA_SECTOR_SIZE; offset +=
+    CMA_FLASH_INDEX_RECORD_SIZE)
+    {
+        struct cma_flash_index_record_t *record = (struct cma_flash_index_record_t*) (block + offset);
+        struct cma_flash_index_entry_t *entry;
+
+        if (record->sector == CMA_FLASH_INDEX_UNUSED && record->check == 0xFFFF)
+            break;
+
+        /* record partly programmed by a reset, skip it */
+        if (record->sector >= cma_flash_index->sector_count || record->check != cmai_flash_index_record_check (record))
+            continue;
+
+        entry = &cma_flash_index->entry[record->sector];
+        entry->crc = record->crc;
+        entry->prev_crc = record->prev_crc;
+        entry->generation = record->generation;
+
+        if (record->commit == CMA_FLASH_INDEX_COMMITTED)
+        {
+            entry->state = CMA_FLASH_INDEX_STATE_VALID;
+            cma_flash_index->record_offset[record->sector] = 0;
+        }
+        else
+        {
+            entry->state = CMA_FLASH_INDEX_STATE_INFLIGHT;
+            cma_flash_index->record_offset[record->sector] = offset;
+        }
+    }
+
+    cma_flash_index->journal_offset = offset;
+}
+
+/*
+ *****************************************************
+ * Memory mapped read
+ *
+ * The serial flash is also readable through the XIP cache window. A mapped range is
+ * used in place, so it must not be written while in use. cma_flash_write/erase/program
+ * invalidate the cache when they touch a mapped range. Other updates are remembered
+ * and the cache is invalidated at the next cma_flash_map, as lines of a range read
+ * before its unmap may still be in the cache.
+ ******************************************************
+ */
+#ifndef CMA_FLASH_XIP_BASE
+#define CMA_FLASH_XIP_BASE              0x10000000  /* flash offset 0 in XIP window */
+#endif
+
+#ifndef CMA_FLASH_XIP_CACHE_INVALIDATE
+#define CMA_FLASH_XIP_CACHE_INVALIDATE() da16x_cache_invalidate()
+#endif
+
+struct cma_flash_map_t
+{
+    uint32_t address;
+    uint32_t length;
+};
+
+static struct cma_flash_map_t cma_flash_map_table[CMA_FLASH_MAP_MAX];
+
+/* Flash was updated since the cache was last invalidated */
+static uint8_t cma_flash_map_stale = 0;
+
+static void cmai_flash_map_sync(uint32_t address, uint32_t length)
+{
+    for (uint32_t i = 0; i < CMA_FLASH_MAP_MAX; i++)
+    {
+        struct cma_flash_map_t *map = &cma_flash_map_table[i];
+
+        if (map->length != 0 && address < map->address + map->length && map->address < address + length)
+        {
+            CMA_FLASH_XIP_CACHE_INVALIDATE();
+            cma_flash_map_stale = 0;
+            return;
+        }
+    }
+
+    cma_flash_map_stale = 1;
+}
+
+/* Usage : open -> read/write -> close */
+void* cma_flash_open(void)
+{
+    HANDLE handle;
+    uint32_t ioctldata[8];
+    uint32_t busmode;
+
+    if (cma_flash_mutex == NULL)
+        return NULL;
+
+    da16x_environ_lock (TRUE);
+
+    OS_MUTEX_GET(cma_flash_mutex, OS_MUTEX_FOREVER);
+
+    handle = SFLASH_CREATE (SFLASH_UNIT_0);
+    if (handle)
+    {
+        /* Setup bussel */
+        ioctldata[0] = da16x_sflash_get_bussel ();
+        SFLASH_IOCTL (handle, SFLASH_SET_BUSSEL, ioctldata);
+        if (SFLASH_INIT (handle) == TRUE)
+        {
+            /* to prevent a reinitialization */
+            if (da16x_sflash_setup_parameter ((UINT32*) ioctldata) == TRUE)
+            {
+                SFLASH_IOCTL (handle, SFLASH_SET_INFO, ioctldata);
+            }
+        }
+
+        SFLASH_IOCTL (handle, SFLASH_CMD_WAKEUP, ioctldata);
+        if (ioctldata[0] > 0)
+        {
+            ioctldata[0] = ioctldata[0] / 1000;
+            if (ioctldata[0] > 100)
+                OS_DELAY(ioctldata[0] / 100);
+            else
+                OS_DELAY(1);
+        }
+
+        busmode = SFLASH_BUS_3BADDR | SFLASH_BUS_144;
+        SFLASH_IOCTL (handle, SFLASH_BUS_CONTROL, &busmode);
+    }
+
+    OS_MUTEX_PUT(cma_flash_mutex);
+    return (void*) handle;
+}
+
+CMA_STATUS_TYPE cma_flash_write(void *handle, uint32_t startAddress, uint8_t *newData, uint32_t dataLength)
+{
+    // Calculate the number of sectors spanned by the data
+    uint32_t endAddress = startAddress + dataLength - 1;
+    uint32_t startSector = startAddress / CMA_SECTOR_SIZE;
+    uint32_t endSector = endAddress / CMA_SECTOR_SIZE;
+    CMA_STATUS_TYPE ret = CMA_STATUS_FAIL;
+
+    // Buffers for page data
+    uint8_t *pageBuffer; //[PAGE_SIZE];
+
+    if (cma_flash_mutex == NULL || handle == NULL)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    OS_MUTEX_GET(cma_flash_mutex, OS_MUTEX_FOREVER);
+
+    pageBuffer = OS_MALLOC(CMA_PAGE_SIZE);
+    if (pageBuffer)
+    {
+        for (uint32_t sector = startSector; sector <= endSector; sector++)
+        {
+            uint32_t sectorAddress = sector * CMA_SECTOR_SIZE;
+
+            // Read and store data from the entire sector before erasing
+            for (uint32_t page = 0; page < CMA_SECTOR_SIZE; page += CMA_PAGE_SIZE)
+            {
+                uint32_t pageAddress = sectorAddress + page;
+
+                if (cmai_flash_read (handle, pageAddress, pageBuffer, CMA_PAGE_SIZE) == CMA_PAGE_SIZE)
+                    ret = CMA_STATUS_OK;
+                else
+                    ret = CMA_STATUS_FAIL;
+
+                // Calculate start and end of the new data within this page
+                uint32_t pageStart = pageAddress;
+                uint32_t pageEnd = pageAddress + CMA_PAGE_SIZE - 1;
+
+                if (pageEnd < startAddress || pageStart > endAddress)
+                {
+                    // This page is completely outside the range of new data
+                    continue;
+                }
+
+                // Determine the overlap and copy new data into the page buffer
+                uint32_t newStartOffset = (pageStart < startAddress) ? (startAddress - pageStart) : 0;
+                uint32_t newEndOffset = (pageEnd > endAddress) ? (endAddress - pageStart + 1) : CMA_PAGE_SIZE;
+                uint32_t newDataOffset = (pageStart < startAddress) ? 0 : (pageStart - startAddress);
+
+                memcpy (&pageBuffer[newStartOffset], &newData[newDataOffset], newEndOffset - newStartOffset);
+
+                // Erase the sector once before writing the first page
+                if (page == 0)
+                {
+                    // Page is the whole sector, so CRC of new contents is known before erasing
+                    cmai_flash_index_begin (handle, sectorAddress, pageBuffer);
+
+                    if (cmai_flash_erase_sector (handle, sectorAddress, CMA_SECTOR_SIZE) != CMA_SECTOR_SIZE)
+                        ret = CMA_STATUS_FAIL;
+                    else
+                        ret = CMA_STATUS_OK;
+                }
+
+                // Write updated page back to flash memory
+                if (cmai_flash_write (handle, pageAddress, pageBuffer, CMA_PAGE_SIZE) == CMA_PAGE_SIZE)
+                {
+                    ret = CMA_STATUS_OK;
+                    cmai_flash_index_end (handle, sectorAddress);
+                }
+                else
+                    ret = CMA_STATUS_FAIL;
+            }
+
+            if (ret == CMA_STATUS_FAIL)
+                break;
+        }
+
+        OS_FREE(pageBuffer);
+    }
+
+    cmai_flash_map_sync (startAddress, dataLength);
+
+    OS_MUTEX_PUT(cma_flash_mutex);
+
+    return ret;
+}
+
+CMA_STATUS_TYPE cma_flash_read(void *handle, uint32_t startAddress, uint8_t *readData, uint32_t dataLength)
+{
+    CMA_STATUS_TYPE ret = CMA_STATUS_FAIL;
+    uint32_t offset;
+    uint8_t *offset_data;
+
+    if (cma_flash_mutex == NULL || handle == NULL)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    OS_MUTEX_GET(cma_flash_mutex, OS_MUTEX_FOREVER);
+
+    offset = startAddress % 4;
+
+    if (offset != 0)
+    {
+        offset_data = OS_MALLOC(dataLength + offset);
+        if (offset_data)
+        {
+            if (cmai_flash_read (handle, startAddress - offset, offset_data, dataLength + offset)
+                    == (dataLength + offset))
+                ret = CMA_STATUS_OK;
+            else
+                ret = CMA_STATUS_FAIL;
+
+            memcpy (readData, offset_data + offset, dataLength);
+            OS_FREE(offset_data);
+        }
+    }
+    else
+    {
+        if (cmai_flash_read (handle, startAddress, readData, dataLength) == dataLength)
+            ret = CMA_STATUS_OK;
+        else
+            ret = CMA_STATUS_FAIL;
+    }
+
+    OS_MUTEX_PUT(cma_flash_mutex);
+
+    return ret;
+}
+
+CMA_STATUS_TYPE cma_flash_erase(void *handle, uint32_t startAddress, uint32_t dataLength)
+{
+    // Calculate the number of sectors spanned by the data
+    uint32_t endAddress = startAddress + dataLength - 1;
+    uint32_t startSector = startAddress / CMA_SECTOR_SIZE;
+    uint32_t endSector = endAddress / CMA_SECTOR_SIZE;
+    CMA_STATUS_TYPE ret = CMA_STATUS_FAIL;
+
+    // Buffers for page data
+    uint8_t *pageBuffer; //[PAGE_SIZE];
+
+    if (cma_flash_mutex == NULL || handle == NULL)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    OS_MUTEX_GET(cma_flash_mutex, OS_MUTEX_FOREVER);
+
+    pageBuffer = OS_MALLOC(CMA_PAGE_SIZE);
+    if (pageBuffer)
+    {
+        // Process each sector
+        for (uint32_t sector = startSector; sector <= endSector; sector++)
+        {
+            uint32_t sectorAddress = sector * CMA_SECTOR_SIZE;
+
+            // Read and store data from the entire sector before erasing
+            for (uint32_t page = 0; page < CMA_SECTOR_SIZE; page += CMA_PAGE_SIZE)
+            {
+                uint32_t pageAddress = sectorAddress + page;
+
+                if (cmai_flash_read (handle, pageAddress, pageBuffer, CMA_PAGE_SIZE) == CMA_PAGE_SIZE)
+                    ret = CMA_STATUS_OK;
+                else
+                    ret = CMA_STATUS_FAIL;
+
+                // Calculate start and end of the new data within this page
+                uint32_t pageStart = pageAddress;
+                uint32_t pageEnd = pageAddress + CMA_PAGE_SIZE - 1;
+
+                if (pageEnd < startAddress || pageStart > endAddress)
+                {
+                    // This page is completely outside the range of new data
+                    continue;
+                }
+
+                // Determine the overlap and copy new data into the page buffer
+                uint32_t newStartOffset = (pageStart < startAddress) ? (startAddress - pageStart) : 0;
+                uint32_t newEndOffset = (pageEnd > endAddress) ? (endAddress - pageStart + 1) : CMA_PAGE_SIZE;
+
+                memset (&pageBuffer[newStartOffset], 0xFF, newEndOffset - newStartOffset);
+
+                // Erase the sector once before writing the first page
+                if (page == 0)
+                {
+                    cmai_flash_index_begin (handle, sectorAddress, pageBuffer);
+
+                    if (cmai_flash_erase_sector (handle, sectorAddress, CMA_SECTOR_SIZE) != CMA_SECTOR_SIZE)
+                        ret = CMA_STATUS_FAIL;
+                    else
+                        ret = CMA_STATUS_OK;
+                }
+
+                // Write updated page back to flash memory
+                if (cmai_flash_write (handle, pageAddress, pageBuffer, CMA_PAGE_SIZE) == CMA_PAGE_SIZE)
+                {
+                    ret = CMA_STATUS_OK;
+                    cmai_flash_index_end (handle, sectorAddress);
+                }
+                else
+                    ret = CMA_STATUS_FAIL;
+            }
+
+            if (ret == CMA_STATUS_FAIL)
+                break;
+        }
+
+        OS_FREE(pageBuffer);
+    }
+
+    cmai_flash_map_sync (startAddress, dataLength);
+
+    OS_MUTEX_PUT(cma_flash_mutex);
+
+    return ret;
+}
+
+CMA_STATUS_TYPE cma_flash_program(void *handle, uint32_t startAddress, uint8_t *data, uint32_t dataLength)
+{
+    CMA_STATUS_TYPE ret;
+
+    if (cma_flash_mutex == NULL || handle == NULL || data == NULL || dataLength == 0)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    OS_MUTEX_GET(cma_flash_mutex, OS_MUTEX_FOREVER);
+
+    if (cmai_flash_write (handle, startAddress, data, dataLength) == dataLength)
+        ret = CMA_STATUS_OK;
+    else
+        ret = CMA_STATUS_FAIL;
+
+    cmai_flash_map_sync (startAddress, dataLength);
+
+    OS_MUTEX_PUT(cma_flash_mutex);
+
+    return ret;
+}
+
+CMA_STATUS_TYPE cma_flash_close(void *handle)
+{
+    UINT32 busmode;
+
+    if (cma_flash_mutex == NULL || handle == NULL)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    OS_MUTEX_GET(cma_flash_mutex, OS_MUTEX_FOREVER);
+
+    busmode = SFLASH_BUS_3BADDR | SFLASH_BUS_144;
+    SFLASH_IOCTL (handle, SFLASH_BUS_CONTROL, &busmode);
+    SFLASH_CLOSE (handle);
+
+    OS_MUTEX_PUT(cma_flash_mutex);
+
+    da16x_environ_lock (FALSE);
+
+    return CMA_STATUS_OK;
+}
+
+CMA_STATUS_TYPE cma_flash_power_down(void *handle)
+{
+    uint32_t ioctldata[8];
+
+    if (cma_flash_mutex == NULL || handle == NULL)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    OS_MUTEX_GET(cma_flash_mutex, OS_MUTEX_FOREVER);
+
+    /* Released by the wakeup command of the next open */
+    SFLASH_IOCTL (handle, SFLASH_CMD_POWERDOWN, ioctldata);
+
+    OS_MUTEX_PUT(cma_flash_mutex);
+
+    return CMA_STATUS_OK;
+}
+
+CMA_STATUS_TYPE cma_flash_index_open(void *handle, uint32_t areaStart, uint32_t areaLength, uint32_t indexAddress)
+{
+    uint32_t sequence[2] = { 0, 0 };
+    CMA_STATUS_TYPE valid[2];
+    uint8_t *block[2];
+    CMA_STATUS_TYPE ret = CMA_STATUS_OK;
+    uint32_t sector_count = areaLength / CMA_SECTOR_SIZE;
+
+    if (cma_flash_mutex == NULL || handle == NULL || cma_flash_index != NULL)
+        return CMA_STATUS_FAIL;
+
+    if ((areaStart % CMA_SECTOR_SIZE) != 0 || (indexAddress % CMA_SECTOR_SIZE) != 0 || sector_count == 0
+            || sector_count > CMA_FLASH_INDEX_MAX_SECTORS
+            || (indexAddress + 2 * CMA_SECTOR_SIZE > areaStart && indexAddress < areaStart + areaLength))
+    {
+        LOG(LOG_ERR, "flash index : invalid area 0x%x (0x%x) index 0x%x", areaStart, areaLength, indexAddress);
+        return CMA_STATUS_FAIL;
+    }
+
+    OS_MUTEX_GET(cma_flash_mutex, OS_MUTEX_FOREVER);
+
+    cma_flash_index = OS_MALLOC(sizeof(struct cma_flash_index_t));
+    if (cma_flash_index != NULL)
+        memset (cma_flash_index, 0, sizeof(struct cma_flash_index_t));
+
+    block[0] = OS_MALLOC(CMA_SECTOR_SIZE);
+    block[1] = OS_MALLOC(CMA_SECTOR_SIZE);
+    if (cma_flash_index == NULL || block[0] == NULL || block[1] == NULL)
+    {
+        ret = CMA_STATUS_FAIL;
+        goto end;
+    }
+
+    cma_flash_index->area_start = areaStart;
+    cma_flash_index->sector_count = sector_count;
+    cma_flash_index->block_address[0] = indexAddress;
+    cma_flash_index->block_address[1] = indexAddress + CMA_SECTOR_SIZE;
+    cma_flash_index->journal_start = (CMA_FLASH_INDEX_HEADER_SIZE
+            + sector_count * sizeof(struct cma_flash_index_entry_t) + CMA_FLASH_INDEX_RECORD_SIZE - 1)
+            & ~(CMA_FLASH_INDEX_RECORD_SIZE - 1);
+    cma_flash_index->entry = OS_MALLOC(sector_count * sizeof(struct cma_flash_index_entry_t));
+    cma_flash_index->record_offset = OS_MALLOC(sector_count * sizeof(uint32_t));
+    if (cma_flash_index->entry == NULL || cma_flash_index->record_offset == NULL)
+    {
+        ret = CMA_STATUS_FAIL;
+        goto end;
+    }
+
+    /* Only the two index sectors are read here */
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        valid[i] = CMA_STATUS_FAIL;
+        if (cmai_flash_read (handle, cma_flash_index->block_address[i], block[i], CMA_SECTOR_SIZE) == CMA_SECTOR_SIZE)
+            valid[i] = cmai_flash_index_load (block[i], &sequence[i]);
+    }
+
+    if (valid[0] == CMA_STATUS_OK || valid[1] == CMA_STATUS_OK)
+    {
+        if (valid[0] != CMA_STATUS_OK || (valid[1] == CMA_STATUS_OK && sequence[1] > sequence[0]))
+            cma_flash_index->active = 1;
+
+        cma_flash_index->sequence = sequence[cma_flash_index->active];
+        cmai_flash_index_replay (block[cma_flash_index->active]);
+    }
+    else
+    {
+        /* First boot with index : build it once from the whole area */
+        LOG(LOG_INFO, "flash index : building index of %d sectors", sector_count);
+        for (uint32_t i = 0; i < sector_count; i++)
+        {
+            if (cmai_flash_read (handle, areaStart + i * CMA_SECTOR_SIZE, block[0], CMA_SECTOR_SIZE) != CMA_SECTOR_SIZE)
+            {
+                ret = CMA_STATUS_FAIL;
+                goto end;
+            }
+
+            cma_flash_index->entry[i].crc = cmai_flash_crc32 (block[0], CMA_SECTOR_SIZE);
+            cma_flash_index->entry[i].prev_crc = cma_flash_index->entry[i].crc;
+            cma_flash_index->entry[i].generation = 0;
+            cma_flash_index->entry[i].state = CMA_FLASH_INDEX_STATE_VALID;
+            cma_flash_index->entry[i].reserved = 0xFF;
+        }
+
+        cma_flash_index->active = 1;
+        ret = cmai_flash_index_snapshot (handle);
+    }
+
+end:
+    if (ret != CMA_STATUS_OK && cma_flash_index != NULL)
+    {
+        if (cma_flash_index->entry)
+            OS_FREE(cma_flash_index->entry);
+        if (cma_flash_index->record_offset)
+            OS_FREE(cma_flash_index->record_offset);
+        OS_FREE(cma_flash_index);
+        cma_flash_index = NULL;
+    }
+
+    if (block[0])
+        OS_FREE(block[0]);
+    if (block[1])
+        OS_FREE(block[1]);
+
+    OS_MUTEX_PUT(cma_flash_mutex);
+
+    return ret;
+}
+
+CMA_STATUS_TYPE cma_flash_index_check(void *handle, uint32_t *damagedSectors)
+{
+    uint8_t *sectorBuffer;
+    uint32_t damaged = 0;
+
+    if (cma_flash_mutex == NULL || handle == NULL || cma_flash_index == NULL)
+        return CMA_STATUS_FAIL;
+
+    OS_MUTEX_GET(cma_flash_mutex, OS_MUTEX_FOREVER);
+
+    sectorBuffer = OS_MALLOC(CMA_SECTOR_SIZE);
+    if (sectorBuffer == NULL)
+    {
+        OS_MUTEX_PUT(cma_flash_mutex);
+        return CMA_STATUS_FAIL;
+    }
+
+    for (uint32_t i = 0; i < cma_flash_index->sector_count; i++)
+    {
+        struct cma_flash_index_entry_t *entry = &cma_flash_index->entry[i];
+        uint32_t crc;
+
+        if (entry->state == CMA_FLASH_INDEX_STATE_DAMAGED)
+            damaged++;
+
+        if (entry->state != CMA_FLASH_INDEX_STATE_INFLIGHT)
+            continue;
+
+        if (cmai_flash_read (handle, cma_flash_index->area_start + i * CMA_SECTOR_SIZE, sectorBuffer, CMA_SECTOR_SIZE)
+                != CMA_SECTOR_SIZE)
+        {
+            entry->state = CMA_FLASH_INDEX_STATE_DAMAGED;
+            damaged++;
+            continue;
+        }
+
+        crc = cmai_flash_crc32 (sectorBuffer, CMA_SECTOR_SIZE);
+        if (crc == entry->crc)
+        {
+            /* write was completed but not committed */
+            cmai_flash_index_commit (handle, i);
+        }
+        else if (crc == entry->prev_crc)
+        {
+            /* reset before erase : old contents are intact, so is their generation */
+            cmai_flash_index_append (handle, i, (uint16_t) (entry->generation - 1), entry->prev_crc, entry->prev_crc,
+                                     CMA_FLASH_INDEX_COMMITTED);
+        }
+        else
+        {
+            LOG(LOG_WARN, "flash index : sector 0x%x is damaged", cma_flash_index->area_start + i * CMA_SECTOR_SIZE);
+            entry->state = CMA_FLASH_INDEX_STATE_DAMAGED;
+            damaged++;
+        }
+    }
+
+    OS_FREE(sectorBuffer);
+
+    OS_MUTEX_PUT(cma_flash_mutex);
+
+    if (damagedSectors)
+        *damagedSectors = damaged;
+
+    return CMA_STATUS_OK;
+}
+
+CMA_STATUS_TYPE cma_flash_index_verify(void *handle, uint32_t *damagedSectors)
+{
+    uint8_t *sectorBuffer;
+    uint32_t damaged = 0;
+
+    if (cma_flash_mutex == NULL || handle == NULL || cma_flash_index == NULL)
+        return CMA_STATUS_FAIL;
+
+    /* In-flight sectors are resolved first */
+    if (cma_flash_index_check (handle, NULL) != CMA_STATUS_OK)
+        return CMA_STATUS_FAIL;
+
+    OS_MUTEX_GET(cma_flash_mutex, OS_MUTEX_FOREVER);
+
+    sectorBuffer = OS_MALLOC(CMA_SECTOR_SIZE);
+    if (sectorBuffer == NULL)
+    {
+        OS_MUTEX_PUT(cma_flash_mutex);
+        return CMA_STATUS_FAIL;
+    }
+
+    for (uint32_t i = 0; i < cma_flash_index->sector_count; i++)
+    {
+        struct cma_flash_index_entry_t *entry = &cma_flash_index->entry[i];
+
+        if (entry->state == CMA_FLASH_INDEX_STATE_VALID
+                && (cmai_flash_read (handle, cma_flash_index->area_start + i * CMA_SECTOR_SIZE, sectorBuffer,
+                                     CMA_SECTOR_SIZE) != CMA_SECTOR_SIZE
+                        || cmai_flash_crc32 (sectorBuffer, CMA_SECTOR_SIZE) != entry->crc))
+        {
+            entry->state = CMA_FLASH_INDEX_STATE_DAMAGED;
+        }
+
+        if (entry->state == CMA_FLASH_INDEX_STATE_DAMAGED)
+            damaged++;
+    }
+
+    OS_FREE(sectorBuffer);
+
+    OS_MUTEX_PUT(cma_flash_mutex);
+
+    if (damagedSectors)
+        *damagedSectors = damaged;
+
+    return CMA_STATUS_OK;
+}
+
+CMA_FLASH_INDEX_STATE cma_flash_index_get_state(uint32_t address)
+{
+    int32_t sector = cmai_flash_index_sector (address - (address % CMA_SECTOR_SIZE));
+
+    if (sector < 0)
+        return CMA_FLASH_INDEX_STATE_UNTRACKED;
+
+    return (CMA_FLASH_INDEX_STATE) cma_flash_index->entry[sector].state;
+}
+
+void cma_flash_index_close(void)
+{
+    if (cma_flash_mutex == NULL || cma_flash_index == NULL)
+        return;
+
+    OS_MUTEX_GET(cma_flash_mutex, OS_MUTEX_FOREVER);
+
+    OS_FREE(cma_flash_index->entry);
+    OS_FREE(cma_flash_index->record_offset);
+    OS_FREE(cma_flash_index);
+    cma_flash_index = NULL;
+
+    OS_MUTEX_PUT(cma_flash_mutex);
+}
+
+const uint8_t* cma_flash_map(void *handle, uint32_t startAddress, uint32_t dataLength)
+{
+    const uint8_t *mapped = NULL;
+
+    if (cma_flash_mutex == NULL || handle == NULL || dataLength == 0)
+        return NULL;
+
+    if (startAddress < SFLASH_USER_AREA_START || dataLength > SFLASH_ALLOC_SIZE_USER
+            || (startAddress - SFLASH_USER_AREA_START) > (SFLASH_ALLOC_SIZE_USER - dataLength))
+    {
+        LOG(LOG_ERR, "flash map : 0x%x (0x%x) is out of user area", startAddress, dataLength);
+        return NULL;
+    }
+
+    OS_MUTEX_GET(cma_flash_mutex, OS_MUTEX_FOREVER);
+
+    for (uint32_t i = 0; i < CMA_FLASH_MAP_MAX; i++)
+    {
+        struct cma_flash_map_t *map = &cma_flash_map_table[i];
+
+        if (map->length == 0)
+        {
+            map->address = startAddress;
+            map->length = dataLength;
+            mapped = (const uint8_t*) (CMA_FLASH_XIP_BASE + startAddress);
+
+            if (cma_flash_map_stale)
+            {
+                CMA_FLASH_XIP_CACHE_INVALIDATE();
+                cma_flash_map_stale = 0;
+            }
+            break;
+        }
+    }
+
+    OS_MUTEX_PUT(cma_flash_mutex);
+
+    if (mapped == NULL)
+    {
+        LOG(LOG_ERR, "flash map : no free entry");
+    }
+
+    return mapped;
+}
+
+CMA_STATUS_TYPE cma_flash_unmap(void *handle, const uint8_t *mapped)
+{
+    CMA_STATUS_TYPE ret = CMA_STATUS_FAIL;
+    uint32_t address = (uint32_t) mapped - CMA_FLASH_XIP_BASE;
+
+    if (cma_flash_mutex == NULL || handle == NULL || mapped == NULL)
+        return CMA_STATUS_FAIL;
+
+    OS_MUTEX_GET(cma_flash_mutex, OS_MUTEX_FOREVER);
+
+    for (uint32_t i = 0; i < CMA_FLASH_MAP_MAX; i++)
+    {
+        struct cma_flash_map_t *map = &cma_flash_map_table[i];
+
+        if (map->length != 0 && map->address == address)
+        {
+            map->length = 0;
+            ret = CMA_STATUS_OK;
+            break;
+        }
+    }
+
+    OS_MUTEX_PUT(cma_flash_mutex);
+
+    return ret;
+}
+
+uint32_t cma_flash_get_erase_count(void)
+{
+    return cma_flash_erase_count;
+}
@@ -0,0 +1,491 @@
+/**
+ ****************************************************************************************
+ *
+ * @file cma_rtm_counter.c
+ *
+ * @brief Counters in retention memory with checkpoints in flash.
+ *
+ * Copyright (c) 2016-2024 Renesas Electronics. All rights reserved.
+ *
+ * This software ("Software") is owned by Renesas Electronics.
+ *
+ * By using this Software you agree that Renesas Electronics retains all
+ * intellectual property and proprietary rights in and to this Software and any
+ * use, reproduction, disclosure or distribution of the Software without express
+ * written permission or a license agreement from Renesas Electronics is
+ * strictly prohibited. This Software is solely for use on or in conjunction
+ * with Renesas Electronics products.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE
+ * SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. EXCEPT AS OTHERWISE
+ * PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * RENESAS ELECTRONICS BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL,
+ * OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ *
+ ****************************************************************************************
+ */
+
+#include "sdk_type.h"
+#include "da16x_system.h"
+#include "rtc.h"
+#include "cma_debug.h"
+#include "cma_osal.h"
+#include "cma_flash.h"
+#include "cma_rtm_data.h"
+#include "cma_rtm_counter.h"
+
+#define CMA_RTM_COUNTER_TAG             "cma_counter"
+#define CMA_RTM_COUNTER_MAGIC           0x544E4352  /* "RCNT" */
+#define CMA_RTM_COUNTER_SECTOR_SIZE     4096
+#define CMA_RTM_COUNTER_ERASED          0xFFFFFFFF
+
+/* RTC runs at 32768Hz also in sleep */
+#define CMA_RTM_COUNTER_NOW()           ((uint32_t) (RTC_GET_COUNTER() >> 15))
+
+/* Checkpoint in flash log */
+struct cma_rtm_counter_record_t
+{
+    uint32_t tag_hash;
+    uint32_t value;
+    uint32_t sequence;
+    uint32_t check;
+};
+
+struct cma_rtm_counter_entry_t
+{
+    uint32_t tag_hash;
+    uint32_t value;
+    uint32_t saved_value;
+    uint32_t saved_time;
+};
+
+/* State in retention memory */
+struct cma_rtm_counter_state_t
+{
+    uint32_t magic;
+    uint32_t flash_address;
+    uint32_t sequence;
+    uint16_t log_offset;
+    uint8_t active;
+    uint8_t count;
+    struct cma_rtm_counter_entry_t entry[CMA_RTM_COUNTER_MAX];
+};
+
+static OS_MUTEX cma_rtm_counter_mutex;
+static struct cma_rtm_counter_state_t *cma_rtm_counter;
+static cma_rtm_counter_policy_t cma_rtm_counter_policy[CMA_RTM_COUNTER_MAX];
+
+static uint32_t cmai_rtm_counter_hash(const char *tag)
+{
+    uint32_t hash = 0x811C9DC5;
+
+    while (*tag)
+    {
+        hash = (hash ^ (uint8_t) *tag++) * 0x01000193;
+    }
+
+    return hash;
+}
+
+static uint32_t cmai_rtm_counter_check(const struct cma_rtm_counter_record_t *record)
+{
+    return record->tag_hash ^ record->value ^ record->sequence ^ CMA_RTM_COUNTER_MAGIC;
+}
+
+static uint32_t cmai_rtm_counter_sector(uint8_t index)
+{
+    return cma_rtm_counter->flash_address + index * CMA_RTM_COUNTER_SECTOR_SIZE;
+}
+
+static CMA_STATUS_TYPE cmai_rtm_counter_program(void *handle, uint32_t address, struct cma_rtm_counter_entry_t *entry)
+{
+    struct cma_rtm_counter_record_t record;
+
+    record.tag_hash = entry->tag_hash;
+    record.value = entry->value;
+    record.sequence = ++cma_rtm_counter->sequence;
+    record.check = cmai_rtm_counter_check (&record);
+
+    if (cma_flash_program (handle, address, (uint8_t*) &record, sizeof(record)) != CMA_STATUS_OK)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    entry->saved_value = entry->value;
+    entry->saved_time = CMA_RTM_COUNTER_NOW();
+
+    return CMA_STATUS_OK;
+}
+
+/* Log is full : erase the other sector and write latest values of all counters there */
+static CMA_STATUS_TYPE cmai_rtm_counter_compact(void *handle)
+{
+    uint8_t next = cma_rtm_counter->active ^ 1;
+    uint32_t address = cmai_rtm_counter_sector (next);
+
+    if (cma_flash_erase (handle, address, CMA_RTM_COUNTER_SECTOR_SIZE) != CMA_STATUS_OK)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    for (uint32_t i = 0; i < cma_rtm_counter->count; i++)
+    {
+        if (cmai_rtm_counter_program (handle, address + i * sizeof(struct cma_rtm_counter_record_t),
+                                      &cma_rtm_counter->entry[i]) != CMA_STATUS_OK)
+        {
+            return CMA_STATUS_FAIL;
+        }
+    }
+
+    cma_rtm_counter->active = next;
+    cma_rtm_counter->log_offset = cma_rtm_counter->count * sizeof(struct cma_rtm_counter_record_t);
+
+    return CMA_STATUS_OK;
+}
+
+static CMA_STATUS_TYPE cmai_rtm_counter_checkpoint(struct cma_rtm_counter_entry_t *entry)
+{
+    CMA_STATUS_TYPE ret = CMA_STATUS_OK;
+    void *handle;
+
+    handle = cma_flash_open ();
+    if (handle == NULL)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    if (cma_rtm_counter->log_offset + sizeof(struct cma_rtm_counter_record_t) > CMA_RTM_COUNTER_SECTOR_SIZE)
+    {
+        /* Snapshot includes this counter */
+        ret = cmai_rtm_counter_compact (handle);
+    }
+    else
+    {
+        ret = cmai_rtm_counter_program (handle, cmai_rtm_counter_sector (cma_rtm_counter->active)
+                                        + cma_rtm_counter->log_offset, entry);
+        cma_rtm_counter->log_offset += sizeof(struct cma_rtm_counter_record_t);
+    }
+
+    cma_flash_close (handle);
+
+    return ret;
+}
+
+/* Retention memory is lost : latest value of each counter is the one with highest sequence */
+static void cmai_rtm_counter_restore(void)
+{
+    uint32_t sequence[CMA_RTM_COUNTER_MAX];
+    struct cma_rtm_counter_record_t *record;
+    uint32_t max_sequence = 0;
+    uint8_t *buffer;
+    void *handle;
+
+    buffer = OS_MALLOC(CMA_RTM_COUNTER_SECTOR_SIZE);
+    handle = cma_flash_open ();
+    if (buffer == NULL || handle == NULL)
+    {
+        goto end;
+    }
+
+    for (uint8_t s = 0; s < 2; s++)
+    {
+        uint32_t end = 0;
+
+        if (cma_flash_read (handle, cmai_rtm_counter_sector (s), buffer, CMA_RTM_COUNTER_SECTOR_SIZE) != CMA_STATUS_OK)
+        {
+            continue;
+        }
+
+        for (uint32_t offset = 0; offset < CMA_RTM_COUNTER_SECTOR_SIZE; offset += sizeof(*record))
+        {
+            uint32_t i;
+
+            record = (struct cma_rtm_counter_record_t*) &buffer[offset];
+            if (record->tag_hash == CMA_RTM_COUNTER_ERASED && record->check == CMA_RTM_COUNTER_ERASED)
+            {
+                break;
+            }
+
+            end = offset + sizeof(*record);
+
+            /* Torn write */
+            if (record->check != cmai_rtm_counter_check (record))
+            {
+                continue;
+            }
+
+            if (record->sequence > max_sequence)
+            {
+                max_sequence = record->sequence;
+                cma_rtm_counter->active = s;
+                cma_rtm_counter->log_offset = end;
+            }
+
+            for (i = 0; i < cma_rtm_counter->count; i++)
+            {
+                if (cma_rtm_counter->entry[i].tag_hash == record->tag_hash)
+                {
+                    break;
+                }
+            }
+
+            if (i == cma_rtm_counter->count)
+            {
+                if (i == CMA_RTM_COUNTER_MAX)
+                {
+                    continue;
+                }
+
+                cma_rtm_counter->count++;
+                cma_rtm_counter->entry[i].tag_hash = record->tag_hash;
+                sequence[i] = 0;
+            }
+
+            if (record->sequence >= sequence[i])
+            {
+                sequence[i] = record->sequence;
+                cma_rtm_counter->entry[i].value = record->value;
+                cma_rtm_counter->entry[i].saved_value = record->value;
+                cma_rtm_counter->entry[i].saved_time = CMA_RTM_COUNTER_NOW();
+            }
+        }
+
+        if (s == cma_rtm_counter->active)
+        {
+            cma_rtm_counter->log_offset = end;
+        }
+    }
+
+    cma_rtm_counter->sequence = max_sequence;
+
+    LOG(LOG_INFO, "%d counters restored from flash (sequence %d)", cma_rtm_counter->count, max_sequence);
+
+end:
+    if (handle)
+    {
+        cma_flash_close (handle);
+    }
+
+    if (buffer)
+    {
+        OS_FREE(buffer);
+    }
+}
+
+CMA_STATUS_TYPE cma_rtm_counter_init(uint32_t flashAddress)
+{
+    struct cma_rtm_counter_state_t *state = NULL;
+
+    if ((flashAddress % CMA_RTM_COUNTER_SECTOR_SIZE) != 0)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    if (cma_rtm_counter_mutex == NULL)
+    {
+        OS_MUTEX_CREATE(cma_rtm_counter_mutex);
+        OS_ASSERT(cma_rtm_counter_mutex);
+    }
+
+    if (cma_rtm_data_alloc_and_read ((uint8_t*) CMA_RTM_COUNTER_TAG, (uint8_t**) &state,
+                                     sizeof(struct cma_rtm_counter_state_t)) != CMA_STATUS_OK)
+    {
+        LOG(LOG_ERR, "counter alloc in rtm failed");
+        return CMA_STATUS_FAIL;
+    }
+
+    OS_MUTEX_GET(cma_rtm_counter_mutex, OS_MUTEX_FOREVER);
+
+    cma_rtm_counter = state;
+
+    if (state->magic != CMA_RTM_COUNTER_MAGIC || state->flash_address != flashAddress
+            || state->count > CMA_RTM_COUNTER_MAX || state->active > 1
+            || state->log_offset > CMA_RTM_COUNTER_SECTOR_SIZE)
+    {
+        memset (state, 0, sizeof(struct cma_rtm_counter_state_t));
+        state->magic = CMA_RTM_COUNTER_MAGIC;
+        state->flash_address = flashAddress;
+
+        cmai_rtm_counter_restore ();
+    }
+
+    memset (cma_rtm_counter_policy, 0, sizeof(cma_rtm_counter_policy));
+
+    OS_MUTEX_PUT(cma_rtm_counter_mutex);
+
+    return CMA_STATUS_OK;
+}
+
+CMA_STATUS_TYPE cma_rtm_counter_open(const char *tag, const cma_rtm_counter_policy_t *policy, uint32_t *id)
+{
+    uint32_t hash, i;
+
+    if (cma_rtm_counter == NULL || tag == NULL || id == NULL)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    hash = cmai_rtm_counter_hash (tag);
+
+    OS_MUTEX_GET(cma_rtm_counter_mutex, OS_MUTEX_FOREVER);
+
+    for (i = 0; i < cma_rtm_counter->count; i++)
+    {
+        if (cma_rtm_counter->entry[i].tag_hash == hash)
+        {
+            break;
+        }
+    }
+
+    if (i == cma_rtm_counter->count)
+    {
+        if (i == CMA_RTM_COUNTER_MAX)
+        {
+            OS_MUTEX_PUT(cma_rtm_counter_mutex);
+            return CMA_STATUS_FAIL;
+        }
+
+        memset (&cma_rtm_counter->entry[i], 0, sizeof(struct cma_rtm_counter_entry_t));
+        cma_rtm_counter->entry[i].tag_hash = hash;
+        cma_rtm_counter->entry[i].saved_time = CMA_RTM_COUNTER_NOW();
+        cma_rtm_counter->count++;
+    }
+
+    if (policy != NULL)
+    {
+        cma_rtm_counter_policy[i] = *policy;
+    }
+
+    *id = i;
+
+    OS_MUTEX_PUT(cma_rtm_counter_mutex);
+
+    return CMA_STATUS_OK;
+}
+
+uint32_t cma_rtm_counter_add(uint32_t id, uint32_t delta)
+{
+    struct cma_rtm_counter_entry_t *entry;
+    cma_rtm_counter_policy_t *policy;
+    uint32_t value;
+
+    if (cma_rtm_counter == NULL || id >= cma_rtm_counter->count)
+    {
+        return 0;
+    }
+
+    OS_MUTEX_GET(cma_rtm_counter_mutex, OS_MUTEX_FOREVER);
+
+    entry = &cma_rtm_counter->entry[id];
+    policy = &cma_rtm_counter_policy[id];
+
+    entry->value += delta;
+    cma_rtm_data_touch (entry);
+
+    if ((policy->every_count != 0 && entry->value - entry->saved_value >= policy->every_count)
+            || (policy->every_sec != 0 && CMA_RTM_COUNTER_NOW() - entry->saved_time >= policy->every_sec))
+    {
+        cmai_rtm_counter_checkpoint (entry);
+    }
+
+    value = entry->value;
+
+    OS_MUTEX_PUT(cma_rtm_counter_mutex);
+
+    return value;
+}
+
+CMA_STATUS_TYPE cma_rtm_counter_set(uint32_t id, uint32_t value)
+{
+    if (cma_rtm_counter == NULL || id >= cma_rtm_counter->count)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    OS_MUTEX_GET(cma_rtm_counter_mutex, OS_MUTEX_FOREVER);
+
+    cma_rtm_counter->entry[id].value = value;
+    cma_rtm_data_touch (&cma_rtm_counter->entry[id]);
+
+    OS_MUTEX_PUT(cma_rtm_counter_mutex);
+
+    return CMA_STATUS_OK;
+}
+
+uint32_t cma_rtm_counter_get(uint32_t id)
+{
+    if (cma_rtm_counter == NULL || id >= cma_rtm_counter->count)
+    {
+        return 0;
+    }
+
+    return cma_rtm_counter->entry[id].value;
+}
+
+CMA_STATUS_TYPE cma_rtm_counter_checkpoint(void)
+{
+    CMA_STATUS_TYPE ret = CMA_STATUS_OK;
+
+    if (cma_rtm_counter == NULL)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    OS_MUTEX_GET(cma_rtm_counter_mutex, OS_MUTEX_FOREVER);
+
+    for (uint32_t i = 0; i < cma_rtm_counter->count; i++)
+    {
+        struct cma_rtm_counter_entry_t *entry = &cma_rtm_counter->entry[i];
+
+        if (entry->value != entry->saved_value && cmai_rtm_counter_checkpoint (entry) != CMA_STATUS_OK)
+        {
+            ret = CMA_STATUS_FAIL;
+        }
+    }
+
+    OS_MUTEX_PUT(cma_rtm_counter_mutex);
+
+    return ret;
+}
+
+CMA_STATUS_TYPE cma_rtm_counter_sleep(CMA_SLEEP_TYPE type)
+{
+    CMA_STATUS_TYPE ret = CMA_STATUS_OK;
+    uint32_t now = CMA_RTM_COUNTER_NOW();
+
+    if (cma_rtm_counter == NULL)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    OS_MUTEX_GET(cma_rtm_counter_mutex, OS_MUTEX_FOREVER);
+
+    for (uint32_t i = 0; i < cma_rtm_counter->count; i++)
+    {
+        struct cma_rtm_counter_entry_t *entry = &cma_rtm_counter->entry[i];
+        cma_rtm_counter_policy_t *policy = &cma_rtm_counter_policy[i];
+
+        if (entry->value == entry->saved_value)
+        {
+            continue;
+        }
+
+        if ((type == CMA_SLEEP_TYPE_2 && policy->before_sleep2)
+                || (policy->every_sec != 0 && now - entry->saved_time >= policy->every_sec))
+        {
+            if (cmai_rtm_counter_checkpoint (entry) != CMA_STATUS_OK)
+            {
+                ret = CMA_STATUS_FAIL;
+            }
+        }
+    }
+
+    OS_MUTEX_PUT(cma_rtm_counter_mutex);
+
+    return ret;
+}
@@ -0,0 +1,759 @@
+/**
+ ****************************************************************************************
+ *
+ * @file cma_rtm_store.c
+ *
+ * @brief Tiered state store on retention memory and flash.
+ *
+ * Copyright (c) 2016-2024 Renesas Electronics. All rights reserved.
+ *
+ * This software ("Software") is owned by Renesas Electronics.
+ *
+ * By using this Software you agree that Renesas Electronics retains all
+ * intellectual property and proprietary rights in and to this Software and any
+ * use, reproduction, disclosure or distribution of the Software without express
+ * written permission or a license agreement from Renesas Electronics is
+ * strictly prohibited. This Software is solely for use on or in conjunction
+ * with Renesas Electronics products.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE
+ * SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. EXCEPT AS OTHERWISE
+ * PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * RENESAS ELECTRONICS BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL,
+ * OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ *
+ ****************************************************************************************
+ */
+
+#include "sdk_type.h"
+#include "da16x_system.h"
+#include "cma_debug.h"
+#include "cma_osal.h"
+#include "cma_flash.h"
+#include "cma_rtm_data.h"
+#include "cma_rtm_store.h"
+
+#define CMA_RTM_STORE_TAG               "cma_store"
+#define CMA_RTM_STORE_HOT_TAG           "cma_store_hot"
+#define CMA_RTM_STORE_MAGIC             0x32524F54  /* "TOR2" */
+#define CMA_RTM_STORE_ALIGN(x)          (((x) + 3) & ~3)
+#define CMA_RTM_STORE_SECTOR_SIZE       4096
+#define CMA_RTM_STORE_ERASED            0xFFFFFFFF
+
+#define CMA_RTM_STORE_IN_RTM            (1 << 0)
+
+/* flash_offset of a record never written to flash */
+#define CMA_RTM_STORE_NO_SLOT           0xFFFFFFFF
+
+/* Tag hash of the slot closing a compaction */
+#define CMA_RTM_STORE_COMMIT            0
+
+/* Slot in flash log, followed by data */
+struct cma_rtm_store_slot_t
+{
+    uint32_t tag_hash;
+    uint16_t size;
+    uint16_t reserved;
+    uint32_t sequence;
+    uint32_t data_check;
+    uint32_t check;
+};
+
+#define CMA_RTM_STORE_SLOT_SIZE(len)    (sizeof(struct cma_rtm_store_slot_t) + CMA_RTM_STORE_ALIGN(len))
+
+struct cma_rtm_store_entry_t
+{
+    uint32_t tag_hash;
+    uint16_t size;
+    uint16_t access;
+    uint16_t rtm_offset;
+    uint8_t flags;
+    uint8_t reserved;
+    uint32_t flash_offset;      /* of latest slot, from flash_address */
+};
+
+/* Directory in retention memory, rebuilt from flash log when it is lost */
+struct cma_rtm_store_t
+{
+    uint32_t magic;
+    uint32_t rtm_budget;
+    uint32_t flash_address;
+    uint32_t flash_length;
+    uint32_t flash_used;        /* latest slots of all records and commit, must fit in a half */
+    uint32_t log_offset;        /* end of log in active half */
+    uint32_t sequence;
+    uint16_t rtm_used;
+    uint16_t count;
+    uint8_t active;
+    uint8_t reserved[3];
+    struct cma_rtm_store_entry_t entry[CMA_RTM_STORE_RECORD_MAX];
+};
+
+/* One half of flash area, while rebuilding */
+struct cma_rtm_store_scan_t
+{
+    uint32_t end;
+    uint32_t max_sequence;
+    uint8_t slots;
+    uint8_t commit;
+};
+
+static OS_MUTEX cma_rtm_store_mutex;
+static struct cma_rtm_store_t *cma_rtm_store;
+static uint8_t *cma_rtm_store_hot;
+
+static uint32_t cmai_rtm_store_hash(const char *tag)
+{
+    uint32_t hash = 0x811C9DC5;
+
+    while (*tag)
+    {
+        hash = (hash ^ (uint8_t) *tag++) * 0x01000193;
+    }
+
+    return hash;
+}
+
+static uint32_t cmai_rtm_store_data_check(const uint8_t *data, uint16_t len)
+{
+    uint32_t hash = 0x811C9DC5;
+
+    for (uint16_t i = 0; i < len; i++)
+    {
+        hash = (hash ^ data[i]) * 0x01000193;
+    }
+
+    return hash;
+}
+
+static uint32_t cmai_rtm_store_check(const struct cma_rtm_store_slot_t *slot)
+{
+    return slot->tag_hash ^ slot->size ^ slot->sequence ^ slot->data_check ^ CMA_RTM_STORE_MAGIC;
+}
+
+static uint32_t cmai_rtm_store_half(uint8_t index)
+{
+    return index * (cma_rtm_store->flash_length / 2);
+}
+
+static struct cma_rtm_store_entry_t* cmai_rtm_store_find_hash(uint32_t hash)
+{
+    for (uint32_t i = 0; i < cma_rtm_store->count; i++)
+    {
+        if (cma_rtm_store->entry[i].tag_hash == hash)
+        {
+            return &cma_rtm_store->entry[i];
+        }
+    }
+
+    return NULL;
+}
+
+static struct cma_rtm_store_entry_t* cmai_rtm_store_find(const char *tag)
+{
+    return cmai_rtm_store_find_hash (cmai_rtm_store_hash (tag));
+}
+
+static CMA_STATUS_TYPE cmai_rtm_store_read_slot(void *handle, struct cma_rtm_store_entry_t *entry, uint8_t *data)
+{
+    return cma_flash_read (handle, cma_rtm_store->flash_address + entry->flash_offset
+                           + sizeof(struct cma_rtm_store_slot_t), data, entry->size);
+}
+
+/* Header is programmed before data, so a torn data write is found by data_check */
+static CMA_STATUS_TYPE cmai_rtm_store_program(void *handle, uint32_t offset, uint32_t hash, const uint8_t *data,
+                                              uint16_t len)
+{
+    struct cma_rtm_store_slot_t slot;
+    uint32_t address = cma_rtm_store->flash_address + offset;
+
+    slot.tag_hash = hash;
+    slot.size = len;
+    slot.reserved = 0xFFFF;
+    slot.sequence = ++cma_rtm_store->sequence;
+    slot.data_check = cmai_rtm_store_data_check (data, len);
+    slot.check = cmai_rtm_store_check (&slot);
+
+    if (cma_flash_program (handle, address, (uint8_t*) &slot, sizeof(slot)) != CMA_STATUS_OK)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    if (len > 0 && cma_flash_program (handle, address + sizeof(slot), (uint8_t*) data, len) != CMA_STATUS_OK)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    return CMA_STATUS_OK;
+}
+
+/*
+ * Log is full : erase the other half, copy latest value of all records there with the new
+ * data of entry, and close it with a commit slot. Offsets change only after the commit, so
+ * records are still read from the old half if it fails.
+ */
+static CMA_STATUS_TYPE cmai_rtm_store_compact(void *handle, struct cma_rtm_store_entry_t *target,
+                                              const uint8_t *data)
+{
+    uint32_t offset[CMA_RTM_STORE_RECORD_MAX];
+    uint8_t next = cma_rtm_store->active ^ 1;
+    uint32_t base = cmai_rtm_store_half (next);
+    uint32_t used = 0;
+    CMA_STATUS_TYPE ret = CMA_STATUS_OK;
+
+    if (cma_flash_erase (handle, cma_rtm_store->flash_address + base, cma_rtm_store->flash_length / 2)
+            != CMA_STATUS_OK)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    for (uint32_t i = 0; i < cma_rtm_store->count && ret == CMA_STATUS_OK; i++)
+    {
+        struct cma_rtm_store_entry_t *entry = &cma_rtm_store->entry[i];
+        uint8_t *buffer = NULL;
+        const uint8_t *source;
+
+        offset[i] = entry->flash_offset;
+
+        if (entry == target)
+        {
+            source = data;
+        }
+        else if (entry->flags & CMA_RTM_STORE_IN_RTM)
+        {
+            source = &cma_rtm_store_hot[entry->rtm_offset];
+        }
+        else if (entry->flash_offset != CMA_RTM_STORE_NO_SLOT)
+        {
+            buffer = OS_MALLOC(entry->size);
+            if (buffer == NULL || cmai_rtm_store_read_slot (handle, entry, buffer) != CMA_STATUS_OK)
+            {
+                ret = CMA_STATUS_FAIL;
+            }
+            source = buffer;
+        }
+        else
+        {
+            continue;
+        }
+
+        if (ret == CMA_STATUS_OK)
+        {
+            ret = cmai_rtm_store_program (handle, base + used, entry->tag_hash, source, entry->size);
+            offset[i] = base + used;
+            used += CMA_RTM_STORE_SLOT_SIZE(entry->size);
+        }
+
+        if (buffer)
+        {
+            OS_FREE(buffer);
+        }
+    }
+
+    if (ret != CMA_STATUS_OK
+            || cmai_rtm_store_program (handle, base + used, CMA_RTM_STORE_COMMIT, NULL, 0) != CMA_STATUS_OK)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    for (uint32_t i = 0; i < cma_rtm_store->count; i++)
+    {
+        cma_rtm_store->entry[i].flash_offset = offset[i];
+    }
+
+    cma_rtm_store->active = next;
+    cma_rtm_store->log_offset = used + CMA_RTM_STORE_SLOT_SIZE(0);
+
+    return CMA_STATUS_OK;
+}
+
+/* Append new value of a record to the log, the sector is only erased by compaction */
+static CMA_STATUS_TYPE cmai_rtm_store_append(void *handle, struct cma_rtm_store_entry_t *entry, const uint8_t *data)
+{
+    CMA_STATUS_TYPE ret;
+
+    if (cma_rtm_store->log_offset + CMA_RTM_STORE_SLOT_SIZE(entry->size) > cma_rtm_store->flash_length / 2)
+    {
+        ret = cmai_rtm_store_compact (handle, entry, data);
+    }
+    else
+    {
+        uint32_t offset = cmai_rtm_store_half (cma_rtm_store->active) + cma_rtm_store->log_offset;
+
+        /* Space is used even if programming fails, the slot may be partly written */
+        cma_rtm_store->log_offset += CMA_RTM_STORE_SLOT_SIZE(entry->size);
+
+        ret = cmai_rtm_store_program (handle, offset, entry->tag_hash, data, entry->size);
+        if (ret == CMA_STATUS_OK)
+        {
+            entry->flash_offset = offset;
+        }
+    }
+
+    return ret;
+}
+
+/* Read slots of a half, restore records if apply is set */
+static void cmai_rtm_store_scan(void *handle, uint8_t index, struct cma_rtm_store_scan_t *scan, uint32_t *sequence,
+                                uint8_t apply)
+{
+    struct cma_rtm_store_slot_t slot;
+    uint32_t half = cma_rtm_store->flash_length / 2;
+    uint32_t base = cmai_rtm_store_half (index);
+    uint32_t offset = 0;
+    uint8_t *buffer;
+
+    memset (scan, 0, sizeof(struct cma_rtm_store_scan_t));
+
+    while (offset + sizeof(slot) <= half)
+    {
+        if (cma_flash_read (handle, cma_rtm_store->flash_address + base + offset, (uint8_t*) &slot, sizeof(slot))
+                != CMA_STATUS_OK)
+        {
+            offset = half;
+            break;
+        }
+
+        if (slot.tag_hash == CMA_RTM_STORE_ERASED && slot.check == CMA_RTM_STORE_ERASED)
+        {
+            break;
+        }
+
+        /* Torn header, size is not known : rest of half is not used until next compaction */
+        if (slot.check != cmai_rtm_store_check (&slot) || offset + CMA_RTM_STORE_SLOT_SIZE(slot.size) > half)
+        {
+            offset = half;
+            break;
+        }
+
+        if (slot.tag_hash == CMA_RTM_STORE_COMMIT)
+        {
+            scan->commit = 1;
+        }
+        else
+        {
+            /* Torn data write is skipped */
+            buffer = OS_MALLOC(slot.size);
+            if (buffer != NULL
+                    && cma_flash_read (handle, cma_rtm_store->flash_address + base + offset + sizeof(slot), buffer,
+                                       slot.size) == CMA_STATUS_OK
+                    && cmai_rtm_store_data_check (buffer, slot.size) == slot.data_check)
+            {
+                scan->slots = 1;
+
+                if (apply)
+                {
+                    struct cma_rtm_store_entry_t *entry = cmai_rtm_store_find_hash (slot.tag_hash);
+                    uint32_t i = cma_rtm_store->count;
+
+                    if (entry != NULL)
+                    {
+                        i = entry - cma_rtm_store->entry;
+                    }
+                    else if (i < CMA_RTM_STORE_RECORD_MAX)
+                    {
+                        entry = &cma_rtm_store->entry[cma_rtm_store->count++];
+                        memset (entry, 0, sizeof(struct cma_rtm_store_entry_t));
+                        entry->tag_hash = slot.tag_hash;
+                        sequence[i] = 0;
+                    }
+
+                    if (entry != NULL && slot.sequence >= sequence[i])
+                    {
+                        sequence[i] = slot.sequence;
+                        entry->size = slot.size;
+                        entry->flash_offset = base + offset;
+                    }
+                }
+            }
+
+            if (buffer)
+            {
+                OS_FREE(buffer);
+            }
+        }
+
+        if (slot.sequence > scan->max_sequence)
+        {
+            scan->max_sequence = slot.sequence;
+        }
+
+        offset += CMA_RTM_STORE_SLOT_SIZE(slot.size);
+    }
+
+    scan->end = offset;
+}
+
+/*
+ * Retention memory is lost : latest slot of each record is its value. A half without
+ * commit is the target of an interrupted compaction when the other half has slots, so
+ * it is not used and is erased by next compaction (the first half of a new area has no commit).
+ */
+static void cmai_rtm_store_restore(void)
+{
+    struct cma_rtm_store_scan_t scan[2];
+    uint32_t sequence[CMA_RTM_STORE_RECORD_MAX];
+    uint8_t valid[2];
+    void *handle;
+
+    handle = cma_flash_open ();
+    if (handle == NULL)
+    {
+        return;
+    }
+
+    cmai_rtm_store_scan (handle, 0, &scan[0], sequence, 0);
+    cmai_rtm_store_scan (handle, 1, &scan[1], sequence, 0);
+
+    valid[0] = scan[0].slots || scan[0].commit;
+    valid[1] = scan[1].slots || scan[1].commit;
+
+    if (valid[0] && valid[1])
+    {
+        if (!scan[0].commit && !scan[1].commit)
+        {
+            valid[(scan[0].max_sequence > scan[1].max_sequence) ? 0 : 1] = 0;
+        }
+        else
+        {
+            valid[0] = scan[0].commit;
+            valid[1] = scan[1].commit;
+        }
+    }
+
+    cma_rtm_store->active = (valid[1] && (!valid[0] || scan[1].max_sequence > scan[0].max_sequence)) ? 1 : 0;
+    cma_rtm_store->log_offset = scan[cma_rtm_store->active].end;
+    cma_rtm_store->sequence = (scan[0].max_sequence > scan[1].max_sequence) ? scan[0].max_sequence
+                                                                            : scan[1].max_sequence;
+
+    for (uint8_t s = 0; s < 2; s++)
+    {
+        if (valid[s])
+        {
+            cmai_rtm_store_scan (handle, s, &scan[s], sequence, 1);
+        }
+    }
+
+    for (uint32_t i = 0; i < cma_rtm_store->count; i++)
+    {
+        cma_rtm_store->flash_used += CMA_RTM_STORE_SLOT_SIZE(cma_rtm_store->entry[i].size);
+    }
+
+    cma_flash_close (handle);
+
+    LOG(LOG_INFO, "%d records restored from flash (sequence %d)", cma_rtm_store->count, cma_rtm_store->sequence);
+}
+
+CMA_STATUS_TYPE cma_rtm_store_init(uint32_t rtmBudget, uint32_t flashAddress, uint32_t flashLength)
+{
+    struct cma_rtm_store_t *store = NULL;
+
+    rtmBudget = CMA_RTM_STORE_ALIGN(rtmBudget);
+    if (rtmBudget == 0 || rtmBudget > 0xFFFF || (flashAddress % CMA_RTM_STORE_SECTOR_SIZE) != 0
+            || flashLength == 0 || (flashLength % (2 * CMA_RTM_STORE_SECTOR_SIZE)) != 0)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    if (cma_rtm_store_mutex == NULL)
+    {
+        OS_MUTEX_CREATE(cma_rtm_store_mutex);
+        OS_ASSERT(cma_rtm_store_mutex);
+    }
+
+    if (cma_rtm_data_alloc_and_read ((uint8_t*) CMA_RTM_STORE_TAG, (uint8_t**) &store,
+                                     sizeof(struct cma_rtm_store_t)) != CMA_STATUS_OK
+            || cma_rtm_data_alloc_and_read ((uint8_t*) CMA_RTM_STORE_HOT_TAG, &cma_rtm_store_hot,
+                                            rtmBudget) != CMA_STATUS_OK)
+    {
+        LOG(LOG_ERR, "store alloc in rtm failed");
+        return CMA_STATUS_FAIL;
+    }
+
+    OS_MUTEX_GET(cma_rtm_store_mutex, OS_MUTEX_FOREVER);
+
+    cma_rtm_store = store;
+
+    if (store->magic != CMA_RTM_STORE_MAGIC || store->rtm_budget != rtmBudget || store->flash_address != flashAddress
+            || store->flash_length != flashLength || store->count > CMA_RTM_STORE_RECORD_MAX
+            || store->active > 1 || store->log_offset > flashLength / 2)
+    {
+        memset (store, 0, sizeof(struct cma_rtm_store_t));
+        store->magic = CMA_RTM_STORE_MAGIC;
+        store->rtm_budget = rtmBudget;
+        store->flash_address = flashAddress;
+        store->flash_length = flashLength;
+        store->flash_used = CMA_RTM_STORE_SLOT_SIZE(0);
+
+        cmai_rtm_store_restore ();
+    }
+
+    OS_MUTEX_PUT(cma_rtm_store_mutex);
+
+    return CMA_STATUS_OK;
+}
+
+/* Log space kept free after compaction, so a full store does not erase on every write */
+static uint32_t cmai_rtm_store_headroom(uint16_t len)
+{
+    uint16_t largest = len;
+
+    for (uint32_t i = 0; i < cma_rtm_store->count; i++)
+    {
+        if (cma_rtm_store->entry[i].size > largest)
+            largest = cma_rtm_store->entry[i].size;
+    }
+
+    return CMA_RTM_STORE_HEADROOM_SLOTS * CMA_RTM_STORE_SLOT_SIZE(largest);
+}
+
+CMA_STATUS_TYPE cma_rtm_store_write(const char *tag, const void *data, uint16_t len)
+{
+    struct cma_rtm_store_entry_t *entry;
+    CMA_STATUS_TYPE ret = CMA_STATUS_OK;
+    void *handle;
+
+    if (cma_rtm_store == NULL || tag == NULL || data == NULL || len == 0)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    OS_MUTEX_GET(cma_rtm_store_mutex, OS_MUTEX_FOREVER);
+
+    entry = cmai_rtm_store_find (tag);
+    if (entry == NULL)
+    {
+        if (cma_rtm_store->count >= CMA_RTM_STORE_RECORD_MAX
+                || cma_rtm_store->flash_used + CMA_RTM_STORE_SLOT_SIZE(len) + cmai_rtm_store_headroom (len)
+                        > cma_rtm_store->flash_length / 2)
+        {
+            LOG(LOG_ERR, "[%s] store is full", tag);
+            OS_MUTEX_PUT(cma_rtm_store_mutex);
+            return CMA_STATUS_FAIL;
+        }
+
+        /* Space for a slot in a compacted half is reserved, so it can be demoted at any time */
+        entry = &cma_rtm_store->entry[cma_rtm_store->count++];
+        memset (entry, 0, sizeof(struct cma_rtm_store_entry_t));
+        entry->tag_hash = cmai_rtm_store_hash (tag);
+        entry->size = len;
+        entry->flash_offset = CMA_RTM_STORE_NO_SLOT;
+        cma_rtm_store->flash_used += CMA_RTM_STORE_SLOT_SIZE(len);
+
+        if (CMA_RTM_STORE_ALIGN(len) <= cma_rtm_store->rtm_budget - cma_rtm_store->rtm_used)
+        {
+            entry->flags |= CMA_RTM_STORE_IN_RTM;
+            entry->rtm_offset = cma_rtm_store->rtm_used;
+            cma_rtm_store->rtm_used += CMA_RTM_STORE_ALIGN(len);
+        }
+    }
+    else if (entry->size != len)
+    {
+        LOG(LOG_ERR, "[%s] size (%d) is different from stored one (%d)", tag, len, entry->size);
+        OS_MUTEX_PUT(cma_rtm_store_mutex);
+        return CMA_STATUS_FAIL;
+    }
+
+    if (entry->access < 0xFFFF)
+    {
+        entry->access++;
+    }
+
+    if (entry->flags & CMA_RTM_STORE_IN_RTM)
+    {
+        memcpy (&cma_rtm_store_hot[entry->rtm_offset], data, len);
+        cma_rtm_data_touch (cma_rtm_store_hot);
+    }
+    else
+    {
+        handle = cma_flash_open ();
+        ret = (handle != NULL) ? cmai_rtm_store_append (handle, entry, data) : CMA_STATUS_FAIL;
+        if (handle)
+        {
+            cma_flash_close (handle);
+        }
+    }
+
+    OS_MUTEX_PUT(cma_rtm_store_mutex);
+
+    return ret;
+}
+
+CMA_STATUS_TYPE cma_rtm_store_read(const char *tag, void *data, uint16_t len)
+{
+    struct cma_rtm_store_entry_t *entry;
+    CMA_STATUS_TYPE ret = CMA_STATUS_OK;
+    void *handle;
+
+    if (cma_rtm_store == NULL || tag == NULL || data == NULL)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    OS_MUTEX_GET(cma_rtm_store_mutex, OS_MUTEX_FOREVER);
+
+    entry = cmai_rtm_store_find (tag);
+    if (entry == NULL || entry->size != len
+            || (!(entry->flags & CMA_RTM_STORE_IN_RTM) && entry->flash_offset == CMA_RTM_STORE_NO_SLOT))
+    {
+        OS_MUTEX_PUT(cma_rtm_store_mutex);
+        return CMA_STATUS_FAIL;
+    }
+
+    if (entry->access < 0xFFFF)
+    {
+        entry->access++;
+    }
+
+    if (entry->flags & CMA_RTM_STORE_IN_RTM)
+    {
+        memcpy (data, &cma_rtm_store_hot[entry->rtm_offset], len);
+    }
+    else
+    {
+        handle = cma_flash_open ();
+        ret = (handle != NULL) ? cmai_rtm_store_read_slot (handle, entry, data) : CMA_STATUS_FAIL;
+        if (handle)
+        {
+            cma_flash_close (handle);
+        }
+    }
+
+    OS_MUTEX_PUT(cma_rtm_store_mutex);
+
+    return ret;
+}
+
+CMA_STATUS_TYPE cma_rtm_store_rebalance(void)
+{
+    uint8_t hot[CMA_RTM_STORE_RECORD_MAX];
+    uint8_t *layout;
+    uint16_t used = 0;
+    CMA_STATUS_TYPE ret = CMA_STATUS_OK;
+    void *handle;
+
+    if (cma_rtm_store == NULL)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    layout = OS_MALLOC(cma_rtm_store->rtm_budget);
+    handle = cma_flash_open ();
+    if (layout == NULL || handle == NULL)
+    {
+        if (handle)
+        {
+            cma_flash_close (handle);
+        }
+
+        if (layout)
+        {
+            OS_FREE(layout);
+        }
+
+        return CMA_STATUS_FAIL;
+    }
+
+    OS_MUTEX_GET(cma_rtm_store_mutex, OS_MUTEX_FOREVER);
+
+    /* Pick records by access count, most used first, while they fit */
+    memset (hot, 0, sizeof(hot));
+    for (uint32_t n = 0; n < cma_rtm_store->count; n++)
+    {
+        int32_t best = -1;
+
+        for (uint32_t i = 0; i < cma_rtm_store->count; i++)
+        {
+            if (!hot[i] && (best < 0 || cma_rtm_store->entry[i].access > cma_rtm_store->entry[best].access))
+            {
+                best = i;
+            }
+        }
+
+        hot[best] = 1;
+        if (CMA_RTM_STORE_ALIGN(cma_rtm_store->entry[best].size) > cma_rtm_store->rtm_budget - used
+                || (!(cma_rtm_store->entry[best].flags & CMA_RTM_STORE_IN_RTM)
+                    && cma_rtm_store->entry[best].flash_offset == CMA_RTM_STORE_NO_SLOT))
+        {
+            hot[best] = 2;
+            continue;
+        }
+
+        used += CMA_RTM_STORE_ALIGN(cma_rtm_store->entry[best].size);
+    }
+
+    /* Demote first, then build new hot area */
+    for (uint32_t i = 0; i < cma_rtm_store->count; i++)
+    {
+        struct cma_rtm_store_entry_t *entry = &cma_rtm_store->entry[i];
+
+        if (hot[i] != 1 && (entry->flags & CMA_RTM_STORE_IN_RTM))
+        {
+            if (cmai_rtm_store_append (handle, entry, &cma_rtm_store_hot[entry->rtm_offset]) != CMA_STATUS_OK)
+            {
+                /* Keep it in RTM, layout is not changed */
+                ret = CMA_STATUS_FAIL;
+                goto end;
+            }
+        }
+    }
+
+    used = 0;
+    for (uint32_t i = 0; i < cma_rtm_store->count; i++)
+    {
+        struct cma_rtm_store_entry_t *entry = &cma_rtm_store->entry[i];
+
+        if (hot[i] != 1)
+        {
+            continue;
+        }
+
+        if (entry->flags & CMA_RTM_STORE_IN_RTM)
+        {
+            memcpy (&layout[used], &cma_rtm_store_hot[entry->rtm_offset], entry->size);
+        }
+        else if (cmai_rtm_store_read_slot (handle, entry, &layout[used]) != CMA_STATUS_OK)
+        {
+            ret = CMA_STATUS_FAIL;
+            goto end;
+        }
+
+        used += CMA_RTM_STORE_ALIGN(entry->size);
+    }
+
+    used = 0;
+    for (uint32_t i = 0; i < cma_rtm_store->count; i++)
+    {
+        struct cma_rtm_store_entry_t *entry = &cma_rtm_store->entry[i];
+
+        if (hot[i] == 1)
+        {
+            entry->flags |= CMA_RTM_STORE_IN_RTM;
+            entry->rtm_offset = used;
+            used += CMA_RTM_STORE_ALIGN(entry->size);
+        }
+        else
+        {
+            entry->flags &= ~CMA_RTM_STORE_IN_RTM;
+        }
+
+        entry->access >>= 1;
+    }
+
+    memcpy (cma_rtm_store_hot, layout, used);
+    cma_rtm_store->rtm_used = used;
+    cma_rtm_data_touch (cma_rtm_store_hot);
+
+end:
+    OS_MUTEX_PUT(cma_rtm_store_mutex);
+
+    cma_flash_close (handle);
+    OS_FREE(layout);
+
+    return ret;
+}
@@ -30,34 +30,565 @@
  ****************************************************************************************
  */
 
+#if defined(CMA_SLEEP_SIM)
+#include "cma_sleep_sim.h"
+#else
 #include "sdk_type.h"
 #include "da16x_system.h"
 #include "da16x_types.h"
+#include "rtc.h"
+#endif
 #include "limits.h"
 #include "cma_debug.h"
 #include "cma_osal.h"
+#include "cma_rtm_data.h"
 #include "cma_sleep.h"
 
+#define CMA_SLEEP_REQUEST_TAG           "cma_sleep_req"
+#define CMA_SLEEP_REQUEST_MAGIC         0x51524C53  /* "SLRQ" */
+#define CMA_SLEEP_REQUEST_IDLE          0xFFFFFFFFFFFFFFFFULL
+
+#define CMA_SLEEP_HOOK_TAG              "cma_sleep_hook"
+#define CMA_SLEEP_HOOK_MAGIC            0x4B484C53  /* "SLHK" */
+
+#define CMA_SLEEP_BOOT_TAG              "cma_sleep_boot"
+#define CMA_SLEEP_BOOT_MAGIC            0x32544253  /* "SBT2" */
+
+#define CMA_SLEEP_ACCOUNT_TAG           "cma_sleep_acct"
+#define CMA_SLEEP_ACCOUNT_RING_TAG      "cma_sleep_cycle"
+#define CMA_SLEEP_ACCOUNT_MAGIC         0x54434153  /* "SACT" */
+
+#define CMA_SLEEP_WAKE_TAG              "cma_sleep_wake"
+#define CMA_SLEEP_WAKE_MAGIC            0x4B415753  /* "SWAK" */
+
+#define CMA_SLEEP_ADAPT_TAG             "cma_sleep_adpt"
+#define CMA_SLEEP_ADAPT_MAGIC           0x54504153  /* "SAPT" */
+
+#define CMA_SLEEP_RESUME_TAG            "cma_sleep_rsm"
+#define CMA_SLEEP_RESUME_MAGIC          0x4D535253  /* "SRSM" */
+
+/* RTC runs at 32768Hz also in sleep */
+#define CMA_SLEEP_NOW_MS()              ((RTC_GET_COUNTER() * 1000) >> 15)
+#define CMA_SLEEP_NOW_US()              ((RTC_GET_COUNTER() * 1000000) >> 15)
+
 extern void do_set_dpm_power_down(UINT64 usec, UCHAR retention);
 
+struct cma_sleep_request_entry_t
+{
+    uint32_t name_hash;
+    uint32_t reserved;
+    uint64_t deadline;          /* RTC time(millisecond) or CMA_SLEEP_REQUEST_IDLE */
+};
+
+/* Wake requests in retention memory */
+struct cma_sleep_request_state_t
+{
+    uint32_t magic;
+    uint32_t count;
+    struct cma_sleep_request_entry_t entry[CMA_SLEEP_REQUEST_MAX];
+};
+
+struct cma_sleep_request_handler_t
+{
+    cma_sleep_wake_handler_t func;
+    void *arg;
+};
+
+struct cma_sleep_lock_t
+{
+    const char *name;
+    uint32_t ref;
+    uint64_t acquired;
+    uint64_t expire;            /* RTC time(millisecond) or CMA_SLEEP_REQUEST_IDLE */
+    cma_sleep_lock_stats_t stats;
+};
+
+/* Hook statistics in retention memory, times in microsecond */
+struct cma_sleep_hook_entry_t
+{
+    uint32_t name_hash;
+    uint16_t deferred;          /* runs left to skip */
+    uint16_t reserved;
+    uint32_t runs;
+    uint32_t skips;
+    uint32_t overruns;
+    uint32_t last_time;
+    uint32_t max_time;
+    uint32_t total_time;
+};
+
+struct cma_sleep_hook_state_t
+{
+    uint32_t magic;
+    uint32_t count;
+    uint32_t chain_last[2];
+    uint32_t chain_total[2];
+    struct cma_sleep_hook_entry_t entry[CMA_SLEEP_HOOK_MAX];
+};
+
+struct cma_sleep_hook_info_t
+{
+    const char *name;
+    cma_sleep_hook_t func;
+    void *arg;
+    uint32_t budget;
+    uint8_t when;
+    uint8_t priority;
+    uint8_t flags;
+    struct cma_sleep_hook_entry_t *entry;
+};
+
+/* Boot costs in retention memory (millisecond) */
+struct cma_sleep_boot_state_t
+{
+    uint32_t magic;
+    uint32_t cold_boot;
+    uint32_t warm_boot;
+    uint16_t cold_count;
+    uint16_t warm_count;
+    uint32_t saved_cold;        /* last costs given to the boot store */
+    uint32_t saved_warm;
+};
+
+/* Accounting state in retention memory, cycle in progress is completed on wake-up */
+struct cma_sleep_account_state_t
+{
+    uint32_t magic;
+    uint32_t cycles;
+    uint64_t wake_time;         /* RTC time(millisecond) */
+    uint64_t sleep_time;
+    uint32_t awake;
+    uint32_t requested;
+    uint8_t type;
+    uint8_t pending;
+    uint16_t reserved;
+};
+
+/* Wake-up reasons in retention memory, others counts reasons beyond CMA_SLEEP_WAKE_REASON_MAX */
+struct cma_sleep_wake_state_t
+{
+    uint32_t magic;
+    uint32_t total;
+    uint16_t count;
+    uint16_t others;
+    cma_sleep_wake_stats_t entry[CMA_SLEEP_WAKE_REASON_MAX];
+};
+
+/* Adaptive interval in retention memory, events are counted until the end of the cycle */
+struct cma_sleep_adapt_state_t
+{
+    uint32_t magic;
+    uint32_t interval;
+    uint32_t events;
+    uint32_t cycles;
+};
+
+/* Init step times in retention memory (microsecond) */
+struct cma_sleep_resume_entry_t
+{
+    uint32_t name_hash;
+    uint32_t full_time;
+    uint32_t resume_time;
+    uint16_t full_count;
+    uint16_t resume_count;
+};
+
+struct cma_sleep_resume_state_t
+{
+    uint32_t magic;
+    uint32_t count;
+    struct cma_sleep_resume_entry_t entry[CMA_SLEEP_RESUME_STEP_MAX];
+};
+
 static OS_MUTEX cma_sleep_mutex;
+static OS_EVENT cma_sleep_lock_event;
+static struct cma_sleep_lock_t cma_sleep_lock[CMA_SLEEP_LOCK_MAX];
+static uint32_t cma_sleep_lock_count;
+static struct cma_sleep_request_state_t *cma_sleep_request;
+static struct cma_sleep_request_handler_t cma_sleep_request_handler[CMA_SLEEP_REQUEST_MAX];
+static struct cma_sleep_hook_state_t *cma_sleep_hook_state;
+static struct cma_sleep_hook_info_t cma_sleep_hook[CMA_SLEEP_HOOK_MAX];     /* sorted by priority */
+static uint32_t cma_sleep_hook_count;
+static struct cma_sleep_boot_state_t *cma_sleep_boot;
+static cma_sleep_boot_load_t cma_sleep_boot_load;
+static cma_sleep_boot_save_t cma_sleep_boot_save;
+static cma_sleep_pending_load_t cma_sleep_pending_load;
+static cma_sleep_pending_save_t cma_sleep_pending_save;
+static uint8_t cma_sleep_retention;
+static struct cma_sleep_account_state_t *cma_sleep_account;
+static cma_rtm_data_ring_t *cma_sleep_account_ring;
+static struct cma_sleep_wake_state_t *cma_sleep_wake;
+static struct cma_sleep_adapt_state_t *cma_sleep_adapt;
+static uint32_t cma_sleep_adapt_min;
+static uint32_t cma_sleep_adapt_max;
+static uint32_t cma_sleep_adapt_busy;
+static volatile uint32_t cma_sleep_adapt_pending;
+static struct cma_sleep_resume_state_t *cma_sleep_resume;
+static const char *cma_sleep_resume_name[CMA_SLEEP_RESUME_STEP_MAX];
+
+static uint32_t cmai_sleep_hash(const char *name)
+{
+    uint32_t hash = 0x811C9DC5;
+
+    while (*name)
+    {
+        hash = (hash ^ (uint8_t) *name++) * 0x01000193;
+    }
+
+    return hash;
+}
+
+static CMA_STATUS_TYPE cmai_sleep_request_load(void)
+{
+    if (cma_sleep_request != NULL)
+    {
+        return CMA_STATUS_OK;
+    }
+
+    if (cma_rtm_data_alloc_and_read ((uint8_t*) CMA_SLEEP_REQUEST_TAG, (uint8_t**) &cma_sleep_request,
+                                     sizeof(struct cma_sleep_request_state_t)) != CMA_STATUS_OK)
+    {
+        cma_sleep_request = NULL;
+        return CMA_STATUS_FAIL;
+    }
+
+    if (cma_sleep_request->magic != CMA_SLEEP_REQUEST_MAGIC || cma_sleep_request->count > CMA_SLEEP_REQUEST_MAX)
+    {
+        memset (cma_sleep_request, 0, sizeof(struct cma_sleep_request_state_t));
+        cma_sleep_request->magic = CMA_SLEEP_REQUEST_MAGIC;
+    }
+
+    return CMA_STATUS_OK;
+}
+
+/* Earliest deadline, should be called with mutex */
+static uint64_t cmai_sleep_request_earliest(void)
+{
+    uint64_t earliest = CMA_SLEEP_REQUEST_IDLE;
+
+    if (cma_sleep_request == NULL)
+    {
+        return earliest;
+    }
+
+    for (uint32_t i = 0; i < cma_sleep_request->count; i++)
+    {
+        if (cma_sleep_request->entry[i].deadline < earliest)
+        {
+            earliest = cma_sleep_request->entry[i].deadline;
+        }
+    }
+
+    return earliest;
+}
+
+/* Should be called with mutex */
+static void cmai_sleep_lock_free(struct cma_sleep_lock_t *lock, uint64_t now)
+{
+    uint32_t hold = (uint32_t) (now - lock->acquired);
+
+    lock->ref = 0;
+    lock->expire = CMA_SLEEP_REQUEST_IDLE;
+    lock->stats.total_hold += hold;
+
+    if (hold > lock->stats.max_hold)
+    {
+        lock->stats.max_hold = hold;
+    }
+
+    OS_EVENT_SIGNAL(cma_sleep_lock_event);
+}
+
+/* Number of held locks, expired locks are released. Should be called with mutex */
+static uint32_t cmai_sleep_lock_check(uint64_t now, uint64_t *expire)
+{
+    uint32_t held = 0;
+
+    *expire = CMA_SLEEP_REQUEST_IDLE;
+
+    for (uint32_t i = 0; i < cma_sleep_lock_count; i++)
+    {
+        struct cma_sleep_lock_t *lock = &cma_sleep_lock[i];
+
+        if (lock->ref == 0)
+        {
+            continue;
+        }
+
+        if (lock->expire <= now)
+        {
+            LOG(LOG_WARN, "wake lock %s released by timeout", lock->name);
+            lock->stats.timeout_count++;
+            cmai_sleep_lock_free (lock, now);
+            continue;
+        }
+
+        if (lock->expire < *expire)
+        {
+            *expire = lock->expire;
+        }
+
+        held++;
+    }
+
+    return held;
+}
+
+/* Take the sleep 2 cycle from the store when retention memory was lost. Should be called with mutex */
+static void cmai_sleep_account_restore(void)
+{
+    CMA_WAKEUP_CLASS cls = cma_wakeup_reason_class (da16x_boot_get_wakeupmode ());
+    cma_sleep_pending_t pending;
+    uint64_t now = CMA_SLEEP_NOW_MS();
+    uint64_t sleep_time;
+
+    /* Only a wake-up ends the sleep, RTC counter restarts at power on */
+    if (cma_sleep_pending_load == NULL || cls == CMA_WAKEUP_CLASS_POWER_ON || cls == CMA_WAKEUP_CLASS_RESET
+            || cls == CMA_WAKEUP_CLASS_WATCHDOG || cls == CMA_WAKEUP_CLASS_UNKNOWN
+            || cma_sleep_pending_load (&pending) != CMA_STATUS_OK)
+    {
+        return;
+    }
+
+    /* Upper bits are taken from the RTC counter, the sleep was shorter than 2^32 msec */
+    sleep_time = (now & ~0xFFFFFFFFULL) | pending.sleep_time;
+    if (sleep_time > now)
+    {
+        if (sleep_time < 0x100000000ULL)
+        {
+            return;
+        }
+        sleep_time -= 0x100000000ULL;
+    }
+
+    cma_sleep_account->sleep_time = sleep_time;
+    cma_sleep_account->awake = pending.awake;
+    cma_sleep_account->requested = pending.requested;
+    cma_sleep_account->type = (uint8_t) CMA_SLEEP_TYPE_2;
+    cma_sleep_account->pending = 1;
+}
+
+/* Open accounting state in retention memory. Should be called with mutex */
+static void cmai_sleep_account_open(void)
+{
+    if (cma_sleep_account != NULL)
+    {
+        return;
+    }
+
+    if (cma_rtm_data_alloc_and_read ((uint8_t*) CMA_SLEEP_ACCOUNT_TAG, (uint8_t**) &cma_sleep_account,
+                                     sizeof(struct cma_sleep_account_state_t)) != CMA_STATUS_OK
+            || cma_rtm_data_ring_open (CMA_SLEEP_ACCOUNT_RING_TAG, sizeof(cma_sleep_cycle_t),
+                                       CMA_SLEEP_ACCOUNT_DEPTH, 0, &cma_sleep_account_ring) != CMA_STATUS_OK)
+    {
+        cma_sleep_account = NULL;
+        return;
+    }
+
+    if (cma_sleep_account->magic != CMA_SLEEP_ACCOUNT_MAGIC)
+    {
+        memset (cma_sleep_account, 0, sizeof(struct cma_sleep_account_state_t));
+        cma_sleep_account->magic = CMA_SLEEP_ACCOUNT_MAGIC;
+
+        cmai_sleep_account_restore ();
+    }
+}
+
+/* Complete the cycle ended by this wake-up. Should be called with mutex */
+static void cmai_sleep_account_wake(uint32_t os_time)
+{
+    cma_sleep_cycle_t cycle;
+    uint64_t wake_time;
+
+    if (cma_sleep_account == NULL)
+    {
+        return;
+    }
+
+    /* Application got control when the scheduler started, lateness includes the boot before it */
+    wake_time = CMA_SLEEP_NOW_MS() - os_time;
+
+    if (cma_sleep_account->pending)
+    {
+        cycle.awake = cma_sleep_account->awake;
+        cycle.requested = cma_sleep_account->requested;
+        cycle.actual = (wake_time > cma_sleep_account->sleep_time)
+                        ? (uint32_t) (wake_time - cma_sleep_account->sleep_time) : 0;
+        cycle.type = cma_sleep_account->type;
+        cycle.reason = (uint8_t) da16x_boot_get_wakeupmode ();
+        cycle.reserved = 0;
+
+        cma_rtm_data_ring_push (cma_sleep_account_ring, &cycle);
+        cma_sleep_account->cycles++;
+        cma_sleep_account->pending = 0;
+    }
+
+    cma_sleep_account->wake_time = wake_time;
+}
+
+/* Start a cycle before power down. Should be called with mutex */
+static void cmai_sleep_account_sleep(CMA_SLEEP_TYPE type, uint64_t wakeup_time)
+{
+    uint64_t now = CMA_SLEEP_NOW_MS();
+
+    if (cma_sleep_account == NULL)
+    {
+        return;
+    }
+
+    cma_sleep_account->sleep_time = now;
+    cma_sleep_account->awake = (uint32_t) (now - cma_sleep_account->wake_time);
+    cma_sleep_account->requested = (uint32_t) wakeup_time;
+    cma_sleep_account->type = (uint8_t) type;
+    cma_sleep_account->pending = 1;
+
+    /* Retention memory is lost in sleep 2 */
+    if (type == CMA_SLEEP_TYPE_2 && cma_sleep_pending_save != NULL)
+    {
+        cma_sleep_pending_t pending;
+
+        pending.sleep_time = (uint32_t) now;
+        pending.awake = cma_sleep_account->awake;
+        pending.requested = cma_sleep_account->requested;
+        cma_sleep_pending_save (&pending);
+    }
+}
+
+/* Count the wake-up reason of this boot in retention memory, once per boot */
+static void cmai_sleep_wake_record(void)
+{
+    uint8_t reason = (uint8_t) da16x_boot_get_wakeupmode ();
+    cma_sleep_wake_stats_t *entry = NULL;
+
+    if (cma_sleep_wake != NULL)
+    {
+        /* Already counted for this boot */
+        return;
+    }
+
+    if (cma_rtm_data_alloc_and_read ((uint8_t*) CMA_SLEEP_WAKE_TAG, (uint8_t**) &cma_sleep_wake,
+                                     sizeof(struct cma_sleep_wake_state_t)) != CMA_STATUS_OK)
+    {
+        cma_sleep_wake = NULL;
+        return;
+    }
+
+    if (cma_sleep_wake->magic != CMA_SLEEP_WAKE_MAGIC || cma_sleep_wake->count > CMA_SLEEP_WAKE_REASON_MAX)
+    {
+        memset (cma_sleep_wake, 0, sizeof(struct cma_sleep_wake_state_t));
+        cma_sleep_wake->magic = CMA_SLEEP_WAKE_MAGIC;
+    }
+
+    cma_sleep_wake->total++;
+
+    for (uint32_t i = 0; i < cma_sleep_wake->count; i++)
+    {
+        if (cma_sleep_wake->entry[i].reason == reason)
+        {
+            entry = &cma_sleep_wake->entry[i];
+            break;
+        }
+    }
+
+    if (entry == NULL)
+    {
+        if (cma_sleep_wake->count >= CMA_SLEEP_WAKE_REASON_MAX)
+        {
+            if (cma_sleep_wake->others < 0xFFFF)
+            {
+                cma_sleep_wake->others++;
+            }
+            return;
+        }
+
+        entry = &cma_sleep_wake->entry[cma_sleep_wake->count++];
+        memset (entry, 0, sizeof(cma_sleep_wake_stats_t));
+        entry->reason = reason;
+    }
+
+    entry->count++;
+    entry->last_time = (uint32_t) (RTC_GET_COUNTER() >> 15);
+}
+
+/* Move events counted in RAM into retention memory, called with mutex */
+static void cmai_sleep_adapt_flush(void)
+{
+    uint32_t pending;
+
+    if (cma_sleep_adapt == NULL)
+    {
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    pending = cma_sleep_adapt_pending;
+    cma_sleep_adapt_pending = 0;
+    taskEXIT_CRITICAL();
+
+    cma_sleep_adapt->events += pending;
+}
+
+/* Wait until the last lock is released or times out. Called with mutex, returns with mutex */
+static void cmai_sleep_lock_wait(void)
+{
+    uint64_t now, expire;
+
+    for (;;)
+    {
+        now = CMA_SLEEP_NOW_MS();
+
+        if (cmai_sleep_lock_check (now, &expire) == 0)
+        {
+            break;
+        }
+
+        OS_MUTEX_PUT(cma_sleep_mutex);
+
+        if (expire == CMA_SLEEP_REQUEST_IDLE)
+            OS_EVENT_WAIT(cma_sleep_lock_event, OS_EVENT_FOREVER);
+        else
+            OS_EVENT_WAIT(cma_sleep_lock_event, OS_TIME_TO_TICKS(expire - now) + 1);
+
+        OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+    }
+}
 
 void cma_sleep_init(void)
 {
+    if (cma_sleep_mutex != NULL)
+    {
+        return;
+    }
+
     OS_MUTEX_CREATE(cma_sleep_mutex);
     OS_ASSERT(cma_sleep_mutex);
+
+    OS_EVENT_CREATE(cma_sleep_lock_event);
+    OS_ASSERT(cma_sleep_lock_event);
 }
 
 void cma_sleep_trigger(CMA_SLEEP_TYPE type, uint64_t wakeup_time)
 {
     uint8_t retain;
 
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+
+    /* Mutex is kept, so no lock can be taken before power down */
+    cmai_sleep_lock_wait ();
+
+    if (type == CMA_SLEEP_TYPE_AUTO)
+        type = cma_sleep_auto_select (wakeup_time);
+
+    /* Events of this cycle are kept for the next decision */
+    cmai_sleep_adapt_flush ();
+
     if (type == CMA_SLEEP_TYPE_2)
         retain = 0;
     else
         retain = 1;
 
-    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+    cma_sleep_hook_run (CMA_SLEEP_HOOK_PRE_SLEEP, type);
+    cmai_sleep_account_sleep (type, wakeup_time);
 
     if (wakeup_time == 0)
         do_set_dpm_power_down (0x1FFFFF * 1000000ULL, retain);
@@ -67,3 +598,1148 @@ void cma_sleep_trigger(CMA_SLEEP_TYPE type, uint64_t wakeup_time)
     OS_MUTEX_PUT(cma_sleep_mutex);
 }
 
+CMA_STATUS_TYPE cma_sleep_request_register(const char *name, cma_sleep_wake_handler_t handler, void *arg,
+                                           uint32_t *id)
+{
+    CMA_STATUS_TYPE ret = CMA_STATUS_OK;
+    uint32_t hash, i;
+
+    if (name == NULL || handler == NULL || id == NULL)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    hash = cmai_sleep_hash (name);
+
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+
+    if (cmai_sleep_request_load () != CMA_STATUS_OK)
+    {
+        OS_MUTEX_PUT(cma_sleep_mutex);
+        return CMA_STATUS_FAIL;
+    }
+
+    for (i = 0; i < cma_sleep_request->count; i++)
+    {
+        if (cma_sleep_request->entry[i].name_hash == hash)
+        {
+            break;
+        }
+    }
+
+    if (i == cma_sleep_request->count)
+    {
+        if (i == CMA_SLEEP_REQUEST_MAX)
+        {
+            LOG(LOG_ERR, "no free wake request for %s", name);
+            ret = CMA_STATUS_FAIL;
+        }
+        else
+        {
+            cma_sleep_request->entry[i].name_hash = hash;
+            cma_sleep_request->entry[i].deadline = CMA_SLEEP_REQUEST_IDLE;
+            cma_sleep_request->count++;
+        }
+    }
+
+    if (ret == CMA_STATUS_OK)
+    {
+        cma_sleep_request_handler[i].func = handler;
+        cma_sleep_request_handler[i].arg = arg;
+        *id = i;
+    }
+
+    OS_MUTEX_PUT(cma_sleep_mutex);
+
+    return ret;
+}
+
+CMA_STATUS_TYPE cma_sleep_request_set(uint32_t id, uint32_t delay)
+{
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+
+    if (cma_sleep_request == NULL || id >= cma_sleep_request->count)
+    {
+        OS_MUTEX_PUT(cma_sleep_mutex);
+        return CMA_STATUS_FAIL;
+    }
+
+    if (delay == 0)
+        cma_sleep_request->entry[id].deadline = CMA_SLEEP_REQUEST_IDLE;
+    else
+        cma_sleep_request->entry[id].deadline = CMA_SLEEP_NOW_MS() + delay;
+
+    OS_MUTEX_PUT(cma_sleep_mutex);
+
+    return CMA_STATUS_OK;
+}
+
+uint32_t cma_sleep_request_next(void)
+{
+    uint64_t earliest, now;
+
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+    earliest = cmai_sleep_request_earliest ();
+    OS_MUTEX_PUT(cma_sleep_mutex);
+
+    if (earliest == CMA_SLEEP_REQUEST_IDLE)
+    {
+        return CMA_SLEEP_REQUEST_NONE;
+    }
+
+    now = CMA_SLEEP_NOW_MS();
+
+    if (earliest <= now)
+    {
+        return 0;
+    }
+
+    if (earliest - now >= CMA_SLEEP_REQUEST_NONE)
+    {
+        return CMA_SLEEP_REQUEST_NONE - 1;
+    }
+
+    return (uint32_t) (earliest - now);
+}
+
+uint32_t cma_sleep_request_dispatch(void)
+{
+    struct cma_sleep_request_handler_t expired[CMA_SLEEP_REQUEST_MAX];
+    uint32_t count = 0;
+    uint64_t limit;
+
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+
+    if (cma_sleep_request == NULL)
+    {
+        OS_MUTEX_PUT(cma_sleep_mutex);
+        return 0;
+    }
+
+    limit = CMA_SLEEP_NOW_MS() + CMA_SLEEP_REQUEST_MERGE_MS;
+
+    for (uint32_t i = 0; i < cma_sleep_request->count; i++)
+    {
+        if (cma_sleep_request->entry[i].deadline > limit)
+        {
+            continue;
+        }
+
+        cma_sleep_request->entry[i].deadline = CMA_SLEEP_REQUEST_IDLE;
+
+        if (cma_sleep_request_handler[i].func == NULL)
+        {
+            LOG(LOG_WARN, "wake request %d expired without handler", i);
+            continue;
+        }
+
+        expired[count++] = cma_sleep_request_handler[i];
+    }
+
+    OS_MUTEX_PUT(cma_sleep_mutex);
+
+    /* Handlers are called without mutex, so they can set the next deadline */
+    for (uint32_t i = 0; i < count; i++)
+    {
+        expired[i].func (expired[i].arg);
+    }
+
+    return count;
+}
+
+CMA_STATUS_TYPE cma_sleep_request_sleep(CMA_SLEEP_TYPE type)
+{
+    uint32_t next;
+
+    /* Deadline is taken after the wait for wake locks */
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+    cmai_sleep_lock_wait ();
+
+    next = cma_sleep_request_next ();
+
+    if (next == 0)
+    {
+        OS_MUTEX_PUT(cma_sleep_mutex);
+        return CMA_STATUS_FAIL;
+    }
+
+    if (next == CMA_SLEEP_REQUEST_NONE)
+    {
+        LOG(LOG_INFO, "No wake request, sleep until external wake-up");
+        cma_sleep_trigger (type, 0);
+    }
+    else
+    {
+        LOG(LOG_INFO, "Sleep %d ms until next wake request", next);
+        cma_sleep_trigger (type, next);
+    }
+
+    OS_MUTEX_PUT(cma_sleep_mutex);
+
+    return CMA_STATUS_OK;
+}
+
+CMA_STATUS_TYPE cma_sleep_lock_create(const char *name, uint32_t *id)
+{
+    CMA_STATUS_TYPE ret = CMA_STATUS_OK;
+
+    if (name == NULL || id == NULL)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+
+    if (cma_sleep_lock_count == CMA_SLEEP_LOCK_MAX)
+    {
+        LOG(LOG_ERR, "no free wake lock for %s", name);
+        ret = CMA_STATUS_FAIL;
+    }
+    else
+    {
+        memset (&cma_sleep_lock[cma_sleep_lock_count], 0, sizeof(struct cma_sleep_lock_t));
+        cma_sleep_lock[cma_sleep_lock_count].name = name;
+        cma_sleep_lock[cma_sleep_lock_count].expire = CMA_SLEEP_REQUEST_IDLE;
+        *id = cma_sleep_lock_count++;
+    }
+
+    OS_MUTEX_PUT(cma_sleep_mutex);
+
+    return ret;
+}
+
+CMA_STATUS_TYPE cma_sleep_lock_acquire(uint32_t id, uint32_t timeout)
+{
+    struct cma_sleep_lock_t *lock;
+    uint64_t now;
+
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+
+    if (id >= cma_sleep_lock_count)
+    {
+        OS_MUTEX_PUT(cma_sleep_mutex);
+        return CMA_STATUS_FAIL;
+    }
+
+    lock = &cma_sleep_lock[id];
+    now = CMA_SLEEP_NOW_MS();
+
+    if (lock->ref++ == 0)
+    {
+        lock->acquired = now;
+        lock->stats.acquire_count++;
+    }
+
+    /* Latest timeout of all holders is kept */
+    if (timeout == 0)
+    {
+        lock->expire = CMA_SLEEP_REQUEST_IDLE;
+    }
+    else if (lock->ref == 1 || (lock->expire != CMA_SLEEP_REQUEST_IDLE && lock->expire < now + timeout))
+    {
+        lock->expire = now + timeout;
+    }
+
+    OS_MUTEX_PUT(cma_sleep_mutex);
+
+    return CMA_STATUS_OK;
+}
+
+CMA_STATUS_TYPE cma_sleep_lock_release(uint32_t id)
+{
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+
+    /* Release after timeout is ignored */
+    if (id >= cma_sleep_lock_count || cma_sleep_lock[id].ref == 0)
+    {
+        OS_MUTEX_PUT(cma_sleep_mutex);
+        return CMA_STATUS_FAIL;
+    }
+
+    if (--cma_sleep_lock[id].ref == 0)
+    {
+        cmai_sleep_lock_free (&cma_sleep_lock[id], CMA_SLEEP_NOW_MS());
+    }
+
+    OS_MUTEX_PUT(cma_sleep_mutex);
+
+    return CMA_STATUS_OK;
+}
+
+uint32_t cma_sleep_lock_held(void)
+{
+    uint64_t expire;
+    uint32_t held;
+
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+    held = cmai_sleep_lock_check (CMA_SLEEP_NOW_MS(), &expire);
+    OS_MUTEX_PUT(cma_sleep_mutex);
+
+    return held;
+}
+
+CMA_STATUS_TYPE cma_sleep_lock_get_stats(uint32_t id, cma_sleep_lock_stats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+
+    if (id >= cma_sleep_lock_count)
+    {
+        OS_MUTEX_PUT(cma_sleep_mutex);
+        return CMA_STATUS_FAIL;
+    }
+
+    *stats = cma_sleep_lock[id].stats;
+
+    OS_MUTEX_PUT(cma_sleep_mutex);
+
+    return CMA_STATUS_OK;
+}
+
+void cma_sleep_lock_print(void)
+{
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+
+    PRINTF("%-16s %4s %8s %10s %8s %8s\n", "lock", "ref", "acquire", "total(ms)", "max(ms)", "timeout");
+
+    for (uint32_t i = 0; i < cma_sleep_lock_count; i++)
+    {
+        struct cma_sleep_lock_t *lock = &cma_sleep_lock[i];
+
+        PRINTF("%-16s %4d %8d %10d %8d %8d\n", lock->name, lock->ref, lock->stats.acquire_count,
+               lock->stats.total_hold, lock->stats.max_hold, lock->stats.timeout_count);
+    }
+
+    OS_MUTEX_PUT(cma_sleep_mutex);
+}
+
+CMA_STATUS_TYPE cma_sleep_hook_register(CMA_SLEEP_HOOK_TYPE when, const char *name, uint8_t priority, uint32_t budget,
+                                        uint8_t flags, cma_sleep_hook_t func, void *arg)
+{
+    struct cma_sleep_hook_entry_t *entry = NULL;
+    uint32_t hash, i;
+
+    if (name == NULL || func == NULL || when > CMA_SLEEP_HOOK_POST_WAKE)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    hash = cmai_sleep_hash (name);
+
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+
+    if (cma_sleep_hook_state == NULL)
+    {
+        if (cma_rtm_data_alloc_and_read ((uint8_t*) CMA_SLEEP_HOOK_TAG, (uint8_t**) &cma_sleep_hook_state,
+                                         sizeof(struct cma_sleep_hook_state_t)) != CMA_STATUS_OK)
+        {
+            cma_sleep_hook_state = NULL;
+            OS_MUTEX_PUT(cma_sleep_mutex);
+            return CMA_STATUS_FAIL;
+        }
+
+        if (cma_sleep_hook_state->magic != CMA_SLEEP_HOOK_MAGIC || cma_sleep_hook_state->count > CMA_SLEEP_HOOK_MAX)
+        {
+            memset (cma_sleep_hook_state, 0, sizeof(struct cma_sleep_hook_state_t));
+            cma_sleep_hook_state->magic = CMA_SLEEP_HOOK_MAGIC;
+        }
+    }
+
+    if (cma_sleep_hook_count == CMA_SLEEP_HOOK_MAX)
+    {
+        LOG(LOG_ERR, "no free sleep hook for %s", name);
+        OS_MUTEX_PUT(cma_sleep_mutex);
+        return CMA_STATUS_FAIL;
+    }
+
+    /* Statistics of previous cycles are kept by name */
+    for (i = 0; i < cma_sleep_hook_state->count; i++)
+    {
+        if (cma_sleep_hook_state->entry[i].name_hash == hash)
+        {
+            entry = &cma_sleep_hook_state->entry[i];
+            break;
+        }
+    }
+
+    if (entry == NULL)
+    {
+        if (cma_sleep_hook_state->count == CMA_SLEEP_HOOK_MAX)
+        {
+            LOG(LOG_ERR, "no free sleep hook for %s", name);
+            OS_MUTEX_PUT(cma_sleep_mutex);
+            return CMA_STATUS_FAIL;
+        }
+
+        entry = &cma_sleep_hook_state->entry[cma_sleep_hook_state->count++];
+        memset (entry, 0, sizeof(struct cma_sleep_hook_entry_t));
+        entry->name_hash = hash;
+    }
+
+    /* Insert after hooks of same or higher priority */
+    for (i = cma_sleep_hook_count; i > 0 && cma_sleep_hook[i - 1].priority > priority; i--)
+    {
+        cma_sleep_hook[i] = cma_sleep_hook[i - 1];
+    }
+
+    cma_sleep_hook[i].name = name;
+    cma_sleep_hook[i].func = func;
+    cma_sleep_hook[i].arg = arg;
+    cma_sleep_hook[i].budget = budget;
+    cma_sleep_hook[i].when = (uint8_t) when;
+    cma_sleep_hook[i].priority = priority;
+    cma_sleep_hook[i].flags = flags;
+    cma_sleep_hook[i].entry = entry;
+    cma_sleep_hook_count++;
+
+    OS_MUTEX_PUT(cma_sleep_mutex);
+
+    return CMA_STATUS_OK;
+}
+
+uint32_t cma_sleep_hook_run(CMA_SLEEP_HOOK_TYPE when, CMA_SLEEP_TYPE type)
+{
+    uint64_t chain_start, start;
+    uint32_t elapsed;
+
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+
+    chain_start = CMA_SLEEP_NOW_US();
+
+    for (uint32_t i = 0; i < cma_sleep_hook_count; i++)
+    {
+        struct cma_sleep_hook_info_t *hook = &cma_sleep_hook[i];
+        struct cma_sleep_hook_entry_t *entry = hook->entry;
+
+        if (hook->when != when)
+        {
+            continue;
+        }
+
+        if ((hook->flags & CMA_SLEEP_HOOK_OPTIONAL) && entry->deferred > 0)
+        {
+            entry->deferred--;
+            entry->skips++;
+            continue;
+        }
+
+        start = CMA_SLEEP_NOW_US();
+        hook->func (type, hook->arg);
+        elapsed = (uint32_t) (CMA_SLEEP_NOW_US() - start);
+
+        entry->runs++;
+        entry->last_time = elapsed;
+        entry->total_time += elapsed;
+
+        if (elapsed > entry->max_time)
+        {
+            entry->max_time = elapsed;
+        }
+
+        if (elapsed > hook->budget)
+        {
+            entry->overruns++;
+            LOG(LOG_WARN, "sleep hook %s took %d us (budget %d us)", hook->name, elapsed, hook->budget);
+
+            if (hook->flags & CMA_SLEEP_HOOK_OPTIONAL)
+            {
+                entry->deferred = CMA_SLEEP_HOOK_DEFER_MAX;
+            }
+        }
+    }
+
+    elapsed = (uint32_t) (CMA_SLEEP_NOW_US() - chain_start);
+
+    if (cma_sleep_hook_state != NULL)
+    {
+        cma_sleep_hook_state->chain_last[when] = elapsed;
+        cma_sleep_hook_state->chain_total[when] += elapsed;
+    }
+
+    OS_MUTEX_PUT(cma_sleep_mutex);
+
+    return elapsed;
+}
+
+void cma_sleep_hook_print(void)
+{
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+
+    if (cma_sleep_hook_state == NULL)
+    {
+        OS_MUTEX_PUT(cma_sleep_mutex);
+        return;
+    }
+
+    PRINTF("%-16s %4s %8s %8s %6s %10s %10s %10s\n", "hook", "pri", "budget", "runs", "skips", "last(us)",
+           "max(us)", "overruns");
+
+    for (uint32_t i = 0; i < cma_sleep_hook_count; i++)
+    {
+        struct cma_sleep_hook_info_t *hook = &cma_sleep_hook[i];
+
+        PRINTF("%-16s %c%3d %8d %8d %6d %10d %10d %10d\n", hook->name,
+               (hook->when == CMA_SLEEP_HOOK_PRE_SLEEP) ? 'S' : 'W', hook->priority, hook->budget,
+               hook->entry->runs, hook->entry->skips, hook->entry->last_time, hook->entry->max_time,
+               hook->entry->overruns);
+    }
+
+    PRINTF("pre-sleep : last %d us total %d us\n", cma_sleep_hook_state->chain_last[CMA_SLEEP_HOOK_PRE_SLEEP],
+           cma_sleep_hook_state->chain_total[CMA_SLEEP_HOOK_PRE_SLEEP]);
+    PRINTF("post-wake : last %d us total %d us\n", cma_sleep_hook_state->chain_last[CMA_SLEEP_HOOK_POST_WAKE],
+           cma_sleep_hook_state->chain_total[CMA_SLEEP_HOOK_POST_WAKE]);
+
+    OS_MUTEX_PUT(cma_sleep_mutex);
+}
+
+void cma_sleep_set_retention(uint8_t required)
+{
+    cma_sleep_retention = required;
+}
+
+void cma_sleep_set_boot_store(cma_sleep_boot_load_t load, cma_sleep_boot_save_t save)
+{
+    cma_sleep_boot_load = load;
+    cma_sleep_boot_save = save;
+}
+
+/* RTC time(millisecond) this boot started at, Fail if it is not known */
+static CMA_STATUS_TYPE cmai_sleep_boot_start(uint64_t *start)
+{
+    CMA_WAKEUP_CLASS cls = cma_wakeup_reason_class (da16x_boot_get_wakeupmode ());
+
+    if (cls == CMA_WAKEUP_CLASS_POWER_ON)
+    {
+        /* RTC counter starts with power */
+        *start = 0;
+        return CMA_STATUS_OK;
+    }
+
+    /* RTC timer fires at the time given at power down */
+    if (cls == CMA_WAKEUP_CLASS_TIMER && cma_sleep_account != NULL && cma_sleep_account->pending
+            && cma_sleep_account->requested != 0)
+    {
+        *start = cma_sleep_account->sleep_time + cma_sleep_account->requested;
+        return CMA_STATUS_OK;
+    }
+
+    return CMA_STATUS_FAIL;
+}
+
+void cma_sleep_set_pending_store(cma_sleep_pending_load_t load, cma_sleep_pending_save_t save)
+{
+    cma_sleep_pending_load = load;
+    cma_sleep_pending_save = save;
+}
+
+static uint8_t cmai_sleep_boot_moved(uint32_t average, uint32_t saved)
+{
+    uint32_t diff = (average > saved) ? (average - saved) : (saved - average);
+
+    return (diff > (saved >> CMA_SLEEP_BOOT_SAVE_SHIFT)) ? 1 : 0;
+}
+
+void cma_sleep_boot_done(void)
+{
+    uint32_t os_time = OS_GET_TICK_COUNT() * OS_PERIOD_MS;
+    uint64_t now = CMA_SLEEP_NOW_MS();
+    uint64_t start;
+    uint32_t boot_time = 0;
+    cma_sleep_boot_cost_t cost;
+    uint8_t warm, measured, save = 0;
+
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+
+    /* Time from scheduler start misses ROM boot and image load, so boot is timed with RTC */
+    cmai_sleep_account_open ();
+    measured = (cmai_sleep_boot_start (&start) == CMA_STATUS_OK && now >= start) ? 1 : 0;
+    if (measured)
+    {
+        boot_time = (uint32_t) (now - start);
+    }
+
+    if (cma_sleep_boot == NULL)
+    {
+        if (cma_rtm_data_alloc_and_read ((uint8_t*) CMA_SLEEP_BOOT_TAG, (uint8_t**) &cma_sleep_boot,
+                                         sizeof(struct cma_sleep_boot_state_t)) != CMA_STATUS_OK)
+        {
+            cma_sleep_boot = NULL;
+            OS_MUTEX_PUT(cma_sleep_mutex);
+            return;
+        }
+    }
+
+    /* Kept record means retention memory survived the sleep */
+    warm = (cma_sleep_boot->magic == CMA_SLEEP_BOOT_MAGIC);
+
+    if (warm == 0)
+    {
+        /* Averages of earlier power cycles, the new cold boot is averaged in */
+        if (cma_sleep_boot_load == NULL || cma_sleep_boot_load (&cost) != CMA_STATUS_OK)
+        {
+            memset (&cost, 0, sizeof(cma_sleep_boot_cost_t));
+        }
+
+        cma_sleep_boot->magic = CMA_SLEEP_BOOT_MAGIC;
+        if (!measured)
+            cma_sleep_boot->cold_boot = cost.cold_boot;
+        else if (cost.cold_boot != 0)
+            cma_sleep_boot->cold_boot = (cost.cold_boot * 3 + boot_time) / 4;
+        else
+            cma_sleep_boot->cold_boot = boot_time;
+        cma_sleep_boot->cold_count = (cma_sleep_boot->cold_boot != 0) ? 1 : 0;
+        cma_sleep_boot->warm_boot = cost.warm_boot;
+        cma_sleep_boot->warm_count = (cost.warm_boot != 0) ? 1 : 0;
+        cma_sleep_boot->saved_cold = cost.cold_boot;
+        cma_sleep_boot->saved_warm = cost.warm_boot;
+    }
+    else if (!measured)
+    {
+        /* Wake-up time is not known, averages are kept */
+    }
+    else if (cma_sleep_boot->warm_count == 0)
+    {
+        cma_sleep_boot->warm_boot = boot_time;
+        cma_sleep_boot->warm_count = 1;
+    }
+    else
+    {
+        cma_sleep_boot->warm_boot = (cma_sleep_boot->warm_boot * 3 + boot_time) / 4;
+
+        if (cma_sleep_boot->warm_count < 0xFFFF)
+        {
+            cma_sleep_boot->warm_count++;
+        }
+    }
+
+    if (cma_sleep_boot_save != NULL
+            && (cmai_sleep_boot_moved (cma_sleep_boot->cold_boot, cma_sleep_boot->saved_cold)
+                || cmai_sleep_boot_moved (cma_sleep_boot->warm_boot, cma_sleep_boot->saved_warm)))
+    {
+        cma_sleep_boot->saved_cold = cma_sleep_boot->cold_boot;
+        cma_sleep_boot->saved_warm = cma_sleep_boot->warm_boot;
+        save = 1;
+    }
+
+    cost.cold_boot = cma_sleep_boot->cold_boot;
+    cost.warm_boot = cma_sleep_boot->warm_boot;
+
+    cmai_sleep_account_wake (os_time);
+    cmai_sleep_wake_record ();
+
+    OS_MUTEX_PUT(cma_sleep_mutex);
+
+    /* Store may write flash, so it is called without the lock */
+    if (save)
+    {
+        cma_sleep_boot_save (&cost);
+    }
+
+    LOG(LOG_DBG, "%s boot %d ms%s (cold %d ms, warm %d ms)", warm ? "warm" : "cold", boot_time,
+        measured ? "" : " (not timed)", cost.cold_boot, cost.warm_boot);
+}
+
+CMA_SLEEP_TYPE cma_sleep_auto_select(uint64_t wakeup_time)
+{
+    uint64_t cold_boot = CMA_SLEEP_COLD_BOOT_DEFAULT;
+    uint64_t warm_boot = CMA_SLEEP_WARM_BOOT_DEFAULT;
+    uint64_t break_even;
+
+    if (cma_sleep_retention || cma_sleep_request_next () != CMA_SLEEP_REQUEST_NONE)
+    {
+        return CMA_SLEEP_TYPE_3;
+    }
+
+    if (wakeup_time == 0)
+    {
+        return CMA_SLEEP_TYPE_2;
+    }
+
+    if (cma_sleep_boot != NULL && cma_sleep_boot->cold_count > 0)
+    {
+        cold_boot = cma_sleep_boot->cold_boot;
+    }
+
+    if (cma_sleep_boot != NULL && cma_sleep_boot->warm_count > 0)
+    {
+        warm_boot = cma_sleep_boot->warm_boot;
+    }
+
+    if (cold_boot <= warm_boot)
+    {
+        return CMA_SLEEP_TYPE_2;
+    }
+
+    /* Sleep 3 costs more per millisecond, sleep 2 costs more at boot */
+    break_even = (cold_boot - warm_boot) * CMA_SLEEP_CURRENT_ACTIVE
+                 / (CMA_SLEEP_CURRENT_SLEEP3 - CMA_SLEEP_CURRENT_SLEEP2);
+
+    return (wakeup_time < break_even) ? CMA_SLEEP_TYPE_3 : CMA_SLEEP_TYPE_2;
+}
+
+uint32_t cma_sleep_account_read(cma_sleep_cycle_t *cycles, uint32_t maxCycles)
+{
+    uint32_t count;
+
+    if (cycles == NULL)
+    {
+        return 0;
+    }
+
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+    count = cma_rtm_data_ring_peek (cma_sleep_account_ring, cycles, maxCycles);
+    OS_MUTEX_PUT(cma_sleep_mutex);
+
+    return count;
+}
+
+CMA_STATUS_TYPE cma_sleep_account_get(cma_sleep_account_t *account)
+{
+    cma_sleep_cycle_t cycles[CMA_SLEEP_ACCOUNT_DEPTH];
+    uint64_t awake = 0, sleep = 0, charge;
+    int64_t late = 0;
+    uint32_t count, late_count = 0, early_count = 0;
+
+    if (account == NULL)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+
+    if (cma_sleep_account == NULL)
+    {
+        OS_MUTEX_PUT(cma_sleep_mutex);
+        return CMA_STATUS_FAIL;
+    }
+
+    memset (account, 0, sizeof(cma_sleep_account_t));
+    account->cycles = cma_sleep_account->cycles;
+    count = cma_rtm_data_ring_peek (cma_sleep_account_ring, cycles, CMA_SLEEP_ACCOUNT_DEPTH);
+
+    OS_MUTEX_PUT(cma_sleep_mutex);
+
+    charge = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        awake += cycles[i].awake;
+        sleep += cycles[i].actual;
+        charge += (uint64_t) cycles[i].awake * CMA_SLEEP_CURRENT_ACTIVE;
+        charge += (uint64_t) cycles[i].actual
+                  * ((cycles[i].type == CMA_SLEEP_TYPE_2) ? CMA_SLEEP_CURRENT_SLEEP2 : CMA_SLEEP_CURRENT_SLEEP3);
+
+        if (cycles[i].requested == 0)
+        {
+            continue;
+        }
+
+        /* only a timer wake-up tells how late the timer was, others end the sleep early */
+        if (cma_wakeup_reason_class (cycles[i].reason) == CMA_WAKEUP_CLASS_TIMER)
+        {
+            late += (int64_t) cycles[i].actual - cycles[i].requested;
+            late_count++;
+        }
+        else if (cycles[i].actual < cycles[i].requested)
+        {
+            early_count++;
+        }
+    }
+
+    account->samples = count;
+    account->early_wakes = early_count;
+
+    if (count > 0)
+    {
+        account->avg_awake = (uint32_t) (awake / count);
+        account->avg_sleep = (uint32_t) (sleep / count);
+    }
+
+    if (awake + sleep > 0)
+    {
+        account->duty_cycle = (uint32_t) (awake * 10000 / (awake + sleep));
+        account->avg_current = (uint32_t) (charge / (awake + sleep));
+    }
+
+    if (late_count > 0)
+    {
+        account->avg_late = (int32_t) (late / late_count);
+    }
+
+    return CMA_STATUS_OK;
+}
+
+void cma_sleep_account_print(void)
+{
+    cma_sleep_cycle_t cycles[CMA_SLEEP_ACCOUNT_DEPTH];
+    cma_sleep_account_t account;
+    uint32_t count;
+
+    if (cma_sleep_account_get (&account) != CMA_STATUS_OK)
+    {
+        return;
+    }
+
+    count = cma_sleep_account_read (cycles, CMA_SLEEP_ACCOUNT_DEPTH);
+
+    PRINTF("%-4s %10s %10s %10s %5s %6s\n", "no", "awake(ms)", "req(ms)", "sleep(ms)", "type", "reason");
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        PRINTF("%-4d %10d %10d %10d %5d   0x%02x\n", i, cycles[i].awake, cycles[i].requested, cycles[i].actual,
+               (cycles[i].type == CMA_SLEEP_TYPE_2) ? 2 : 3, cycles[i].reason);
+    }
+
+    PRINTF("cycles %d : avg awake %d ms, avg sleep %d ms, duty %d.%02d %%, avg current %d nA, late %d ms, "
+           "early %d\n", account.cycles, account.avg_awake, account.avg_sleep, account.duty_cycle / 100,
+           account.duty_cycle % 100, account.avg_current, account.avg_late, account.early_wakes);
+}
+
+uint32_t cma_sleep_wake_read(cma_sleep_wake_stats_t *stats, uint32_t maxStats)
+{
+    uint32_t count = 0;
+
+    if (stats == NULL)
+    {
+        return 0;
+    }
+
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+
+    if (cma_sleep_wake != NULL)
+    {
+        /* Insertion by count, the table is small */
+        for (uint32_t i = 0; i < cma_sleep_wake->count; i++)
+        {
+            const cma_sleep_wake_stats_t *entry = &cma_sleep_wake->entry[i];
+            uint32_t pos = count;
+
+            while (pos > 0 && stats[pos - 1].count < entry->count)
+            {
+                if (pos < maxStats)
+                {
+                    stats[pos] = stats[pos - 1];
+                }
+                pos--;
+            }
+
+            if (pos < maxStats)
+            {
+                stats[pos] = *entry;
+                if (count < maxStats)
+                {
+                    count++;
+                }
+            }
+        }
+    }
+
+    OS_MUTEX_PUT(cma_sleep_mutex);
+
+    return count;
+}
+
+CMA_STATUS_TYPE cma_sleep_wake_get(uint8_t reason, cma_sleep_wake_stats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+
+    if (cma_sleep_wake == NULL)
+    {
+        OS_MUTEX_PUT(cma_sleep_mutex);
+        return CMA_STATUS_FAIL;
+    }
+
+    memset (stats, 0, sizeof(cma_sleep_wake_stats_t));
+    stats->reason = reason;
+
+    for (uint32_t i = 0; i < cma_sleep_wake->count; i++)
+    {
+        if (cma_sleep_wake->entry[i].reason == reason)
+        {
+            *stats = cma_sleep_wake->entry[i];
+            break;
+        }
+    }
+
+    OS_MUTEX_PUT(cma_sleep_mutex);
+
+    return CMA_STATUS_OK;
+}
+
+void cma_sleep_wake_print(void)
+{
+    cma_sleep_wake_stats_t stats[CMA_SLEEP_WAKE_REASON_MAX];
+    uint32_t total, others, count, by_timer = 0;
+
+    count = cma_sleep_wake_read (stats, CMA_SLEEP_WAKE_REASON_MAX);
+
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+    total = (cma_sleep_wake != NULL) ? cma_sleep_wake->total : 0;
+    others = (cma_sleep_wake != NULL) ? cma_sleep_wake->others : 0;
+    OS_MUTEX_PUT(cma_sleep_mutex);
+
+    PRINTF("%-6s %-9s %8s %6s %10s  %s\n", "reason", "class", "count", "%", "last(s)", "description");
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        CMA_WAKEUP_CLASS cls = cma_wakeup_reason_class (stats[i].reason);
+
+        if (cls == CMA_WAKEUP_CLASS_TIMER)
+        {
+            by_timer += stats[i].count;
+        }
+
+        PRINTF("0x%02x   %-9s %8d %6d %10d  %s\n", stats[i].reason, cma_wakeup_class_name (cls), stats[i].count,
+               (total > 0) ? (stats[i].count * 100 / total) : 0, stats[i].last_time,
+               cma_wakeup_reason_name (stats[i].reason));
+    }
+
+    PRINTF("wake-ups %d : %d by timer, %d by other reasons (%d not counted by reason)\n", total, by_timer,
+           total - by_timer, others);
+}
+
+CMA_STATUS_TYPE cma_sleep_adapt_init(uint32_t minInterval, uint32_t maxInterval, uint32_t busyEvents)
+{
+    CMA_WAKEUP_CLASS cls;
+
+    if (minInterval == 0 || minInterval > maxInterval)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+
+    if (cma_sleep_adapt == NULL)
+    {
+        if (cma_rtm_data_alloc_and_read ((uint8_t*) CMA_SLEEP_ADAPT_TAG, (uint8_t**) &cma_sleep_adapt,
+                                         sizeof(struct cma_sleep_adapt_state_t)) != CMA_STATUS_OK)
+        {
+            cma_sleep_adapt = NULL;
+            OS_MUTEX_PUT(cma_sleep_mutex);
+            return CMA_STATUS_FAIL;
+        }
+
+        if (cma_sleep_adapt->magic != CMA_SLEEP_ADAPT_MAGIC)
+        {
+            memset (cma_sleep_adapt, 0, sizeof(struct cma_sleep_adapt_state_t));
+            cma_sleep_adapt->magic = CMA_SLEEP_ADAPT_MAGIC;
+            cma_sleep_adapt->interval = minInterval;
+        }
+
+        /* The wake-up itself is an event if not caused by the timer */
+        cls = cma_wakeup_reason_class (da16x_boot_get_wakeupmode ());
+        if (cls == CMA_WAKEUP_CLASS_EXTERNAL || cls == CMA_WAKEUP_CLASS_SENSOR)
+        {
+            cma_sleep_adapt->events++;
+        }
+    }
+
+    cma_sleep_adapt_min = minInterval;
+    cma_sleep_adapt_max = maxInterval;
+    cma_sleep_adapt_busy = (busyEvents != 0) ? busyEvents : CMA_SLEEP_ADAPT_BUSY_DEFAULT;
+
+    if (cma_sleep_adapt->interval < minInterval)
+        cma_sleep_adapt->interval = minInterval;
+    else if (cma_sleep_adapt->interval > maxInterval)
+        cma_sleep_adapt->interval = maxInterval;
+
+    OS_MUTEX_PUT(cma_sleep_mutex);
+
+    return CMA_STATUS_OK;
+}
+
+void cma_sleep_adapt_event(void)
+{
+    uint32_t status;
+
+    /* Masks the same interrupts as the flush, the interrupt form is also valid in a task */
+    status = taskENTER_CRITICAL_FROM_ISR();
+    cma_sleep_adapt_pending++;
+    taskEXIT_CRITICAL_FROM_ISR(status);
+}
+
+uint32_t cma_sleep_adapt_next(void)
+{
+    uint32_t interval, events;
+
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+
+    if (cma_sleep_adapt == NULL)
+    {
+        OS_MUTEX_PUT(cma_sleep_mutex);
+        return cma_sleep_adapt_min;
+    }
+
+    cmai_sleep_adapt_flush ();
+    events = cma_sleep_adapt->events;
+    interval = cma_sleep_adapt->interval;
+
+    if (events >= cma_sleep_adapt_busy)
+    {
+        interval /= 2;
+    }
+    else if (events == 0)
+    {
+        interval = (interval > cma_sleep_adapt_max / 2) ? cma_sleep_adapt_max : interval * 2;
+    }
+
+    if (interval < cma_sleep_adapt_min)
+    {
+        interval = cma_sleep_adapt_min;
+    }
+
+    cma_sleep_adapt->interval = interval;
+    cma_sleep_adapt->events = 0;
+    cma_sleep_adapt->cycles++;
+
+    OS_MUTEX_PUT(cma_sleep_mutex);
+
+    LOG(LOG_DBG, "adaptive interval %d ms (%d events)", interval, events);
+
+    return interval;
+}
+
+uint32_t cma_sleep_adapt_interval(void)
+{
+    uint32_t interval;
+
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+    interval = (cma_sleep_adapt != NULL) ? cma_sleep_adapt->interval : cma_sleep_adapt_min;
+    OS_MUTEX_PUT(cma_sleep_mutex);
+
+    return interval;
+}
+
+uint8_t cma_sleep_is_resume(void)
+{
+    return cma_rtm_data_is_kept ();
+}
+
+uint32_t cma_sleep_resume_begin(void)
+{
+    return (uint32_t) RTC_GET_COUNTER();
+}
+
+void cma_sleep_resume_end(const char *name, uint32_t start, uint8_t resumed)
+{
+    uint32_t elapsed = (uint32_t) ((((uint64_t) ((uint32_t) RTC_GET_COUNTER() - start)) * 1000000) >> 15);
+    struct cma_sleep_resume_entry_t *entry = NULL;
+    uint32_t hash, i;
+
+    if (name == NULL)
+    {
+        return;
+    }
+
+    hash = cmai_sleep_hash (name);
+
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+
+    if (cma_sleep_resume == NULL)
+    {
+        if (cma_rtm_data_alloc_and_read ((uint8_t*) CMA_SLEEP_RESUME_TAG, (uint8_t**) &cma_sleep_resume,
+                                         sizeof(struct cma_sleep_resume_state_t)) != CMA_STATUS_OK)
+        {
+            cma_sleep_resume = NULL;
+            OS_MUTEX_PUT(cma_sleep_mutex);
+            return;
+        }
+
+        if (cma_sleep_resume->magic != CMA_SLEEP_RESUME_MAGIC || cma_sleep_resume->count > CMA_SLEEP_RESUME_STEP_MAX)
+        {
+            memset (cma_sleep_resume, 0, sizeof(struct cma_sleep_resume_state_t));
+            cma_sleep_resume->magic = CMA_SLEEP_RESUME_MAGIC;
+        }
+    }
+
+    for (i = 0; i < cma_sleep_resume->count; i++)
+    {
+        if (cma_sleep_resume->entry[i].name_hash == hash)
+        {
+            entry = &cma_sleep_resume->entry[i];
+            break;
+        }
+    }
+
+    if (entry == NULL)
+    {
+        if (cma_sleep_resume->count >= CMA_SLEEP_RESUME_STEP_MAX)
+        {
+            OS_MUTEX_PUT(cma_sleep_mutex);
+            LOG(LOG_WARN, "No free resume step for %s", name);
+            return;
+        }
+
+        i = cma_sleep_resume->count++;
+        entry = &cma_sleep_resume->entry[i];
+        memset (entry, 0, sizeof(struct cma_sleep_resume_entry_t));
+        entry->name_hash = hash;
+    }
+
+    cma_sleep_resume_name[i] = name;
+
+    if (resumed)
+    {
+        entry->resume_time = (entry->resume_count == 0) ? elapsed : (entry->resume_time * 3 + elapsed) / 4;
+        if (entry->resume_count < 0xFFFF)
+        {
+            entry->resume_count++;
+        }
+    }
+    else
+    {
+        entry->full_time = (entry->full_count == 0) ? elapsed : (entry->full_time * 3 + elapsed) / 4;
+        if (entry->full_count < 0xFFFF)
+        {
+            entry->full_count++;
+        }
+    }
+
+    OS_MUTEX_PUT(cma_sleep_mutex);
+
+    LOG(LOG_DBG, "%s %s %d us", name, resumed ? "resume" : "init", elapsed);
+}
+
+void cma_sleep_resume_print(void)
+{
+    uint32_t saved = 0;
+
+    OS_MUTEX_GET(cma_sleep_mutex, OS_MUTEX_FOREVER);
+
+    if (cma_sleep_resume == NULL)
+    {
+        OS_MUTEX_PUT(cma_sleep_mutex);
+        return;
+    }
+
+    PRINTF("%-16s %10s %6s %10s %6s %10s\n", "step", "init(us)", "count", "resume(us)", "count", "saved(us)");
+
+    for (uint32_t i = 0; i < cma_sleep_resume->count; i++)
+    {
+        struct cma_sleep_resume_entry_t *entry = &cma_sleep_resume->entry[i];
+        int32_t diff = 0;
+
+        if (entry->full_count > 0 && entry->resume_count > 0)
+        {
+            diff = (int32_t) entry->full_time - (int32_t) entry->resume_time;
+            saved += (diff > 0) ? diff : 0;
+        }
+
+        /* Names are known once the step ran after this boot */
+        PRINTF("%-16s %10d %6d %10d %6d %10d\n", cma_sleep_resume_name[i] ? cma_sleep_resume_name[i] : "?",
+               entry->full_time, entry->full_count, entry->resume_time, entry->resume_count, diff);
+    }
+
+    PRINTF("resume saves %d us per wake-up\n", saved);
+
+    OS_MUTEX_PUT(cma_sleep_mutex);
+}
@@ -36,10 +36,14 @@
 #include "da16x_types.h"
 #include "da16x_sys_watchdog.h"
 #include "sys_feature.h"
+#include "cma_backoff.h"
 #include "cma_debug.h"
 #include "cma_osal.h"
 #include "cma_sleep.h"
 #include "cma_rtm_data.h"
+#include "cma_rtm_store.h"
+#include "cma_rtm_counter.h"
+#include "cma_flash.h"
 #include "user_rtm_data.h"
 
 /* internal defines */
@@ -50,17 +54,77 @@
 #define USER_RTM_DATA_SLEEP_EV         	(1 << 0)
 
 #define USER_BRTM_DATA_IDLE_TIME       	2000  /* 2 sec */
-#define USER_BRTM_DATA_SLEEP_TIME       2000  /* 2 sec */
+/* Bounds of adaptive sleep interval, backs off while no event is reported */
+#define USER_BRTM_DATA_SLEEP_MIN        2000  /* 2 sec */
+#define USER_BRTM_DATA_SLEEP_MAX        32000 /* 32 sec */
 
 /* USER Buffer */
 #define USER_BUFFER_TAG         "user_buff"
 #define USER_BUFFER_LENGTH      (128)
+#define USER_BUFFER_VERSION     (1)
 
 struct user_buffer_t
 {
     uint16_t idx;
 };
 
+/* One RTM block holds all records */
+#define USER_RTM_ARENA_RECORDS  (16)
+#define USER_RTM_ARENA_SIZE     (3136)
+
+/* Store of state, hot records in RTM and the others in first 2 sectors of user area */
+#define USER_STORE_RTM_BUDGET   (128)
+#define USER_STORE_FLASH_ADDR   SFLASH_USER_AREA_START
+#define USER_STORE_FLASH_LENGTH (2 * SF_SECTOR_SZ)
+#define USER_STORE_BATCH_TAG    "last_batch"
+
+/* Wake-up counter survives power-on reset, checkpoints in 3rd and 4th sectors of user area */
+#define USER_COUNTER_FLASH_ADDR (SFLASH_USER_AREA_START + 2 * SF_SECTOR_SZ)
+#define USER_COUNTER_WAKEUP_TAG "wakeup_cnt"
+
+/* Boot costs of cma_sleep, kept in counters so automatic sleep selection survives power-on reset */
+#define USER_COUNTER_COLD_TAG   "boot_cold"
+#define USER_COUNTER_WARM_TAG   "boot_warm"
+
+/* Sleep 2 cycle in progress of cma_sleep, kept in counters so it is recorded after the wake-up */
+#define USER_COUNTER_SLEEP2_TIME_TAG    "sleep2_time"
+#define USER_COUNTER_SLEEP2_AWAKE_TAG   "sleep2_awake"
+#define USER_COUNTER_SLEEP2_REQ_TAG     "sleep2_req"
+
+/* Samples taken on each wake-up, flushed in a batch */
+#define USER_SAMPLE_TAG         "user_sample"
+#define USER_SAMPLE_CAPACITY    (16)
+#define USER_SAMPLE_BATCH       (8)
+
+/* Sleep is held off while a batch is written */
+#define USER_FLUSH_LOCK_NAME    "user_flush"
+#define USER_FLUSH_LOCK_TIMEOUT (1000)
+
+struct user_sample_t
+{
+    uint16_t idx;
+    uint16_t reserved;
+    uint32_t tick;
+};
+
+/* Budgets of sleep hooks (usec) */
+#define USER_HOOK_COMMIT_BUDGET     (500)
+#define USER_HOOK_COUNTER_BUDGET    (20000)
+#define USER_HOOK_REBALANCE_BUDGET  (50000)
+#define USER_HOOK_REPORT_BUDGET     (20000)
+
+/* Records in retention memory */
+enum
+{
+    USER_RTM_RECORD_BUFFER = 0,
+    USER_RTM_RECORD_MAX
+};
+
+static const cma_rtm_data_record_t user_rtm_records[USER_RTM_RECORD_MAX] =
+{
+    CMA_RTM_DATA_RECORD(USER_BUFFER_TAG, struct user_buffer_t, USER_BUFFER_VERSION, NULL),
+};
+
 int32_t debug_level = 4;
 
 /* Local variable */
@@ -68,6 +132,19 @@ static OS_TASK xTask = NULL;
 static OS_TIMER user_rtm_data_timer = NULL;
 
 static struct user_buffer_t *g_user_buff = NULL;
+static cma_rtm_data_ring_t *g_user_samples = NULL;
+static uint32_t g_user_wakeup_counter;
+static uint32_t g_user_cold_counter;
+static uint32_t g_user_warm_counter;
+static uint32_t g_user_sleep2_counter[3];
+static uint32_t g_user_flush_lock;
+
+static const cma_rtm_counter_policy_t user_wakeup_counter_policy =
+{
+    .every_count = 10,
+    .every_sec = 60,
+    .before_sleep2 = 1,
+};
 
 /* Local functions */
 
@@ -81,15 +158,193 @@ static void user_rtm_data_timer_callback(TimerHandle_t pxTime)
     }
 }
 
+static void user_rtm_data_flush_samples(void)
+{
+    struct user_sample_t batch[USER_SAMPLE_BATCH];
+    uint32_t count, dropped;
+
+    cma_sleep_lock_acquire (g_user_flush_lock, USER_FLUSH_LOCK_TIMEOUT);
+
+    count = cma_rtm_data_ring_peek (g_user_samples, batch, USER_SAMPLE_BATCH);
+
+    /* Flash or network write of whole batch goes here */
+    for (uint32_t i = 0; i < count; i++)
+    {
+        LOG(LOG_INFO, " Sample[%d] idx = %d tick = %d\n", i, batch[i].idx, batch[i].tick);
+    }
+
+    /* Keep last batch, it spills to flash when RTM budget is used by hotter records */
+    cma_rtm_store_write (USER_STORE_BATCH_TAG, batch, sizeof(batch));
+
+    cma_rtm_data_ring_consume (g_user_samples, count);
+
+    cma_rtm_data_ring_count (g_user_samples, &dropped);
+    LOG(LOG_INFO, " Flushed %d samples (dropped %d)\n", count, dropped);
+
+    cma_sleep_lock_release (g_user_flush_lock);
+}
+
+static void user_rtm_data_commit_hook(CMA_SLEEP_TYPE type, void *arg)
+{
+    DA16X_UNUSED_ARG(type);
+    DA16X_UNUSED_ARG(arg);
+
+    cma_rtm_data_commit (USER_RTM_RECORD_BUFFER);
+}
+
+static void user_rtm_data_counter_hook(CMA_SLEEP_TYPE type, void *arg)
+{
+    DA16X_UNUSED_ARG(arg);
+
+    cma_rtm_counter_sleep (type);
+}
+
+static CMA_STATUS_TYPE user_rtm_data_boot_load(cma_sleep_boot_cost_t *cost)
+{
+    cost->cold_boot = cma_rtm_counter_get (g_user_cold_counter);
+    cost->warm_boot = cma_rtm_counter_get (g_user_warm_counter);
+
+    return (cost->cold_boot != 0) ? CMA_STATUS_OK : CMA_STATUS_FAIL;
+}
+
+static void user_rtm_data_boot_save(const cma_sleep_boot_cost_t *cost)
+{
+    cma_rtm_counter_set (g_user_cold_counter, cost->cold_boot);
+    cma_rtm_counter_set (g_user_warm_counter, cost->warm_boot);
+
+    /* cma_sleep only saves when a cost moved, so checkpoint now */
+    cma_rtm_counter_checkpoint ();
+}
+
+static CMA_STATUS_TYPE user_rtm_data_pending_load(cma_sleep_pending_t *pending)
+{
+    pending->sleep_time = cma_rtm_counter_get (g_user_sleep2_counter[0]);
+    pending->awake = cma_rtm_counter_get (g_user_sleep2_counter[1]);
+    pending->requested = cma_rtm_counter_get (g_user_sleep2_counter[2]);
+
+    return (pending->sleep_time != 0 || pending->awake != 0) ? CMA_STATUS_OK : CMA_STATUS_FAIL;
+}
+
+static void user_rtm_data_pending_save(const cma_sleep_pending_t *pending)
+{
+    cma_rtm_counter_set (g_user_sleep2_counter[0], pending->sleep_time);
+    cma_rtm_counter_set (g_user_sleep2_counter[1], pending->awake);
+    cma_rtm_counter_set (g_user_sleep2_counter[2], pending->requested);
+
+    /* Retention memory is lost in sleep 2, so checkpoint now */
+    cma_rtm_counter_checkpoint ();
+}
+
+static void user_rtm_data_rebalance_hook(CMA_SLEEP_TYPE type, void *arg)
+{
+    DA16X_UNUSED_ARG(type);
+    DA16X_UNUSED_ARG(arg);
+
+    cma_rtm_store_rebalance ();
+}
+
+static void user_rtm_data_report_hook(CMA_SLEEP_TYPE type, void *arg)
+{
+    DA16X_UNUSED_ARG(type);
+    DA16X_UNUSED_ARG(arg);
+
+    if (debug_level >= LOG_DBG)
+    {
+        cma_rtm_data_print_report ();
+        cma_sleep_hook_print ();
+        cma_sleep_account_print ();
+        cma_sleep_wake_print ();
+        cma_sleep_resume_print ();
+        cma_backoff_print ();
+    }
+}
+
+static void user_rtm_data_hooks_init(void)
+{
+    /* Rebalance can wait for another cycle if it takes too long */
+    if (cma_sleep_hook_register (CMA_SLEEP_HOOK_PRE_SLEEP, "user_commit", 0, USER_HOOK_COMMIT_BUDGET,
+                                 CMA_SLEEP_HOOK_MANDATORY, user_rtm_data_commit_hook, NULL) != CMA_STATUS_OK
+            || cma_sleep_hook_register (CMA_SLEEP_HOOK_PRE_SLEEP, "user_counter", 1, USER_HOOK_COUNTER_BUDGET,
+                                        CMA_SLEEP_HOOK_MANDATORY, user_rtm_data_counter_hook, NULL) != CMA_STATUS_OK
+            || cma_sleep_hook_register (CMA_SLEEP_HOOK_PRE_SLEEP, "user_rebalance", 10, USER_HOOK_REBALANCE_BUDGET,
+                                        CMA_SLEEP_HOOK_OPTIONAL, user_rtm_data_rebalance_hook, NULL) != CMA_STATUS_OK
+            || cma_sleep_hook_register (CMA_SLEEP_HOOK_POST_WAKE, "user_report", 0, USER_HOOK_REPORT_BUDGET,
+                                        CMA_SLEEP_HOOK_OPTIONAL, user_rtm_data_report_hook, NULL) != CMA_STATUS_OK)
+    {
+        cma_assert(0);
+    }
+}
+
 static CMA_STATUS_TYPE user_rtm_data_app_init(void)
 {
-    cma_rtm_data_alloc_and_read ((uint8_t*) USER_BUFFER_TAG, (uint8_t**) &g_user_buff, sizeof(struct user_buffer_t));
+    uint32_t start;
+
+    cma_rtm_data_arena_create (USER_RTM_ARENA_SIZE, USER_RTM_ARENA_RECORDS);
+    cma_rtm_data_register (user_rtm_records, USER_RTM_RECORD_MAX);
+
+    g_user_buff = CMA_RTM_DATA_PTR(USER_RTM_RECORD_BUFFER, struct user_buffer_t);
     if (g_user_buff == NULL)
     {
         cma_assert(0);
     }
 
-    LOG(LOG_INFO, " Index = %d\n", g_user_buff->idx);
+    LOG(LOG_INFO, " Index = %d (reinit %d)\n", g_user_buff->idx, cma_rtm_data_get_reinit_count ());
+
+    if (cma_rtm_data_ring_open (USER_SAMPLE_TAG, sizeof(struct user_sample_t), USER_SAMPLE_CAPACITY,
+                                USER_SAMPLE_BATCH, &g_user_samples) != CMA_STATUS_OK)
+    {
+        cma_assert(0);
+    }
+
+    /* Store and counters are only rebuilt when retention memory was lost */
+    start = cma_sleep_resume_begin ();
+
+    if (cma_rtm_store_init (USER_STORE_RTM_BUDGET, USER_STORE_FLASH_ADDR, USER_STORE_FLASH_LENGTH) != CMA_STATUS_OK)
+    {
+        cma_assert(0);
+    }
+
+    if (cma_rtm_counter_init (USER_COUNTER_FLASH_ADDR) != CMA_STATUS_OK
+            || cma_rtm_counter_open (USER_COUNTER_WAKEUP_TAG, &user_wakeup_counter_policy,
+                                     &g_user_wakeup_counter) != CMA_STATUS_OK
+            || cma_rtm_counter_open (USER_COUNTER_COLD_TAG, NULL, &g_user_cold_counter) != CMA_STATUS_OK
+            || cma_rtm_counter_open (USER_COUNTER_WARM_TAG, NULL, &g_user_warm_counter) != CMA_STATUS_OK
+            || cma_rtm_counter_open (USER_COUNTER_SLEEP2_TIME_TAG, NULL, &g_user_sleep2_counter[0]) != CMA_STATUS_OK
+            || cma_rtm_counter_open (USER_COUNTER_SLEEP2_AWAKE_TAG, NULL, &g_user_sleep2_counter[1]) != CMA_STATUS_OK
+            || cma_rtm_counter_open (USER_COUNTER_SLEEP2_REQ_TAG, NULL, &g_user_sleep2_counter[2]) != CMA_STATUS_OK)
+    {
+        cma_assert(0);
+    }
+
+    cma_sleep_set_boot_store (user_rtm_data_boot_load, user_rtm_data_boot_save);
+    cma_sleep_set_pending_store (user_rtm_data_pending_load, user_rtm_data_pending_save);
+
+    cma_sleep_resume_end ("rtm_store", start, cma_sleep_is_resume ());
+
+    LOG(LOG_INFO, " Wake-up count = %d\n", cma_rtm_counter_add (g_user_wakeup_counter, 1));
+
+    if (cma_sleep_lock_create (USER_FLUSH_LOCK_NAME, &g_user_flush_lock) != CMA_STATUS_OK)
+    {
+        cma_assert(0);
+    }
+
+    user_rtm_data_hooks_init ();
+    cma_sleep_hook_run (CMA_SLEEP_HOOK_POST_WAKE, CMA_SLEEP_TYPE_3);
+
+    /* Records in RTM must survive, so automatic selection keeps sleep 3 */
+    cma_sleep_set_retention (1);
+    cma_sleep_boot_done ();
+
+    if (cma_sleep_adapt_init (USER_BRTM_DATA_SLEEP_MIN, USER_BRTM_DATA_SLEEP_MAX, 0) != CMA_STATUS_OK)
+    {
+        cma_assert(0);
+    }
+
+    /* Abnormal wake-up intervals with the seed and success rate kept in RTM */
+    if (cma_backoff_init () != CMA_STATUS_OK)
+    {
+        cma_assert(0);
+    }
 
     user_rtm_data_timer = OS_TIMER_CREATE("BLINKY_RTOS", portCONVERT_MS_2_TICKS(USER_BRTM_DATA_IDLE_TIME), pdTRUE,
                                           (void* )0, user_rtm_data_timer_callback);
@@ -137,8 +392,26 @@ static void user_rtm_data_task(void *arg)
 
         if (notif & USER_RTM_DATA_SLEEP_EV)
         {
+            struct user_sample_t sample = { 0, };
+
+            sample.idx = g_user_buff->idx;
+            sample.tick = OS_GET_TICK_COUNT();
+            cma_rtm_data_ring_push (g_user_samples, &sample);
+
+            if (cma_rtm_data_ring_ready (g_user_samples))
+            {
+                user_rtm_data_flush_samples ();
+            }
+
             g_user_buff->idx++;
-            cma_sleep_trigger (CMA_SLEEP_TYPE_3, USER_BRTM_DATA_SLEEP_TIME);
+
+            if (debug_level >= LOG_DBG)
+            {
+                cma_sleep_lock_print ();
+            }
+
+            /* Pre-sleep hooks commit and checkpoint the state */
+            cma_sleep_trigger (CMA_SLEEP_TYPE_AUTO, cma_sleep_adapt_next ());
         }
     }
 }
@@ -147,6 +420,7 @@ void user_rtm_data_init(void)
 {
     cma_sleep_init ();
     cma_rtm_data_init ();
+    cma_flash_init ();
 
     if (xTask != NULL)
     {
@@ -50,6 +50,7 @@
 #endif // __SET_BOR_CIRCUIT__
 
 #include "user_app_entry.h"
+#include "cma_backoff.h"
 
 /*
  * Config customer's console baud-rate.
@@ -267,22 +268,16 @@ static void config_user_wu_hw_resource(void)
  *         3600 * 24
  *     }
  */
-unsigned long long _user_defined_wakeup_interval[DPM_MON_RETRY_CNT] = {
-    ULLONG_MAX,            // Initial value : ULLONG_MAX
-    60,                    // 1st Wakeup
-    60,                    // 2nd Wakeup    : 0xdeadbeaf for no-wakeup
-    60,                    // 3rd Wakeup    : 0xdeadbeaf for no-wakeup
-    60 * 30,               // 4th Wakeup    : 0xdeadbeaf for no-wakeup
-    60 * 30,               // 5th Wakeup    : 0xdeadbeaf for no-wakeup
-    60 * 30,               // 6th Wakeup    : 0xdeadbeaf for no-wakeup
-    60 * 60,               // 7th Wakeup    : 0xdeadbeaf for no-wakeup
-    60 * 60,               // 8th Wakeup    : 0xdeadbeaf for no-wakeup
-    0xDEADBEAF             // 9th Wakeup    : 0xdeadbeaf for no-wakeup
-};
+unsigned long long _user_defined_wakeup_interval[DPM_MON_RETRY_CNT];
 
+/*
+ * Intervals are computed by cma_backoff : exponential backoff from CMA_BACKOFF_BASE with
+ * per-device jitter, longer while reconnections fail (cma_backoff_report).
+ */
 static void set_dpm_abnorm_user_wakeup_interval(void)
 {
 #if defined ( __USER_DPM_ABNORM_WU_INTERVAL__ )
+    cma_backoff_fill(_user_defined_wakeup_interval, DPM_MON_RETRY_CNT);
     dpm_abnorm_user_wakeup_interval = (unsigned long long *)_user_defined_wakeup_interval;
 #endif // __USER_DPM_ABNORM_WU_INTERVAL__
 }
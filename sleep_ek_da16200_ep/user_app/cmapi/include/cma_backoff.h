@@ -0,0 +1,148 @@
+/**
+ ****************************************************************************************
+ *
+ * @file cma_backoff.h
+ *
+ * @brief Backoff policy of DPM abnormal wake-up.
+ *
+ * Copyright (c) 2016-2024 Renesas Electronics. All rights reserved.
+ *
+ * This software ("Software") is owned by Renesas Electronics.
+ *
+ * By using this Software you agree that Renesas Electronics retains all
+ * intellectual property and proprietary rights in and to this Software and any
+ * use, reproduction, disclosure or distribution of the Software without express
+ * written permission or a license agreement from Renesas Electronics is
+ * strictly prohibited. This Software is solely for use on or in conjunction
+ * with Renesas Electronics products.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE
+ * SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. EXCEPT AS OTHERWISE
+ * PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * RENESAS ELECTRONICS BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL,
+ * OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ *
+ ****************************************************************************************
+ */
+
+#ifndef CMA_BACKOFF_H_
+#define CMA_BACKOFF_H_
+
+#include "da16x_types.h"
+#include "cma_status.h"
+
+/*
+ * Policy of DPM abnormal wake-up intervals (second). The n-th retry waits
+ * CMA_BACKOFF_BASE * scale * 2^(n-1), up to CMA_BACKOFF_MAX, with +/- CMA_BACKOFF_JITTER percent.
+ * Scale grows up to CMA_BACKOFF_SCALE_MAX while reconnections fail.
+ */
+#ifndef CMA_BACKOFF_BASE
+#define CMA_BACKOFF_BASE                60
+#endif
+#ifndef CMA_BACKOFF_MAX
+#define CMA_BACKOFF_MAX                 (60 * 60 * 6)
+#endif
+#ifndef CMA_BACKOFF_JITTER
+#define CMA_BACKOFF_JITTER              25
+#endif
+#ifndef CMA_BACKOFF_SCALE_MAX
+#define CMA_BACKOFF_SCALE_MAX           8
+#endif
+/* Last retry does not wake up, as the default table of the SDK */
+#ifndef CMA_BACKOFF_GIVE_UP
+#define CMA_BACKOFF_GIVE_UP             1
+#endif
+
+/*
+ * Seed of jitter, taken once and kept in retention memory. The RTC counter is used by default.
+ * A unique value (e.g. from MAC address) is used as is and gives each device a fixed jitter.
+ */
+#ifndef CMA_BACKOFF_DEVICE_SEED
+#define CMA_BACKOFF_DEVICE_SEED()       ((uint32_t) RTC_GET_COUNTER())
+#endif
+
+/* Values of DPM abnormal wake-up interval table */
+#define CMA_BACKOFF_INITIAL             0xFFFFFFFFFFFFFFFFULL
+#define CMA_BACKOFF_NO_WAKEUP           0xDEADBEAF
+#define CMA_BACKOFF_INTERVAL_LIMIT      0x1FFFFF
+
+typedef struct
+{
+    uint32_t attempts;          /* reconnections reported */
+    uint32_t successes;
+    uint32_t success_rate;      /* moving average per 1024 */
+    uint32_t scale;             /* multiplier of CMA_BACKOFF_BASE */
+    uint32_t seed;
+} cma_backoff_stats_t;
+
+/**
+ ****************************************************************************************
+ * @brief Fill DPM abnormal wake-up interval table.
+ *
+ * Called from set_dpm_abnorm_user_wakeup_interval before the scheduler starts, so no OS
+ * call is done. Defaults are used until cma_backoff_init loads the state from retention memory.
+ * The table is kept and filled again when the state changes.
+ *
+ * @param[in] table (_user_defined_wakeup_interval).
+ * @param[in] number of entries (DPM_MON_RETRY_CNT).
+ *
+ * @return None.
+ ****************************************************************************************
+ */
+void cma_backoff_fill(unsigned long long *table, uint32_t count);
+
+/**
+ ****************************************************************************************
+ * @brief Load device seed and success rate from retention memory, and fill the table again.
+ *
+ * cma_rtm_data_init should be called before.
+ *
+ * @param[in] None.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_backoff_init(void);
+
+/**
+ ****************************************************************************************
+ * @brief Report result of a reconnection, e.g. after DPM abnormal wake-up.
+ *
+ * Failures make the intervals longer, so a fleet does not retry at the same pace
+ * during an AP outage.
+ *
+ * @param[in] 1 if connected, 0 if not.
+ *
+ * @return None.
+ ****************************************************************************************
+ */
+void cma_backoff_report(uint8_t success);
+
+/**
+ ****************************************************************************************
+ * @brief Get reconnection statistics.
+ *
+ * @param[out] statistics.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_backoff_get_stats(cma_backoff_stats_t *stats);
+
+/**
+ ****************************************************************************************
+ * @brief Print statistics and current intervals.
+ *
+ * @param[in] None.
+ *
+ * @return None.
+ ****************************************************************************************
+ */
+void cma_backoff_print(void);
+
+#endif /* CMA_BACKOFF_H_ */
@@ -36,6 +36,7 @@
 
 #include "da16x_types.h"
 #include "da16200_ioconfig.h"
+#include "gpio.h"
 #include "cma_status.h"
 
 typedef enum
@@ -155,6 +156,110 @@ typedef enum
 
 typedef void (*cma_user_callback_t)(CMA_GPIO_WAKEUP_PIN pin);
 
+/* Number of ports and size of configuration kept by cma_gpio_get_config */
+#define CMA_GPIO_PORT_MAX               3
+#define CMA_GPIO_CONFIG_FUNC_MAX        8
+#define CMA_GPIO_CONFIG_INT_MAX         8
+
+/* Masks and error of cma_gpio_read_port */
+#define CMA_GPIO_PORT_ALL_PINS          0xFFFF
+#define CMA_GPIO_PORT_ERR               0xFFFFFFFF
+
+/* Pin masks of a port */
+typedef struct
+{
+    uint16_t input;
+    uint16_t output;
+    uint16_t output_high;
+    uint16_t pull_up;
+    uint16_t pull_down;
+    uint16_t high_z;
+    uint16_t int_enable;
+    uint16_t int_edge;          /* 1: edge, 0: level */
+    uint16_t int_high;          /* 1: high active, 0: low active */
+} cma_gpio_port_config_t;
+
+/* Interrupt callback of a pin */
+typedef struct
+{
+    uint8_t port;
+    uint8_t pin;
+    uint16_t reserved;
+    void *callback;
+} cma_gpio_int_config_t;
+
+/*
+ * Configuration done by cma_gpio, e.g. to be kept in retention memory and applied on
+ * wake-up by cma_gpio_apply_config. Callbacks are code addresses, so it is only valid
+ * for the same firmware.
+ */
+typedef struct
+{
+    uint8_t func_count;
+    uint8_t int_count;
+    uint8_t overflow;
+    uint8_t reserved;
+    uint8_t func[CMA_GPIO_CONFIG_FUNC_MAX];     /* CMA_GPIO_SET_FUNC_TYPE in order of calls */
+    cma_gpio_port_config_t port[CMA_GPIO_PORT_MAX];
+    cma_gpio_int_config_t intr[CMA_GPIO_CONFIG_INT_MAX];
+} cma_gpio_config_t;
+
+/* Handles of ports, valid after cma_gpio_open_port, cma_gpio_set_input or cma_gpio_set_output */
+extern HANDLE cma_gpio_handle[CMA_GPIO_PORT_MAX];
+
+/**
+ ****************************************************************************************
+ * @brief Create and initialize handle of port once. Other calls reuse it.
+ *
+ * @param[in] Port number.
+ *
+ * @return success or fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_gpio_open_port(CMA_GPIO_PORT_TYPE port);
+
+/**
+ ****************************************************************************************
+ * @brief Set output level without handle lookup, for LEDs and bit-banging.
+ *
+ * Port must be opened and pin set as output before. The level is not kept in the
+ * configuration of cma_gpio_get_config, use cma_gpio_set_output_level for that.
+ *
+ * @param[in] Port number.
+ * @param[in] GPIO pin number.
+ * @param[in] level (0 or 1).
+ *
+ * @return None.
+ ****************************************************************************************
+ */
+static inline void cma_gpio_fast_write(CMA_GPIO_PORT_TYPE port, CMA_GPIO_PIN_TYPE pin, uint8_t level)
+{
+    uint16_t data = (uint16_t) ((level ? 1 : 0) << pin);
+
+    GPIO_WRITE (cma_gpio_handle[port], (UINT32) (0x01 << pin), &data, sizeof(uint16_t));
+}
+
+/**
+ ****************************************************************************************
+ * @brief Get input level without handle lookup.
+ *
+ * Port must be opened before.
+ *
+ * @param[in] Port number.
+ * @param[in] GPIO pin number.
+ *
+ * @return level (0 or 1).
+ ****************************************************************************************
+ */
+static inline uint8_t cma_gpio_fast_read(CMA_GPIO_PORT_TYPE port, CMA_GPIO_PIN_TYPE pin)
+{
+    uint16_t data = 0;
+
+    GPIO_READ (cma_gpio_handle[port], (UINT32) (0x01 << pin), &data, sizeof(uint16_t));
+
+    return (uint8_t) ((data >> pin) & 0x01);
+}
+
 /**
  ****************************************************************************************
  * @brief Get input level of GPIO.
@@ -196,6 +301,35 @@ CMA_STATUS_TYPE cma_gpio_set_input(CMA_GPIO_PORT_TYPE port, CMA_GPIO_PIN_TYPE pi
  */
 CMA_STATUS_TYPE cma_gpio_set_output_level(CMA_GPIO_PORT_TYPE port, CMA_GPIO_PIN_TYPE pin, CMA_GPIO_LEVEL_TYPE level);
 
+/**
+ ****************************************************************************************
+ * @brief Set levels of several output pins of a port with one write.
+ *
+ * Pins in mask change at the same time, the others are not changed.
+ * e.g. cma_gpio_write_mask(CMA_GPIO_PORT_A, 0x00FF, byte) updates an 8-bit bus on GPIOA0~7.
+ *
+ * @param[in] Port number.
+ * @param[in] mask of pins (bit n : pin n).
+ * @param[in] levels of pins (bit n : pin n).
+ *
+ * @return success or fail.
+ *
+ * cma_gpio_set_output is required at least one time for each pin.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_gpio_write_mask(CMA_GPIO_PORT_TYPE port, uint16_t mask, uint16_t value);
+
+/**
+ ****************************************************************************************
+ * @brief Sample levels of all pins of a port with one read.
+ *
+ * @param[in] Port number.
+ *
+ * @return levels of pins (bit n : pin n) or CMA_GPIO_PORT_ERR.
+ ****************************************************************************************
+ */
+uint32_t cma_gpio_read_port(CMA_GPIO_PORT_TYPE port);
+
 /**
  ****************************************************************************************
  * @brief Create internal instance and set GPIO as output.
@@ -300,4 +434,31 @@ void cma_gpio_set_ext_wakeup_from_sleep(CMA_GPIO_WAKEUP_PIN pin, CMA_GPIO_WAKEUP
  */
 void cma_gpio_clear_ext_wakeup_from_sleep(CMA_GPIO_WAKEUP_PIN pin);
 
+/**
+ ****************************************************************************************
+ * @brief Get configuration done by cma_gpio functions since boot.
+ *
+ * Pin functions, direction, pull, output level and interrupts are kept.
+ *
+ * @param[out] configuration.
+ *
+ * @return Success or Fail(more functions or interrupts than kept).
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_gpio_get_config(cma_gpio_config_t *config);
+
+/**
+ ****************************************************************************************
+ * @brief Apply configuration got by cma_gpio_get_config.
+ *
+ * Each port is created and initialized once and all pins of a port are set together,
+ * so it is faster than repeating the calls which built the configuration.
+ *
+ * @param[in] configuration.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_gpio_apply_config(const cma_gpio_config_t *config);
+
 #endif /* CMA_GPIO_H_ */
@@ -0,0 +1,101 @@
+/**
+ ****************************************************************************************
+ *
+ * @file cma_profile.h
+ *
+ * @brief Boot and wake-up phase profiler.
+ *
+ * Copyright (c) 2016-2024 Renesas Electronics. All rights reserved.
+ *
+ * This software ("Software") is owned by Renesas Electronics.
+ *
+ * By using this Software you agree that Renesas Electronics retains all
+ * intellectual property and proprietary rights in and to this Software and any
+ * use, reproduction, disclosure or distribution of the Software without express
+ * written permission or a license agreement from Renesas Electronics is
+ * strictly prohibited. This Software is solely for use on or in conjunction
+ * with Renesas Electronics products.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE
+ * SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. EXCEPT AS OTHERWISE
+ * PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * RENESAS ELECTRONICS BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL,
+ * OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ *
+ ****************************************************************************************
+ */
+
+#ifndef CMA_PROFILE_H_
+#define CMA_PROFILE_H_
+
+#include "da16x_types.h"
+#include "cma_status.h"
+
+/* Boot phases, in order. Each mark is the start of a phase */
+typedef enum
+{
+    CMA_PROFILE_USER_MAIN = 0,
+    CMA_PROFILE_SYSTEM_START,
+    CMA_PROFILE_WU_HW_RESOURCE,
+    CMA_PROFILE_SYSTEM_INIT,        /* after config_user_wu_hw_resource */
+    CMA_PROFILE_APP_ENTRY,
+    CMA_PROFILE_TASK_CREATE,
+    CMA_PROFILE_TASK_START,
+    CMA_PROFILE_FIRST_EVENT,        /* first OS_TASK_NOTIFY_WAIT return */
+    CMA_PROFILE_PHASE_MAX
+} CMA_PROFILE_PHASE;
+
+/**
+ ****************************************************************************************
+ * @brief Mark start of a boot phase with RTC counter.
+ *
+ * Only the first mark of each phase is kept. It can be called before the scheduler starts.
+ *
+ * @param[in] phase.
+ *
+ * @return None.
+ ****************************************************************************************
+ */
+void cma_profile_mark(CMA_PROFILE_PHASE phase);
+
+/**
+ ****************************************************************************************
+ * @brief Get time of a phase mark from user_main.
+ *
+ * @param[in] phase.
+ *
+ * @return time(microsecond) or 0 if not marked.
+ ****************************************************************************************
+ */
+uint32_t cma_profile_get(CMA_PROFILE_PHASE phase);
+
+/**
+ ****************************************************************************************
+ * @brief Keep the marks of this boot in averages in retention memory, for trend over wake-ups.
+ *
+ * cma_rtm_data_init should be called before. Only the first call of a boot is counted.
+ *
+ * @param[in] None.
+ *
+ * @return Success or Fail.
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_profile_save(void);
+
+/**
+ ****************************************************************************************
+ * @brief Print per-phase breakdown of this boot and averages saved in retention memory.
+ *
+ * @param[in] None.
+ *
+ * @return None.
+ ****************************************************************************************
+ */
+void cma_profile_print(void);
+
+#endif /* CMA_PROFILE_H_ */
@@ -34,14 +34,95 @@
 
 #define CMA_RTM_DATA_H_
 
+#if defined(CMA_SLEEP_SIM)
+#include <stdint.h>
+#else
 #include "da16x_types.h"
 #include "da16200_ioconfig.h"
+#endif
 #include "cma_status.h"
 
+/* Maximum number of records in registry and arena */
+#ifndef CMA_RTM_DATA_RECORD_MAX
+#define CMA_RTM_DATA_RECORD_MAX         32
+#endif
+
+/*
+ * Record of retention memory, declared once by application in a const table.
+ * migrate is called when size or version of stored record is different from declared one.
+ * Data is already copied (up to the smaller size) and the rest is zero filled.
+ * A new or corrupted record is filled by restore (e.g. from a flash snapshot), or from
+ * defaults if restore is NULL or fails, or zero filled if both are NULL.
+ */
+typedef struct
+{
+    const char *tag;
+    uint16_t size;
+    uint16_t version;
+    void (*migrate)(void *data, uint16_t oldVersion, uint16_t oldSize);
+    const void *defaults;
+    CMA_STATUS_TYPE (*restore)(void *data, uint16_t size);
+} cma_rtm_data_record_t;
+
+#define CMA_RTM_DATA_RECORD(tag, type, version, migrate)    { (tag), sizeof(type), (version), (migrate), NULL, NULL }
+#define CMA_RTM_DATA_RECORD_EX(tag, type, version, migrate, defaults, restore) \
+    { (tag), sizeof(type), (version), (migrate), (defaults), (restore) }
+
+/* Name of the RTM block used as arena */
+#define CMA_RTM_DATA_ARENA_TAG          "cma_arena"
+
+/* Arena header : 12 bytes plus 12 bytes per record of its entry table */
+#define CMA_RTM_DATA_ARENA_HEADER_SIZE(maxRecords)  (12 + (maxRecords) * 12)
+
+/* Ring buffer of fixed size samples in retention memory */
+typedef struct cma_rtm_data_ring_t cma_rtm_data_ring_t;
+
+/* Record in footprint report */
+typedef struct
+{
+    const char *tag;            /* NULL if not used since wake-up */
+    uint32_t tag_hash;
+    uint16_t offset;            /* offset in arena */
+    uint16_t size;
+    uint16_t last_write;        /* wake count of last write (arena only) */
+} cma_rtm_data_info_t;
+
+/* Footprint report */
+typedef struct
+{
+    uint8_t arena;
+    uint32_t total;             /* size of arena */
+    uint32_t used;              /* used bytes including headers */
+    uint32_t free;              /* free bytes including reusable holes */
+    uint32_t wake_count;
+    uint32_t reinit_count;
+    uint32_t count;
+    cma_rtm_data_info_t record[CMA_RTM_DATA_RECORD_MAX];
+} cma_rtm_data_report_t;
+
+/* Typed pointer of a registered record */
+#define CMA_RTM_DATA_PTR(id, type)      ((type*) cma_rtm_data_get(id))
+
+/**
+ ****************************************************************************************
+ * @brief Check if this boot is a wake-up from sleep with retention memory kept.
+ *
+ * Reset and watchdog wake-ups are not counted even if retention memory was kept.
+ *
+ * @param[in] NONE
+ *
+ * @return 1 if kept, 0 if not.
+ ****************************************************************************************
+ */
+uint8_t cma_rtm_data_is_kept(void);
+
 /**
  ****************************************************************************************
  * @brief Initialize structure and area for user data in retention memory .
  *
+ * Can be called more than once, e.g. by each module using retention memory.
+ * The pool is only created when cma_rtm_data_is_kept is 0, it is kept otherwise.
+ *
  * @param[in] NONE
  *
  * @return Success or Fail
@@ -49,6 +130,22 @@
  */
 CMA_STATUS_TYPE cma_rtm_data_init(void);
 
+/**
+ ****************************************************************************************
+ * @brief Reserve one block in retention memory and use it as arena.
+ *
+ * After this call, records of cma_rtm_data_alloc_and_read and cma_rtm_data_register are
+ * packed into the arena by offset instead of separate pool allocations.
+ * The block is allocated at first boot and found again at wake-up, it is reset if size
+ * or number of records changed.
+ *
+ * @param[in] size of arena including its header (up to 64KB), see CMA_RTM_DATA_ARENA_HEADER_SIZE
+ * @param[in] number of records the arena can hold (up to CMA_RTM_DATA_RECORD_MAX)
+ * @return Success or Fail
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_rtm_data_arena_create(uint32_t size, uint32_t maxRecords);
+
 /**
  ****************************************************************************************
  * @brief Read data user data.
@@ -61,4 +158,182 @@ CMA_STATUS_TYPE cma_rtm_data_init(void);
  */
 CMA_STATUS_TYPE cma_rtm_data_alloc_and_read(uint8_t *name, uint8_t **data, uint32_t len);
 
+/**
+ ****************************************************************************************
+ * @brief Register records and resolve all of them in retention memory.
+ *
+ * Called once per wake-up. Missing records are allocated and filled, records failing
+ * CRC check are reinitialized and records with different size or version are migrated.
+ * Index of record in table is its id.
+ *
+ * @param[in] table of records
+ * @param[in] number of records
+ * @return Success or Fail
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_rtm_data_register(const cma_rtm_data_record_t *table, uint32_t count);
+
+/**
+ ****************************************************************************************
+ * @brief Update CRC and generation of a record after its data is changed.
+ *
+ * Changes not committed before sleep are detected as corruption at next wake-up.
+ *
+ * @param[in] id of record (index in table)
+ * @return Success or Fail
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_rtm_data_commit(uint32_t id);
+
+/**
+ ****************************************************************************************
+ * @brief Commit all registered records.
+ *
+ * @param[in] None
+ * @return None
+ ****************************************************************************************
+ */
+void cma_rtm_data_commit_all(void);
+
+/**
+ ****************************************************************************************
+ * @brief Get number of records reinitialized because of corruption.
+ *
+ * @param[in] None
+ * @return count since retention memory was lost
+ ****************************************************************************************
+ */
+uint32_t cma_rtm_data_get_reinit_count(void);
+
+/**
+ ****************************************************************************************
+ * @brief Get data of a registered record.
+ *
+ * @param[in] id of record (index in table)
+ * @return pointer of data or NULL
+ ****************************************************************************************
+ */
+void* cma_rtm_data_get(uint32_t id);
+
+/**
+ ****************************************************************************************
+ * @brief Open a ring buffer of samples in retention memory.
+ *
+ * Samples are kept over sleep and wake-up, so the application can append one sample on
+ * each wake-up and flush them in a batch. The ring is reset when its layout is changed.
+ *
+ * @param[in] unique name for the ring
+ * @param[in] size of a sample
+ * @param[in] maximum number of samples
+ * @param[in] number of samples to report ready (high-water mark)
+ * @param[out] ring handle
+ * @return Success or Fail
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_rtm_data_ring_open(const char *tag, uint16_t sampleSize, uint16_t capacity, uint16_t highWater,
+                                       cma_rtm_data_ring_t **ring);
+
+/**
+ ****************************************************************************************
+ * @brief Append a sample. The oldest sample is overwritten when the ring is full.
+ *
+ * @param[in] ring handle
+ * @param[in] sample data
+ * @return Success or Fail
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_rtm_data_ring_push(cma_rtm_data_ring_t *ring, const void *sample);
+
+/**
+ ****************************************************************************************
+ * @brief Check if number of samples reaches high-water mark.
+ *
+ * @param[in] ring handle
+ * @return 1 if ready to flush, 0 otherwise
+ ****************************************************************************************
+ */
+uint8_t cma_rtm_data_ring_ready(cma_rtm_data_ring_t *ring);
+
+/**
+ ****************************************************************************************
+ * @brief Copy the oldest samples without removing them.
+ *
+ * @param[in] ring handle
+ * @param[out] buffer for samples
+ * @param[in] maximum number of samples to copy
+ * @return number of copied samples
+ ****************************************************************************************
+ */
+uint32_t cma_rtm_data_ring_peek(cma_rtm_data_ring_t *ring, void *buffer, uint32_t maxSamples);
+
+/**
+ ****************************************************************************************
+ * @brief Remove the oldest samples, e.g. after they are flushed.
+ *
+ * @param[in] ring handle
+ * @param[in] number of samples
+ * @return None
+ ****************************************************************************************
+ */
+void cma_rtm_data_ring_consume(cma_rtm_data_ring_t *ring, uint32_t samples);
+
+/**
+ ****************************************************************************************
+ * @brief Get number of samples and samples overwritten since the ring was created.
+ *
+ * @param[in] ring handle
+ * @param[out] number of overwritten samples (can be NULL)
+ * @return number of samples in ring
+ ****************************************************************************************
+ */
+uint32_t cma_rtm_data_ring_count(cma_rtm_data_ring_t *ring, uint32_t *dropped);
+
+/**
+ ****************************************************************************************
+ * @brief Mark data as written in this wake-up, for footprint report.
+ *
+ * Registered records and rings are marked by commit, push and consume.
+ *
+ * @param[in] pointer into a record
+ * @return None
+ ****************************************************************************************
+ */
+void cma_rtm_data_touch(const void *data);
+
+/**
+ ****************************************************************************************
+ * @brief Get records in retention memory with size, offset, last write and free bytes.
+ *
+ * With arena, all records are listed. Without arena, only records used since wake-up
+ * are known and free bytes are not available.
+ *
+ * @param[out] report
+ * @return Success or Fail
+ ****************************************************************************************
+ */
+CMA_STATUS_TYPE cma_rtm_data_get_report(cma_rtm_data_report_t *report);
+
+/**
+ ****************************************************************************************
+ * @brief Print footprint report to console.
+ *
+ * @param[in] None
+ * @return None
+ ****************************************************************************************
+ */
+void cma_rtm_data_print_report(void);
+
+/**
+ ****************************************************************************************
+ * @brief Console command handler printing footprint report.
+ *
+ * Add it to the user command table of SDK, e.g. { "rtm", CMD_FUNC_NODE, NULL, &cma_rtm_data_cmd, "RTM usage" }
+ *
+ * @param[in] argc
+ * @param[in] argv
+ * @return None
+ ****************************************************************************************
+ */
+void cma_rtm_data_cmd(int argc, char *argv[]);
+
 #endif /* CMA_RTM_DATA_H_ */
@@ -0,0 +1,219 @@
+/**
+ ****************************************************************************************
+ *
+ * @file cma_sleep_sim.h
+ *
+ * @brief Host simulation of DPM sleep and retention memory.
+ *
+ * Copyright (c) 2016-2024 Renesas Electronics. All rights reserved.
+ *
+ * This software ("Software") is owned by Renesas Electronics.
+ *
+ * By using this Software you agree that Renesas Electronics retains all
+ * intellectual property and proprietary rights in and to this Software and any
+ * use, reproduction, disclosure or distribution of the Software without express
+ * written permission or a license agreement from Renesas Electronics is
+ * strictly prohibited. This Software is solely for use on or in conjunction
+ * with Renesas Electronics products.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE
+ * SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. EXCEPT AS OTHERWISE
+ * PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * RENESAS ELECTRONICS BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL,
+ * OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ *
+ ****************************************************************************************
+ */
+
+#ifndef CMA_SLEEP_SIM_H_
+
+#define CMA_SLEEP_SIM_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ *****************************************************
+ * Host replacement of the DPM layer for cma_sleep and cma_rtm_data (-DCMA_SLEEP_SIM).
+ * Each boot runs in a process forked from the runner, so everything but retention
+ * memory starts from zero. Power down fast-forwards a virtual RTC, keeps (sleep 3)
+ * or clears (sleep 2) retention memory and ends the process, then the runner calls
+ * the entry function again as user_app_entry() would be after wake-up.
+ ******************************************************
+ */
+
+/* Size of simulated retention memory pool for user (same as dpm_user_rtm_pool_create) */
+#define CMA_SLEEP_SIM_RTM_SIZE          (8 * 1024)
+#define CMA_SLEEP_SIM_RTM_RECORDS       32
+#define CMA_SLEEP_SIM_RTM_NAME_LEN      32
+
+/* Virtual time added to RTC by ROM boot and SDK init before the entry function is called */
+#define CMA_SLEEP_SIM_COLD_BOOT_MS      200
+#define CMA_SLEEP_SIM_WARM_BOOT_MS      40
+
+/* Buckets of histogram of host time from entry to power down */
+#define CMA_SLEEP_SIM_HIST_BUCKETS      16
+
+/*
+ *****************************************************
+ * Definitions of the SDK used by cma_sleep, cma_rtm_data and cma_debug
+ ******************************************************
+ */
+typedef uint8_t UCHAR;
+typedef uint8_t UINT8;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef uint32_t ULONG;
+typedef uint64_t UINT64;
+typedef int32_t INT32;
+typedef void* TimerHandle_t;
+
+/* Codes of da16x_boot_get_wakeupmode */
+enum
+{
+    WAKEUP_RESET = 0x00,
+    WAKEUP_SOURCE_EXT_SIGNAL = 0x01,
+    WAKEUP_SOURCE_WAKEUP_COUNTER = 0x02,
+    WAKEUP_EXT_SIG_WAKEUP_COUNTER = 0x03,
+    WAKEUP_SOURCE_POR = 0x04,
+    WAKEUP_SOURCE_POR_EXT_SIGNAL = 0x05,
+    WAKEUP_WATCHDOG = 0x08,
+    WAKEUP_WATCHDOG_EXT_SIGNAL = 0x09,
+    WAKEUP_SENSOR = 0x10,
+    WAKEUP_SENSOR_EXT_SIGNAL = 0x11,
+    WAKEUP_SENSOR_WAKEUP_COUNTER = 0x12,
+    WAKEUP_SENSOR_EXT_WAKEUP_COUNTER = 0x13,
+    WAKEUP_SENSOR_WATCHDOG = 0x18,
+    WAKEUP_SENSOR_EXT_WATCHDOG = 0x19,
+    WAKEUP_RESET_WITH_RETENTION = 0x80,
+    WAKEUP_COUNTER_WITH_RETENTION = 0x82,
+    WAKEUP_EXT_SIG_WAKEUP_COUNTER_WITH_RETENTION = 0x83,
+    WAKEUP_WATCHDOG_WITH_RETENTION = 0x88,
+    WAKEUP_WATCHDOG_EXT_SIGNAL_WITH_RETENTION = 0x89,
+    WAKEUP_SENSOR_WAKEUP_COUNTER_WITH_RETENTION = 0x92,
+    WAKEUP_SENSOR_WATCHDOG_WITH_RETENTION = 0x98,
+    WAKEUP_SENSOR_EXT_WATCHDOG_WITH_RETENTION = 0x99,
+    WAKEUP_SOURCE_UNKNOWN = 0xFF
+};
+
+#define DA16X_UNUSED_ARG(x)             (void)(x)
+#define PRINTF                          printf
+#define Printf                          printf
+#define __NOP()
+#define pdTRUE                          1
+#define configASSERT(x)                 do { if (!(x)) { abort (); } } while (0)
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+#define taskENTER_CRITICAL_FROM_ISR()   0
+#define taskEXIT_CRITICAL_FROM_ISR(x)   DA16X_UNUSED_ARG(x)
+#define xPortGetMinimumEverFreeHeapSize()   0
+
+unsigned long long RTC_GET_COUNTER(void);
+int da16x_boot_get_wakeupmode(void);
+void do_set_dpm_power_down(UINT64 usec, UCHAR retention);
+
+UINT32 dpm_user_rtm_pool_create(void);
+UINT32 user_rtm_get(char *name, UCHAR **data);
+UINT32 user_rtm_pool_allocate(char *name, void **data, UINT32 size, ULONG wait);
+UINT32 user_rtm_release(char *name);
+
+/* Back end of the OS_ macros of cma_osal.h, single task */
+uint32_t cma_sleep_sim_tick(void);
+uint32_t cma_sleep_sim_wait(uint32_t ms);
+
+static inline int cma_sleep_sim_nop(const void *handle)
+{
+    (void) handle;
+    return 1;
+}
+
+/*
+ *****************************************************
+ * Runner
+ ******************************************************
+ */
+typedef void (*cma_sleep_sim_entry_t)(void);
+
+typedef struct
+{
+    uint32_t boots;                 /* Entry function calls */
+    uint32_t sleep2;                /* Power downs without retention */
+    uint32_t sleep3;                /* Power downs with retention */
+    uint32_t failures;              /* Boots ended without power down */
+    uint64_t virtual_ms;            /* Virtual RTC time */
+    uint64_t awake_ms;              /* Virtual time from wake-up to power down, boot included */
+    uint64_t host_ns_total;         /* Host time of boots from entry to power down */
+    uint64_t host_ns_max;
+    uint32_t host_hist[CMA_SLEEP_SIM_HIST_BUCKETS];   /* Bucket n : [2^n, 2^(n+1)) usec */
+} cma_sleep_sim_stats_t;
+
+/**
+ ****************************************************************************************
+ * @brief Clear retention memory, virtual RTC and statistics. Next boot is a power on.
+ *
+ * @param[in] None.
+ *
+ * @return None.
+ ****************************************************************************************
+ */
+void cma_sleep_sim_reset(void);
+
+/**
+ ****************************************************************************************
+ * @brief Run boots of entry function until it does not power down or cycles are done.
+ *
+ * Each boot runs in a child process. The entry function must end with power down
+ * (cma_sleep_trigger, cma_sleep_request_sleep).
+ *
+ * @param[in] entry function called at each boot.
+ * @param[in] number of boots.
+ *
+ * @return number of boots ended by power down.
+ ****************************************************************************************
+ */
+uint32_t cma_sleep_sim_run(cma_sleep_sim_entry_t entry, uint32_t cycles);
+
+/**
+ ****************************************************************************************
+ * @brief Set wake-up reason of next boot instead of RTC timer (e.g. button press).
+ *
+ * Called from entry function before power down. Retention is still decided by power down.
+ *
+ * @param[in] WAKEUP_ code without _WITH_RETENTION bit.
+ * @param[in] delay of the event after power down(millisecond), 0 for the wake-up time.
+ *
+ * @return None.
+ ****************************************************************************************
+ */
+void cma_sleep_sim_set_wakeup(uint32_t reason, uint32_t delay);
+
+/**
+ ****************************************************************************************
+ * @brief Get statistics of simulation.
+ *
+ * @param[out] statistics.
+ *
+ * @return None.
+ ****************************************************************************************
+ */
+void cma_sleep_sim_get_stats(cma_sleep_sim_stats_t *stats);
+
+/**
+ ****************************************************************************************
+ * @brief Print statistics of simulation and histogram of host awake time.
+ *
+ * @param[in] None.
+ *
+ * @return None.
+ ****************************************************************************************
+ */
+void cma_sleep_sim_print(void);
+
+#endif /* CMA_SLEEP_SIM_H_ */
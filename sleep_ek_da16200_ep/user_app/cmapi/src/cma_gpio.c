@@ -43,6 +43,123 @@
 static uint32_t cma_gpio_status;
 #endif
 
+static cma_gpio_config_t cma_gpio_config;
+
+/* Handles of ports, created and initialized once */
+HANDLE cma_gpio_handle[CMA_GPIO_PORT_MAX];
+
+static HANDLE cma_gpio_port_open(CMA_GPIO_PORT_TYPE port)
+{
+    HANDLE handle;
+
+    if ((uint32_t) port < CMA_GPIO_PORT_MAX && cma_gpio_handle[port] != NULL)
+    {
+        return cma_gpio_handle[port];
+    }
+
+    handle = GPIO_CREATE (port);
+    if (handle == NULL)
+    {
+        return NULL;
+    }
+
+    GPIO_INIT (handle);
+
+    if ((uint32_t) port < CMA_GPIO_PORT_MAX)
+    {
+        cma_gpio_handle[port] = handle;
+    }
+
+    return handle;
+}
+
+/* Port created by cma_gpio_port_open or by SDK */
+static HANDLE cma_gpio_port_get(CMA_GPIO_PORT_TYPE port)
+{
+    HANDLE handle;
+
+    if ((uint32_t) port < CMA_GPIO_PORT_MAX && cma_gpio_handle[port] != NULL)
+    {
+        return cma_gpio_handle[port];
+    }
+
+    handle = GPIO_GET_INSTANCE ((UINT32) port);
+
+    if (handle != NULL && (uint32_t) port < CMA_GPIO_PORT_MAX)
+    {
+        cma_gpio_handle[port] = handle;
+    }
+
+    return handle;
+}
+
+static void cma_gpio_config_func(CMA_GPIO_SET_FUNC_TYPE type)
+{
+    for (uint32_t i = 0; i < cma_gpio_config.func_count; i++)
+    {
+        if (cma_gpio_config.func[i] == (uint8_t) type)
+        {
+            return;
+        }
+    }
+
+    if (cma_gpio_config.func_count >= CMA_GPIO_CONFIG_FUNC_MAX)
+    {
+        cma_gpio_config.overflow = 1;
+        return;
+    }
+
+    cma_gpio_config.func[cma_gpio_config.func_count++] = (uint8_t) type;
+}
+
+static void cma_gpio_config_intr(CMA_GPIO_PORT_TYPE port, CMA_GPIO_PIN_TYPE pin, void *callback)
+{
+    uint32_t i;
+
+    for (i = 0; i < cma_gpio_config.int_count; i++)
+    {
+        if (cma_gpio_config.intr[i].port == (uint8_t) port && cma_gpio_config.intr[i].pin == (uint8_t) pin)
+        {
+            break;
+        }
+    }
+
+    if (callback == NULL)
+    {
+        /* Remove */
+        if (i < cma_gpio_config.int_count)
+        {
+            cma_gpio_config.int_count--;
+            cma_gpio_config.intr[i] = cma_gpio_config.intr[cma_gpio_config.int_count];
+        }
+        return;
+    }
+
+    if (i == cma_gpio_config.int_count)
+    {
+        if (cma_gpio_config.int_count >= CMA_GPIO_CONFIG_INT_MAX)
+        {
+            cma_gpio_config.overflow = 1;
+            return;
+        }
+        cma_gpio_config.int_count++;
+    }
+
+    cma_gpio_config.intr[i].port = (uint8_t) port;
+    cma_gpio_config.intr[i].pin = (uint8_t) pin;
+    cma_gpio_config.intr[i].callback = callback;
+}
+
+CMA_STATUS_TYPE cma_gpio_open_port(CMA_GPIO_PORT_TYPE port)
+{
+    if ((uint32_t) port >= CMA_GPIO_PORT_MAX || cma_gpio_port_open (port) == NULL)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    return CMA_STATUS_OK;
+}
+
 /* Usage : cma_gpio_set_func -> cma_gpio_set_input/cma_gpio_set_output/each peripheral function(I2C/SPI/UART) */
 /* -> cma_gpio_get_input/cma_gpio_set_output_level */
 CMA_GPIO_LEVEL_TYPE cma_gpio_get_input(CMA_GPIO_PORT_TYPE port, CMA_GPIO_PIN_TYPE pin)
@@ -52,7 +169,7 @@ CMA_GPIO_LEVEL_TYPE cma_gpio_get_input(CMA_GPIO_PORT_TYPE port, CMA_GPIO_PIN_TYP
     uint8_t ret;
     uint32_t ioctldata;
 
-    handle = GPIO_GET_INSTANCE (port);
+    handle = cma_gpio_port_get (port);
     if (handle == NULL)
     {
         return CMA_GPIO_LEVEL_ERR;
@@ -75,14 +192,12 @@ CMA_STATUS_TYPE cma_gpio_set_input(CMA_GPIO_PORT_TYPE port, CMA_GPIO_PIN_TYPE pi
     HANDLE handle;
     uint32_t ioctldata;
 
-    handle = GPIO_CREATE (port);
+    handle = cma_gpio_port_open (port);
     if (handle == NULL)
     {
         return CMA_STATUS_FAIL;
     }
 
-    GPIO_INIT (handle);
-
     ioctldata = (UINT32) (0x01 << pin);
     GPIO_IOCTL (handle, GPIO_SET_INPUT, &ioctldata);
 
@@ -99,6 +214,24 @@ CMA_STATUS_TYPE cma_gpio_set_input(CMA_GPIO_PORT_TYPE port, CMA_GPIO_PIN_TYPE pi
         break;
     }
 
+    if (port < CMA_GPIO_PORT_MAX)
+    {
+        cma_gpio_port_config_t *config = &cma_gpio_config.port[port];
+
+        config->input |= (uint16_t) ioctldata;
+        config->output &= (uint16_t) ~ioctldata;
+        config->pull_up &= (uint16_t) ~ioctldata;
+        config->pull_down &= (uint16_t) ~ioctldata;
+        config->high_z &= (uint16_t) ~ioctldata;
+
+        if (state == CMA_GPIO_PULL_DOWN)
+            config->pull_down |= (uint16_t) ioctldata;
+        else if (state == CMA_GPIO_PULL_UP)
+            config->pull_up |= (uint16_t) ioctldata;
+        else
+            config->high_z |= (uint16_t) ioctldata;
+    }
+
     return CMA_STATUS_OK;
 
 }
@@ -109,7 +242,7 @@ CMA_STATUS_TYPE cma_gpio_set_output_level(CMA_GPIO_PORT_TYPE port, CMA_GPIO_PIN_
     uint16_t data;
     uint32_t ioctldata;
 
-    handle = GPIO_GET_INSTANCE ((UINT32) port);
+    handle = cma_gpio_port_get (port);
     if (handle == NULL)
     {
         return CMA_STATUS_FAIL;
@@ -122,44 +255,109 @@ CMA_STATUS_TYPE cma_gpio_set_output_level(CMA_GPIO_PORT_TYPE port, CMA_GPIO_PIN_
         data = (UINT16) (0x1 << pin);
 
     GPIO_WRITE (handle, (UINT32) ioctldata, &data, sizeof(UINT16));
+
+    if (port < CMA_GPIO_PORT_MAX)
+    {
+        cma_gpio_config.port[port].output_high &= (uint16_t) ~ioctldata;
+        cma_gpio_config.port[port].output_high |= data;
+    }
+
     return CMA_STATUS_OK;
 }
 
+CMA_STATUS_TYPE cma_gpio_write_mask(CMA_GPIO_PORT_TYPE port, uint16_t mask, uint16_t value)
+{
+    HANDLE handle;
+    uint16_t data;
+
+    handle = cma_gpio_port_get (port);
+    if (handle == NULL)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    if (mask == 0)
+    {
+        return CMA_STATUS_OK;
+    }
+
+    /* Pins out of mask are not changed by the driver */
+    data = value & mask;
+    GPIO_WRITE (handle, (UINT32) mask, &data, sizeof(UINT16));
+
+    if (port < CMA_GPIO_PORT_MAX)
+    {
+        cma_gpio_config.port[port].output_high &= (uint16_t) ~mask;
+        cma_gpio_config.port[port].output_high |= data;
+    }
+
+    return CMA_STATUS_OK;
+}
+
+uint32_t cma_gpio_read_port(CMA_GPIO_PORT_TYPE port)
+{
+    HANDLE handle;
+    uint16_t read_data = 0;
+
+    handle = cma_gpio_port_get (port);
+    if (handle == NULL)
+    {
+        return CMA_GPIO_PORT_ERR;
+    }
+
+    if (GPIO_READ (handle, CMA_GPIO_PORT_ALL_PINS, &read_data, sizeof(UINT16)) == FALSE)
+    {
+        return CMA_GPIO_PORT_ERR;
+    }
+
+    return read_data;
+}
+
 CMA_STATUS_TYPE cma_gpio_set_output(CMA_GPIO_PORT_TYPE port, CMA_GPIO_PIN_TYPE pin)
 {
     HANDLE handle;
     uint32_t ioctldata;
 
-    handle = GPIO_CREATE (port);
+    handle = cma_gpio_port_open (port);
     if (handle == NULL)
     {
         return CMA_STATUS_FAIL;
     }
 
-    GPIO_INIT (handle);
-
     ioctldata = (UINT32) (0x01 << pin);
     GPIO_IOCTL (handle, GPIO_SET_OUTPUT, &ioctldata);
 
+    if (port < CMA_GPIO_PORT_MAX)
+    {
+        cma_gpio_config.port[port].output |= (uint16_t) ioctldata;
+        cma_gpio_config.port[port].input &= (uint16_t) ~ioctldata;
+    }
+
     return CMA_STATUS_OK;
 }
 
 CMA_STATUS_TYPE cma_gpio_set_interrupt_disable(CMA_GPIO_PORT_TYPE port, CMA_GPIO_PIN_TYPE pin)
 {
     HANDLE handle;
-    uint32_t int_en_status;
+    uint32_t shift_pin, int_en_status;
 
-    handle = GPIO_GET_INSTANCE ((UINT32) port);
+    handle = cma_gpio_port_get (port);
     if (handle == NULL)
     {
         return CMA_STATUS_FAIL;
     }
 
-    pin = 0x01 << pin;
+    shift_pin = 0x01 << pin;
     GPIO_IOCTL (handle, GPIO_GET_INTR_ENABLE, &int_en_status);
-    int_en_status |= pin;
+    int_en_status |= shift_pin;
     GPIO_IOCTL (handle, GPIO_SET_INTR_DISABLE, &int_en_status);
 
+    if (port < CMA_GPIO_PORT_MAX)
+    {
+        cma_gpio_config.port[port].int_enable &= (uint16_t) ~shift_pin;
+        cma_gpio_config_intr (port, pin, NULL);
+    }
+
     return CMA_STATUS_OK;
 }
 
@@ -173,7 +371,7 @@ CMA_STATUS_TYPE cma_gpio_set_interrupt(CMA_GPIO_PORT_TYPE port, CMA_GPIO_PIN_TYP
 
     int type = 0, level = 0;
 
-    handle = GPIO_GET_INSTANCE ((UINT32) port);
+    handle = cma_gpio_port_get (port);
     if (handle == NULL)
     {
         return CMA_STATUS_FAIL;
@@ -221,6 +419,18 @@ CMA_STATUS_TYPE cma_gpio_set_interrupt(CMA_GPIO_PORT_TYPE port, CMA_GPIO_PIN_TYP
     int_en_status |= shift_pin;
     GPIO_IOCTL (handle, GPIO_SET_INTR_ENABLE, &int_en_status);
 
+    if (port < CMA_GPIO_PORT_MAX)
+    {
+        cma_gpio_port_config_t *config = &cma_gpio_config.port[port];
+
+        config->input |= (uint16_t) shift_pin;
+        config->output &= (uint16_t) ~shift_pin;
+        config->int_enable |= (uint16_t) shift_pin;
+        config->int_edge = (uint16_t) ((config->int_edge & ~shift_pin) | (type << pin));
+        config->int_high = (uint16_t) ((config->int_high & ~shift_pin) | (level << pin));
+        cma_gpio_config_intr (port, pin, callback_func);
+    }
+
     return CMA_STATUS_OK;
 }
 
@@ -440,6 +650,126 @@ CMA_STATUS_TYPE cma_gpio_set_func(CMA_GPIO_SET_FUNC_TYPE type)
         default:
             return CMA_STATUS_FAIL;
     }
+
+    cma_gpio_config_func (type);
+    return CMA_STATUS_OK;
+}
+
+CMA_STATUS_TYPE cma_gpio_get_config(cma_gpio_config_t *config)
+{
+    if (config == NULL || cma_gpio_config.overflow)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    memcpy (config, &cma_gpio_config, sizeof(cma_gpio_config_t));
+    return CMA_STATUS_OK;
+}
+
+CMA_STATUS_TYPE cma_gpio_apply_config(const cma_gpio_config_t *config)
+{
+    uint32_t ioctldata[3];
+    HANDLE handle;
+    uint16_t data;
+
+    if (config == NULL || config->overflow || config->func_count > CMA_GPIO_CONFIG_FUNC_MAX
+        || config->int_count > CMA_GPIO_CONFIG_INT_MAX)
+    {
+        return CMA_STATUS_FAIL;
+    }
+
+    for (uint32_t i = 0; i < config->func_count; i++)
+    {
+        if (cma_gpio_set_func ((CMA_GPIO_SET_FUNC_TYPE) config->func[i]) != CMA_STATUS_OK)
+        {
+            return CMA_STATUS_FAIL;
+        }
+    }
+
+    for (uint32_t port = 0; port < CMA_GPIO_PORT_MAX; port++)
+    {
+        const cma_gpio_port_config_t *port_config = &config->port[port];
+
+        if ((port_config->input | port_config->output) == 0)
+        {
+            continue;
+        }
+
+        handle = cma_gpio_port_open ((CMA_GPIO_PORT_TYPE) port);
+        if (handle == NULL)
+        {
+            return CMA_STATUS_FAIL;
+        }
+
+        if (port_config->input)
+        {
+            ioctldata[0] = port_config->input;
+            GPIO_IOCTL (handle, GPIO_SET_INPUT, &ioctldata[0]);
+        }
+
+        if (port_config->output)
+        {
+            ioctldata[0] = port_config->output;
+            GPIO_IOCTL (handle, GPIO_SET_OUTPUT, &ioctldata[0]);
+
+            data = port_config->output_high & port_config->output;
+            GPIO_WRITE (handle, (UINT32) port_config->output, &data, sizeof(UINT16));
+        }
+
+        if (port_config->pull_down)
+            _da16x_gpio_set_pull ((GPIO_UNIT_TYPE) port, port_config->pull_down, PULL_DOWN);
+        if (port_config->pull_up)
+            _da16x_gpio_set_pull ((GPIO_UNIT_TYPE) port, port_config->pull_up, PULL_UP);
+        if (port_config->high_z)
+            _da16x_gpio_set_pull ((GPIO_UNIT_TYPE) port, port_config->high_z, HIGH_Z);
+
+        if (port_config->int_enable)
+        {
+            ioctldata[0] = 0;
+            ioctldata[1] = 0;
+            GPIO_IOCTL (handle, GPIO_GET_INTR_MODE, &ioctldata[0]);
+            ioctldata[0] = (ioctldata[0] & ~port_config->int_enable) | (port_config->int_edge & port_config->int_enable);
+            ioctldata[1] = (ioctldata[1] & ~port_config->int_enable) | (port_config->int_high & port_config->int_enable);
+            GPIO_IOCTL (handle, GPIO_SET_INTR_MODE, &ioctldata[0]);
+        }
+    }
+
+    /* Callbacks before enable, so no interrupt is lost */
+    for (uint32_t i = 0; i < config->int_count; i++)
+    {
+        const cma_gpio_int_config_t *intr = &config->intr[i];
+
+        handle = cma_gpio_port_get ((CMA_GPIO_PORT_TYPE) intr->port);
+        if (handle == NULL)
+        {
+            return CMA_STATUS_FAIL;
+        }
+
+        ioctldata[0] = 0x01 << intr->pin; /* interrupt pin */
+        ioctldata[1] = (UINT32) intr->callback; /* callback function */
+        ioctldata[2] = (UINT32) intr->pin; /* param data */
+        GPIO_IOCTL (handle, GPIO_SET_CALLACK, ioctldata);
+    }
+
+    for (uint32_t port = 0; port < CMA_GPIO_PORT_MAX; port++)
+    {
+        if (config->port[port].int_enable == 0)
+        {
+            continue;
+        }
+
+        handle = cma_gpio_port_get ((CMA_GPIO_PORT_TYPE) port);
+        if (handle == NULL)
+        {
+            return CMA_STATUS_FAIL;
+        }
+
+        GPIO_IOCTL (handle, GPIO_GET_INTR_ENABLE, &ioctldata[0]);
+        ioctldata[0] |= config->port[port].int_enable;
+        GPIO_IOCTL (handle, GPIO_SET_INTR_ENABLE, &ioctldata[0]);
+    }
+
+    memcpy (&cma_gpio_config, config, sizeof(cma_gpio_config_t));
     return CMA_STATUS_OK;
 }
 
@@ -584,5 +914,11 @@ CMA_STATUS_TYPE cma_gpio_set_spi_slave_func(CMA_GPIO_PORT_TYPE port, CMA_GPIO_PI
     GPIO_SET_ALT_FUNC (gpio, GPIO_ALT_FUNC_EXT_INTR, (GPIO_ALT_GPIO_NUM_TYPE) (pin));
     GPIO_CLOSE (gpio);
 
+    /* Handle may be closed, it is opened again on next use */
+    if ((uint32_t) port < CMA_GPIO_PORT_MAX)
+    {
+        cma_gpio_handle[port] = NULL;
+    }
+
     return CMA_STATUS_OK;
 }
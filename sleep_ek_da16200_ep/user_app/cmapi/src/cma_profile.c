@@ -0,0 +1,167 @@
+/**
+ ****************************************************************************************
+ *
+ * @file cma_profile.c
+ *
+ * @brief Boot and wake-up phase profiler.
+ *
+ * Copyright (c) 2016-2024 Renesas Electronics. All rights reserved.
+ *
+ * This software ("Software") is owned by Renesas Electronics.
+ *
+ * By using this Software you agree that Renesas Electronics retains all
+ * intellectual property and proprietary rights in and to this Software and any
+ * use, reproduction, disclosure or distribution of the Software without express
+ * written permission or a license agreement from Renesas Electronics is
+ * strictly prohibited. This Software is solely for use on or in conjunction
+ * with Renesas Electronics products.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE
+ * SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. EXCEPT AS OTHERWISE
+ * PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * RENESAS ELECTRONICS BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL,
+ * OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ *
+ ****************************************************************************************
+ */
+
+#include "sdk_type.h"
+#include "da16x_system.h"
+#include "rtc.h"
+#include "cma_debug.h"
+#include "cma_rtm_data.h"
+#include "cma_profile.h"
+
+#define CMA_PROFILE_TAG                 "cma_profile"
+#define CMA_PROFILE_MAGIC               0x464F5250  /* "PROF" */
+
+/* RTC runs at 32768Hz, about 30 usec resolution */
+#define CMA_PROFILE_TICKS_TO_US(t)      ((uint32_t) (((uint64_t) (t) * 1000000) >> 15))
+
+/* Averages in retention memory (usec from user_main) */
+struct cma_profile_state_t
+{
+    uint32_t magic;
+    uint32_t count;
+    uint32_t average[CMA_PROFILE_PHASE_MAX];
+};
+
+/* No OS calls here, marks are taken before the scheduler starts */
+static uint32_t cma_profile_mark_time[CMA_PROFILE_PHASE_MAX];
+static uint8_t cma_profile_marked[CMA_PROFILE_PHASE_MAX];
+static struct cma_profile_state_t *cma_profile_state;
+
+static const char *cma_profile_name[CMA_PROFILE_PHASE_MAX] =
+{
+    "user_main",
+    "system_start",
+    "wu_hw_resource",
+    "system_init",
+    "user_app_entry",
+    "task_create",
+    "task_start",
+    "first_event",
+};
+
+void cma_profile_mark(CMA_PROFILE_PHASE phase)
+{
+    if (phase >= CMA_PROFILE_PHASE_MAX || cma_profile_marked[phase])
+    {
+        return;
+    }
+
+    cma_profile_mark_time[phase] = (uint32_t) RTC_GET_COUNTER();
+    cma_profile_marked[phase] = 1;
+}
+
+uint32_t cma_profile_get(CMA_PROFILE_PHASE phase)
+{
+    if (phase >= CMA_PROFILE_PHASE_MAX || !cma_profile_marked[phase] || !cma_profile_marked[CMA_PROFILE_USER_MAIN])
+    {
+        return 0;
+    }
+
+    return CMA_PROFILE_TICKS_TO_US(cma_profile_mark_time[phase] - cma_profile_mark_time[CMA_PROFILE_USER_MAIN]);
+}
+
+CMA_STATUS_TYPE cma_profile_save(void)
+{
+    if (cma_profile_state != NULL)
+    {
+        return CMA_STATUS_OK;
+    }
+
+    if (cma_rtm_data_alloc_and_read ((uint8_t*) CMA_PROFILE_TAG, (uint8_t**) &cma_profile_state,
+                                     sizeof(struct cma_profile_state_t)) != CMA_STATUS_OK)
+    {
+        cma_profile_state = NULL;
+        return CMA_STATUS_FAIL;
+    }
+
+    if (cma_profile_state->magic != CMA_PROFILE_MAGIC)
+    {
+        memset (cma_profile_state, 0, sizeof(struct cma_profile_state_t));
+        cma_profile_state->magic = CMA_PROFILE_MAGIC;
+    }
+
+    for (uint32_t i = 0; i < CMA_PROFILE_PHASE_MAX; i++)
+    {
+        uint32_t time = cma_profile_get ((CMA_PROFILE_PHASE) i);
+
+        if (!cma_profile_marked[i])
+        {
+            continue;
+        }
+
+        /* Moving average, the first sample is taken as is */
+        if (cma_profile_state->average[i] == 0)
+            cma_profile_state->average[i] = time;
+        else
+            cma_profile_state->average[i] = (cma_profile_state->average[i] * 7 + time) / 8;
+    }
+
+    cma_profile_state->count++;
+
+    return CMA_STATUS_OK;
+}
+
+void cma_profile_print(void)
+{
+    uint32_t last = CMA_PROFILE_USER_MAIN;
+
+    PRINTF("%-16s %10s %10s %10s\n", "phase", "at(us)", "took(us)", "avg(us)");
+
+    for (uint32_t i = 0; i < CMA_PROFILE_PHASE_MAX; i++)
+    {
+        uint32_t time, next = 0;
+
+        if (!cma_profile_marked[i])
+        {
+            continue;
+        }
+
+        time = cma_profile_get ((CMA_PROFILE_PHASE) i);
+
+        /* Phase lasts until the next marked phase */
+        for (uint32_t j = i + 1; j < CMA_PROFILE_PHASE_MAX; j++)
+        {
+            if (cma_profile_marked[j])
+            {
+                next = cma_profile_get ((CMA_PROFILE_PHASE) j);
+                break;
+            }
+        }
+
+        PRINTF("%-16s %10d %10d %10d\n", cma_profile_name[i], time, (next > time) ? next - time : 0,
+               (cma_profile_state != NULL) ? cma_profile_state->average[i] : 0);
+        last = i;
+    }
+
+    PRINTF("user_main to %s : %d us (%d boots saved)\n", cma_profile_name[last],
+           cma_profile_get ((CMA_PROFILE_PHASE) last), (cma_profile_state != NULL) ? cma_profile_state->count : 0);
+}
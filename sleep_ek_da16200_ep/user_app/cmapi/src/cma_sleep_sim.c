@@ -0,0 +1,410 @@
+/**
+ ****************************************************************************************
+ *
+ * @file cma_sleep_sim.c
+ *
+ * @brief Simulated DPM sleep and retention memory for host builds.
+ *
+ * Copyright (c) 2016-2024 Renesas Electronics. All rights reserved.
+ *
+ * This software ("Software") is owned by Renesas Electronics.
+ *
+ * By using this Software you agree that Renesas Electronics retains all
+ * intellectual property and proprietary rights in and to this Software and any
+ * use, reproduction, disclosure or distribution of the Software without express
+ * written permission or a license agreement from Renesas Electronics is
+ * strictly prohibited. This Software is solely for use on or in conjunction
+ * with Renesas Electronics products.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE
+ * SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. EXCEPT AS OTHERWISE
+ * PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * RENESAS ELECTRONICS BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL,
+ * OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ *
+ ****************************************************************************************
+ */
+
+
+#if defined(CMA_SLEEP_SIM)
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "cma_debug.h"
+#include "cma_sleep_sim.h"
+
+#define CMA_SLEEP_SIM_RTC_HZ            32768
+#define CMA_SLEEP_SIM_ALIGN(x)          (((x) + 7) & ~7)    /* 64-bit fields of records on host */
+#define CMA_SLEEP_SIM_NO_WAKEUP         0xFFFFFFFF
+
+struct cma_sleep_sim_record_t
+{
+    char name[CMA_SLEEP_SIM_RTM_NAME_LEN];
+    uint32_t offset;
+    uint32_t size;
+};
+
+/* Shared with the boot processes, so it survives power down like retention memory */
+struct cma_sleep_sim_t
+{
+    uint64_t rtc;
+    uint64_t wake_rtc;
+    uint32_t wakeup_mode;
+    uint32_t next_reason;
+    uint32_t next_delay;
+    uint32_t rtm_used;
+    struct cma_sleep_sim_record_t record[CMA_SLEEP_SIM_RTM_RECORDS];
+    uint8_t rtm[CMA_SLEEP_SIM_RTM_SIZE];
+    cma_sleep_sim_stats_t stats;
+};
+
+static struct cma_sleep_sim_t *cma_sleep_sim;
+static struct timespec cma_sleep_sim_entry_time;
+
+int32_t debug_level = LOG_WARN;
+
+static struct cma_sleep_sim_t* cmai_sleep_sim_get(void)
+{
+    if (cma_sleep_sim == NULL)
+    {
+        cma_sleep_sim = mmap (NULL, sizeof(struct cma_sleep_sim_t), PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (cma_sleep_sim == MAP_FAILED)
+        {
+            perror ("mmap");
+            abort ();
+        }
+
+        cma_sleep_sim_reset ();
+    }
+
+    return cma_sleep_sim;
+}
+
+static uint64_t cmai_sleep_sim_host_ns(const struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime (CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) (now.tv_sec - start->tv_sec) * 1000000000ULL + now.tv_nsec - start->tv_nsec;
+}
+
+static void cmai_sleep_sim_advance(uint64_t ms)
+{
+    cma_sleep_sim->rtc += ms * CMA_SLEEP_SIM_RTC_HZ / 1000;
+}
+
+static void cmai_sleep_sim_rtm_clear(void)
+{
+    memset (cma_sleep_sim->record, 0, sizeof(cma_sleep_sim->record));
+
+    /* Contents of retention memory are undefined after power on */
+    memset (cma_sleep_sim->rtm, 0xA5, sizeof(cma_sleep_sim->rtm));
+    cma_sleep_sim->rtm_used = 0;
+}
+
+static struct cma_sleep_sim_record_t* cmai_sleep_sim_rtm_find(const char *name)
+{
+    for (uint32_t i = 0; i < CMA_SLEEP_SIM_RTM_RECORDS; i++)
+    {
+        if (cma_sleep_sim->record[i].size != 0
+                && strncmp (cma_sleep_sim->record[i].name, name, CMA_SLEEP_SIM_RTM_NAME_LEN) == 0)
+        {
+            return &cma_sleep_sim->record[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void cmai_sleep_sim_boot(cma_sleep_sim_entry_t entry)
+{
+    uint8_t warm = (cma_sleep_sim->wakeup_mode & 0x80) ? 1 : 0;
+
+    cma_sleep_sim->wake_rtc = cma_sleep_sim->rtc;
+    cmai_sleep_sim_advance (warm ? CMA_SLEEP_SIM_WARM_BOOT_MS : CMA_SLEEP_SIM_COLD_BOOT_MS);
+    cma_sleep_sim->next_reason = CMA_SLEEP_SIM_NO_WAKEUP;
+
+    clock_gettime (CLOCK_MONOTONIC, &cma_sleep_sim_entry_time);
+
+    entry ();
+
+    /* Tasks would keep running, but nothing else can wake them up here */
+    LOG(LOG_ERR, "boot %d ended without power down", cma_sleep_sim->stats.boots);
+    _exit (1);
+}
+
+void cma_sleep_sim_reset(void)
+{
+    cmai_sleep_sim_get ();
+
+    cmai_sleep_sim_rtm_clear ();
+    cma_sleep_sim->rtc = 0;
+    cma_sleep_sim->wake_rtc = 0;
+    cma_sleep_sim->wakeup_mode = WAKEUP_SOURCE_POR;
+    cma_sleep_sim->next_reason = CMA_SLEEP_SIM_NO_WAKEUP;
+    memset (&cma_sleep_sim->stats, 0, sizeof(cma_sleep_sim_stats_t));
+}
+
+uint32_t cma_sleep_sim_run(cma_sleep_sim_entry_t entry, uint32_t cycles)
+{
+    uint32_t done = 0;
+    pid_t pid;
+    int status;
+
+    cmai_sleep_sim_get ();
+
+    while (done < cycles)
+    {
+        cma_sleep_sim->stats.boots++;
+
+        fflush (stdout);
+        pid = fork ();
+        if (pid < 0)
+        {
+            perror ("fork");
+            break;
+        }
+
+        if (pid == 0)
+        {
+            cmai_sleep_sim_boot (entry);
+        }
+
+        if (waitpid (pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            cma_sleep_sim->stats.failures++;
+            break;
+        }
+
+        done++;
+    }
+
+    return done;
+}
+
+void cma_sleep_sim_set_wakeup(uint32_t reason, uint32_t delay)
+{
+    cmai_sleep_sim_get ();
+
+    cma_sleep_sim->next_reason = reason;
+    cma_sleep_sim->next_delay = delay;
+}
+
+void cma_sleep_sim_get_stats(cma_sleep_sim_stats_t *stats)
+{
+    cmai_sleep_sim_get ();
+
+    memcpy (stats, &cma_sleep_sim->stats, sizeof(cma_sleep_sim_stats_t));
+    stats->virtual_ms = cma_sleep_sim->rtc * 1000 / CMA_SLEEP_SIM_RTC_HZ;
+}
+
+void cma_sleep_sim_print(void)
+{
+    cma_sleep_sim_stats_t stats;
+    uint32_t sleeps;
+
+    cma_sleep_sim_get_stats (&stats);
+    sleeps = stats.sleep2 + stats.sleep3;
+
+    PRINTF("boots %u (sleep2 %u, sleep3 %u, failed %u)\n", stats.boots, stats.sleep2, stats.sleep3,
+           stats.failures);
+    PRINTF("virtual time %llu ms, awake %llu ms\n", (unsigned long long) stats.virtual_ms,
+           (unsigned long long) stats.awake_ms);
+
+    if (sleeps == 0)
+    {
+        return;
+    }
+
+    PRINTF("host time to power down : avg %llu us, max %llu us\n",
+           (unsigned long long) (stats.host_ns_total / sleeps / 1000),
+           (unsigned long long) (stats.host_ns_max / 1000));
+
+    for (uint32_t i = 0; i < CMA_SLEEP_SIM_HIST_BUCKETS; i++)
+    {
+        if (stats.host_hist[i] != 0)
+        {
+            PRINTF("  < %8u us : %u\n", 2U << i, stats.host_hist[i]);
+        }
+    }
+}
+
+/*
+ *****************************************************
+ * DPM layer of the SDK
+ ******************************************************
+ */
+unsigned long long RTC_GET_COUNTER(void)
+{
+    return cmai_sleep_sim_get ()->rtc;
+}
+
+int da16x_boot_get_wakeupmode(void)
+{
+    return (int) cmai_sleep_sim_get ()->wakeup_mode;
+}
+
+uint32_t cma_sleep_sim_tick(void)
+{
+    cmai_sleep_sim_get ();
+
+    /* Boot time is counted, as by ticks of the SDK */
+    return (uint32_t) ((cma_sleep_sim->rtc - cma_sleep_sim->wake_rtc) * 1000 / CMA_SLEEP_SIM_RTC_HZ);
+}
+
+uint32_t cma_sleep_sim_wait(uint32_t ms)
+{
+    /* No other task could signal, so the timeout always expires */
+    if (ms == 0xFFFFFFFF)
+    {
+        LOG(LOG_ERR, "wait forever in simulation");
+        abort ();
+    }
+
+    cmai_sleep_sim_get ();
+    cmai_sleep_sim_advance (ms);
+
+    return 0;
+}
+
+void do_set_dpm_power_down(UINT64 usec, UCHAR retention)
+{
+    uint64_t host_ns, sleep_ms = usec / 1000;
+    uint32_t reason, bucket;
+
+    cmai_sleep_sim_get ();
+
+    host_ns = cmai_sleep_sim_host_ns (&cma_sleep_sim_entry_time);
+    cma_sleep_sim->stats.host_ns_total += host_ns;
+    if (host_ns > cma_sleep_sim->stats.host_ns_max)
+    {
+        cma_sleep_sim->stats.host_ns_max = host_ns;
+    }
+
+    for (bucket = 0; bucket < CMA_SLEEP_SIM_HIST_BUCKETS - 1 && (host_ns / 1000) >= (2ULL << bucket); bucket++)
+        ;
+    cma_sleep_sim->stats.host_hist[bucket]++;
+    cma_sleep_sim->stats.awake_ms += cma_sleep_sim_tick ();
+
+    /* An event set by cma_sleep_sim_set_wakeup comes before the RTC timer */
+    reason = WAKEUP_SOURCE_WAKEUP_COUNTER;
+    if (cma_sleep_sim->next_reason != CMA_SLEEP_SIM_NO_WAKEUP)
+    {
+        reason = cma_sleep_sim->next_reason;
+        if (cma_sleep_sim->next_delay != 0 && cma_sleep_sim->next_delay < sleep_ms)
+        {
+            sleep_ms = cma_sleep_sim->next_delay;
+        }
+    }
+
+    if (retention)
+    {
+        cma_sleep_sim->stats.sleep3++;
+
+        if (reason == WAKEUP_SOURCE_EXT_SIGNAL)
+            reason = WAKEUP_EXT_SIG_WAKEUP_COUNTER_WITH_RETENTION;
+        else
+            reason |= 0x80;
+    }
+    else
+    {
+        cma_sleep_sim->stats.sleep2++;
+        cmai_sleep_sim_rtm_clear ();
+    }
+
+    cma_sleep_sim->wakeup_mode = reason;
+    cmai_sleep_sim_advance (sleep_ms);
+
+    fflush (stdout);
+    _exit (0);
+}
+
+/* Whole pool is created at first boot, records are packed in allocation order */
+UINT32 dpm_user_rtm_pool_create(void)
+{
+    cmai_sleep_sim_get ();
+
+    return 1;
+}
+
+UINT32 user_rtm_get(char *name, UCHAR **data)
+{
+    struct cma_sleep_sim_record_t *record;
+
+    cmai_sleep_sim_get ();
+
+    record = cmai_sleep_sim_rtm_find (name);
+    if (record == NULL)
+    {
+        return 0;
+    }
+
+    *data = &cma_sleep_sim->rtm[record->offset];
+
+    return record->size;
+}
+
+UINT32 user_rtm_pool_allocate(char *name, void **data, UINT32 size, ULONG wait)
+{
+    DA16X_UNUSED_ARG(wait);
+
+    cmai_sleep_sim_get ();
+
+    if (size == 0 || strlen (name) >= CMA_SLEEP_SIM_RTM_NAME_LEN || cmai_sleep_sim_rtm_find (name) != NULL
+            || CMA_SLEEP_SIM_ALIGN(size) > CMA_SLEEP_SIM_RTM_SIZE - cma_sleep_sim->rtm_used)
+    {
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < CMA_SLEEP_SIM_RTM_RECORDS; i++)
+    {
+        struct cma_sleep_sim_record_t *record = &cma_sleep_sim->record[i];
+
+        if (record->size == 0)
+        {
+            strcpy (record->name, name);
+            record->offset = cma_sleep_sim->rtm_used;
+            record->size = size;
+            cma_sleep_sim->rtm_used += CMA_SLEEP_SIM_ALIGN(size);
+
+            *data = &cma_sleep_sim->rtm[record->offset];
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+UINT32 user_rtm_release(char *name)
+{
+    struct cma_sleep_sim_record_t *record;
+
+    cmai_sleep_sim_get ();
+
+    record = cmai_sleep_sim_rtm_find (name);
+    if (record == NULL)
+    {
+        return 1;
+    }
+
+    /* Space is given back only by the last record */
+    if (record->offset + CMA_SLEEP_SIM_ALIGN(record->size) == cma_sleep_sim->rtm_used)
+    {
+        cma_sleep_sim->rtm_used = record->offset;
+    }
+
+    memset (record, 0, sizeof(struct cma_sleep_sim_record_t));
+
+    return 0;
+}
+
+#endif /* CMA_SLEEP_SIM */
@@ -36,9 +36,12 @@
 #include "command_net.h"
 #include "da16x_sys_watchdog.h"
 #include "sys_feature.h"
+#include "cma_backoff.h"
 #include "cma_debug.h"
 #include "cma_gpio.h"
 #include "cma_osal.h"
+#include "cma_profile.h"
+#include "cma_rtm_data.h"
 #include "cma_sleep.h"
 #include "user_hw_pin_config.h"
 #include "user_sleep.h"
@@ -48,23 +51,111 @@
 #define USER_SLEEP_TASK_STACK_SZ   	(256 * 4)
 #define USER_SLEEP_TASK_PRI        	OS_TASK_PRIORITY_USER
 
-#define USER_SLEEP_TIME	            (10000)
+/* Bounds of adaptive sleep interval, shorter while buttons are pressed */
+#define USER_SLEEP_TIME_MIN         (10000)
+#define USER_SLEEP_TIME_MAX         (160000)
 
 #define USER_SLEEP2_INT             (1 << 2)
 #define USER_SLEEP3_INT  	      	(1 << 3)
 
+/* Period of report wake request served from sleep 3, sensor follows adaptive interval */
+#define USER_REPORT_PERIOD          (30000)
+
+/* GPIO configuration kept in retention memory for fast resume */
+#define USER_GPIO_CACHE_TAG         "user_gpio_cfg"
+#define USER_GPIO_CACHE_MAGIC       0x4F495047  /* "GPIO" */
+
+struct user_gpio_cache_t {
+    uint32_t magic;
+    cma_gpio_config_t config;
+};
+
 
 int32_t debug_level = 4;
 
 /* Local variable */
 static OS_TASK xTask = NULL;
+static uint32_t user_sensor_req;
+static uint32_t user_report_req;
+static struct user_gpio_cache_t *user_gpio_cache;
 
 /* Local functions */
 
+static void user_sensor_wake_handler(void *param)
+{
+    DA16X_UNUSED_ARG(param);
+
+    LOG(LOG_INFO, "Sensor wake request served");
+    cma_sleep_request_set(user_sensor_req, cma_sleep_adapt_next());
+}
+
+static void user_report_wake_handler(void *param)
+{
+    DA16X_UNUSED_ARG(param);
+
+    LOG(LOG_INFO, "Report wake request served");
+    cma_sleep_request_set(user_report_req, USER_REPORT_PERIOD);
+}
+
+static void user_sleep_requests_init(void)
+{
+    uint32_t start = cma_sleep_resume_begin();
+
+    if (cma_rtm_data_init() == CMA_STATUS_FAIL) {
+        configASSERT(0);
+    }
+
+    cma_sleep_resume_end("rtm_data", start, cma_sleep_is_resume());
+
+    /* Abnormal wake-up intervals with the seed and success rate kept in RTM */
+    if (cma_backoff_init() == CMA_STATUS_FAIL) {
+        configASSERT(0);
+    }
+
+    if (cma_sleep_adapt_init(USER_SLEEP_TIME_MIN, USER_SLEEP_TIME_MAX, 0) == CMA_STATUS_FAIL) {
+        configASSERT(0);
+    }
+
+    if (cma_sleep_request_register("user_sensor", user_sensor_wake_handler, NULL,
+            &user_sensor_req) == CMA_STATUS_FAIL) {
+        configASSERT(0);
+    }
+
+    if (cma_sleep_request_register("user_report", user_report_wake_handler, NULL,
+            &user_report_req) == CMA_STATUS_FAIL) {
+        configASSERT(0);
+    }
+}
+
+static void user_sleep_profile_done(void)
+{
+    /* Only the first call after boot is kept */
+    cma_profile_save();
+
+    if (debug_level >= LOG_DBG) {
+        cma_profile_print();
+    }
+}
+
+static void user_sleep_requests_start(void)
+{
+    /* Deadlines kept from previous sleep 3 are not changed */
+    if (cma_sleep_request_next() == CMA_SLEEP_REQUEST_NONE) {
+        cma_sleep_request_set(user_sensor_req, cma_sleep_adapt_interval());
+        cma_sleep_request_set(user_report_req, USER_REPORT_PERIOD);
+    }
+
+    cma_sleep_request_dispatch();
+    user_sleep_profile_done();
+    cma_sleep_request_sleep(CMA_SLEEP_TYPE_AUTO);
+}
+
 static void user_sleep3_int_handler(void *param)
 {
     DA16X_UNUSED_ARG(param);
 
+    cma_sleep_adapt_event();
+
     if (xTask) {
         OS_TASK_NOTIFY_FROM_ISR(xTask, USER_SLEEP3_INT, OS_NOTIFY_SET_BITS);
     }
@@ -74,12 +165,14 @@ static void user_sleep2_int_handler(void *param)
 {
     DA16X_UNUSED_ARG(param);
 
+    cma_sleep_adapt_event();
+
     if (xTask) {
         OS_TASK_NOTIFY_FROM_ISR(xTask, USER_SLEEP2_INT, OS_NOTIFY_SET_BITS);
     }
 }
 
-static void user_gpio_sets_interrupt(void)
+static void user_gpio_setup(void)
 {
     if (cma_gpio_set_func(USER_SLEEP2_GPIO_FUNC_PIN) == CMA_STATUS_FAIL) {
         configASSERT(0);
@@ -108,18 +201,59 @@ static void user_gpio_sets_interrupt(void)
     }
 }
 
+static void user_gpio_sets_interrupt(void)
+{
+    uint32_t start = cma_sleep_resume_begin();
+    uint8_t resumed = 0;
+
+    if (cma_rtm_data_alloc_and_read((uint8_t *)USER_GPIO_CACHE_TAG, (uint8_t **)&user_gpio_cache,
+            sizeof(struct user_gpio_cache_t)) != CMA_STATUS_OK) {
+        user_gpio_cache = NULL;
+    }
+
+    /* Configuration of previous boot is applied in one pass per port */
+    if (user_gpio_cache && user_gpio_cache->magic == USER_GPIO_CACHE_MAGIC && cma_sleep_is_resume()
+        && cma_gpio_apply_config(&user_gpio_cache->config) == CMA_STATUS_OK) {
+        resumed = 1;
+    } else {
+        user_gpio_setup();
+
+        if (user_gpio_cache && cma_gpio_get_config(&user_gpio_cache->config) == CMA_STATUS_OK) {
+            user_gpio_cache->magic = USER_GPIO_CACHE_MAGIC;
+        }
+    }
+
+    cma_sleep_resume_end("gpio", start, resumed);
+}
+
 static void user_sleep_task(void *arg)
 {
     DA16X_UNUSED_ARG(arg);
     int8_t wdog_id;
     BaseType_t ret __attribute__((unused));
     uint32_t notif;
+    uint8_t first_event = 1;
+
+    cma_profile_mark(CMA_PROFILE_TASK_START);
 
     LOG(LOG_INFO, "Start User interrupt process task!");
     /* Register user_sleep_task to be monitored by watchdog */
     wdog_id = da16x_sys_watchdog_register(pdFALSE);
 
     user_gpio_sets_interrupt();
+    cma_sleep_boot_done();
+
+    if (debug_level >= LOG_DBG) {
+        cma_sleep_account_print();
+        cma_sleep_wake_print();
+        cma_sleep_resume_print();
+        cma_backoff_print();
+    }
+
+    /* Woken up by a wake request : serve it and sleep until the next one */
+    if (cma_sleep_request_dispatch() > 0) {
+        user_sleep_requests_start();
+    }
 
     for (;;) {
         /* Notify watchdog on each loop */
@@ -137,6 +271,12 @@ static void user_sleep_task(void *arg)
          */
         configASSERT(ret == pdTRUE);
 
+        if (first_event) {
+            cma_profile_mark(CMA_PROFILE_FIRST_EVENT);
+            user_sleep_profile_done();
+            first_event = 0;
+        }
+
         LOG(LOG_DBG, ">>> notify: 0x%X\n", notif);
 
         /* Resume watchdog */
@@ -144,11 +284,11 @@ static void user_sleep_task(void *arg)
 
 
         if (notif & USER_SLEEP2_INT) {
-        	cma_sleep_trigger(CMA_SLEEP_TYPE_2, USER_SLEEP_TIME);
+        	cma_sleep_trigger(CMA_SLEEP_TYPE_2, cma_sleep_adapt_next());
         }
 
         if (notif & USER_SLEEP3_INT) {
-        	cma_sleep_trigger(CMA_SLEEP_TYPE_3, USER_SLEEP_TIME);
+        	user_sleep_requests_start();
         }
     }
 }
@@ -156,11 +296,14 @@ static void user_sleep_task(void *arg)
 void user_sleep_init(void)
 {
 	cma_sleep_init();
+	user_sleep_requests_init();
 
     if (xTask != NULL) {
         configASSERT(0);
     }
 
+    cma_profile_mark(CMA_PROFILE_TASK_CREATE);
+
     if (pdPASS
         != OS_TASK_CREATE(USER_SLEEP_TASK_NAME, user_sleep_task, NULL, USER_SLEEP_TASK_STACK_SZ,
             USER_SLEEP_TASK_PRI, xTask)) {
@@ -0,0 +1,147 @@
+/**
+ ****************************************************************************************
+ *
+ * @file user_sleep_sim.c
+ *
+ * @brief Wake path of sleep app on the host simulation of DPM
+ *
+ * Copyright (c) 2016-2024 Renesas Electronics. All rights reserved.
+ *
+ * This software ("Software") is owned by Renesas Electronics.
+ *
+ * By using this Software you agree that Renesas Electronics retains all
+ * intellectual property and proprietary rights in and to this Software and any
+ * use, reproduction, disclosure or distribution of the Software without express
+ * written permission or a license agreement from Renesas Electronics is
+ * strictly prohibited. This Software is solely for use on or in conjunction
+ * with Renesas Electronics products.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE
+ * SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. EXCEPT AS OTHERWISE
+ * PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * RENESAS ELECTRONICS BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL,
+ * OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ *
+ ****************************************************************************************
+ */
+
+#if defined(CMA_SLEEP_SIM)
+
+#include <time.h>
+#include "cma_debug.h"
+#include "cma_rtm_data.h"
+#include "cma_sleep.h"
+#include "cma_sleep_sim.h"
+
+/* Same wake requests as user_sleep.c */
+#define USER_SLEEP_TIME_MIN         (10000)
+#define USER_SLEEP_TIME_MAX         (160000)
+#define USER_REPORT_PERIOD          (30000)
+
+#define USER_SIM_CYCLES_DEFAULT     10000
+
+/* One boot in USER_SIM_BUTTON_RATE is followed by a button press during sleep */
+#define USER_SIM_BUTTON_RATE        8
+
+static uint32_t user_sensor_req;
+static uint32_t user_report_req;
+static uint8_t user_sim_report;
+
+static void user_sensor_wake_handler(void *param)
+{
+    DA16X_UNUSED_ARG(param);
+
+    cma_sleep_request_set(user_sensor_req, cma_sleep_adapt_next());
+}
+
+static void user_report_wake_handler(void *param)
+{
+    DA16X_UNUSED_ARG(param);
+
+    cma_sleep_request_set(user_report_req, USER_REPORT_PERIOD);
+}
+
+/* Called at each boot like user_app_entry(), ends with power down */
+static void user_sleep_sim_entry(void)
+{
+    uint32_t rtc = (uint32_t)RTC_GET_COUNTER();
+
+    cma_sleep_init();
+
+    if (cma_rtm_data_init() == CMA_STATUS_FAIL) {
+        configASSERT(0);
+    }
+
+    if (cma_sleep_adapt_init(USER_SLEEP_TIME_MIN, USER_SLEEP_TIME_MAX, 0) == CMA_STATUS_FAIL) {
+        configASSERT(0);
+    }
+
+    if (cma_sleep_request_register("user_sensor", user_sensor_wake_handler, NULL,
+            &user_sensor_req) == CMA_STATUS_FAIL) {
+        configASSERT(0);
+    }
+
+    if (cma_sleep_request_register("user_report", user_report_wake_handler, NULL,
+            &user_report_req) == CMA_STATUS_FAIL) {
+        configASSERT(0);
+    }
+
+    cma_sleep_set_retention(1);
+    cma_sleep_boot_done();
+
+    if (user_sim_report) {
+        cma_sleep_account_print();
+        cma_sleep_wake_print();
+    }
+
+    if (cma_sleep_request_next() == CMA_SLEEP_REQUEST_NONE) {
+        cma_sleep_request_set(user_sensor_req, cma_sleep_adapt_interval());
+        cma_sleep_request_set(user_report_req, USER_REPORT_PERIOD);
+    }
+
+    cma_sleep_request_dispatch();
+
+    if (((rtc >> 5) % USER_SIM_BUTTON_RATE) == 0) {
+        cma_sleep_sim_set_wakeup(WAKEUP_SOURCE_EXT_SIGNAL, 1 + (rtc % USER_SLEEP_TIME_MIN));
+    }
+
+    cma_sleep_request_sleep(CMA_SLEEP_TYPE_AUTO);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t cycles = USER_SIM_CYCLES_DEFAULT, done;
+    struct timespec start, end;
+    double sec;
+
+    if (argc > 1) {
+        cycles = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+
+    if (cycles == 0) {
+        return 1;
+    }
+
+    cma_sleep_sim_reset();
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    done = cma_sleep_sim_run(user_sleep_sim_entry, cycles - 1);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    /* Last boot prints records kept in retention memory */
+    user_sim_report = 1;
+    done += cma_sleep_sim_run(user_sleep_sim_entry, 1);
+
+    sec = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    PRINTF("%u sleep cycles in %.2f s (%.0f cycles/s)\n", done, sec, done / sec);
+    cma_sleep_sim_print();
+
+    return (done == cycles) ? 0 : 1;
+}
+
+#endif /* CMA_SLEEP_SIM */
@@ -50,6 +50,8 @@
 #endif // __SET_BOR_CIRCUIT__
 
 #include "user_app_entry.h"
+#include "cma_backoff.h"
+#include "cma_profile.h"
 
 /*
  * Config customer's console baud-rate.
@@ -267,22 +269,16 @@ static void config_user_wu_hw_resource(void)
  *         3600 * 24
  *     }
  */
-unsigned long long _user_defined_wakeup_interval[DPM_MON_RETRY_CNT] = {
-    ULLONG_MAX,            // Initial value : ULLONG_MAX
-    60,                    // 1st Wakeup
-    60,                    // 2nd Wakeup    : 0xdeadbeaf for no-wakeup
-    60,                    // 3rd Wakeup    : 0xdeadbeaf for no-wakeup
-    60 * 30,               // 4th Wakeup    : 0xdeadbeaf for no-wakeup
-    60 * 30,               // 5th Wakeup    : 0xdeadbeaf for no-wakeup
-    60 * 30,               // 6th Wakeup    : 0xdeadbeaf for no-wakeup
-    60 * 60,               // 7th Wakeup    : 0xdeadbeaf for no-wakeup
-    60 * 60,               // 8th Wakeup    : 0xdeadbeaf for no-wakeup
-    0xDEADBEAF             // 9th Wakeup    : 0xdeadbeaf for no-wakeup
-};
+unsigned long long _user_defined_wakeup_interval[DPM_MON_RETRY_CNT];
 
+/*
+ * Intervals are computed by cma_backoff : exponential backoff from CMA_BACKOFF_BASE with
+ * per-device jitter, longer while reconnections fail (cma_backoff_report).
+ */
 static void set_dpm_abnorm_user_wakeup_interval(void)
 {
 #if defined ( __USER_DPM_ABNORM_WU_INTERVAL__ )
+    cma_backoff_fill(_user_defined_wakeup_interval, DPM_MON_RETRY_CNT);
     dpm_abnorm_user_wakeup_interval = (unsigned long long *)_user_defined_wakeup_interval;
 #endif // __USER_DPM_ABNORM_WU_INTERVAL__
 }
@@ -498,13 +494,17 @@ static void set_user_dpm_data_rcv_ready_timeout(void)
 
 void system_start(void)
 {
+    cma_profile_mark(CMA_PROFILE_SYSTEM_START);
+
 #if defined ( __SUPPORT_USER_DPM_RCV_READY_TO__ )
     /* Set user DPM register timeout value */
     set_user_dpm_data_rcv_ready_timeout();
 #endif // __SUPPORT_USER_DPM_RCV_READY_TO__
 
     /* Config HW wakeup resource */
+    cma_profile_mark(CMA_PROFILE_WU_HW_RESOURCE);
     config_user_wu_hw_resource();
+    cma_profile_mark(CMA_PROFILE_SYSTEM_INIT);
 
 #if 0 // Interrupt way is better. This polling method should be deprecated
     /* Create gpio handler event */
@@ -561,6 +561,7 @@ void system_start(void)
 
     da16x_sys_watchdog_notify(da16x_sys_wdog_id_get_system_launcher());
 
+    cma_profile_mark(CMA_PROFILE_APP_ENTRY);
     user_app_entry();
 
     /* Start system applications for DA16XXX */
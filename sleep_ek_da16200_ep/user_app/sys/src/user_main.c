@@ -37,6 +37,7 @@
 #include "common_def.h"
 #include "sys_specific.h"
 #include "user_main.h"
+#include "cma_profile.h"
 
 #ifdef __SUPPORT_NAT__
 #include "common_config.h"
@@ -119,6 +120,8 @@ int user_main(char init_state)
 {
     int	status = 0;
 
+    cma_profile_mark(CMA_PROFILE_USER_MAIN);
+
     /*
      * 1. Restore saved GPIO PINs
      * 2. RTC PAD connection
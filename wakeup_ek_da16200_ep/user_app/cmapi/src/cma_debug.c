@@ -42,6 +42,42 @@
 #define CMA_HEAP_CHECK_PERIOD_MS    1000 // 1 sec
 #define CMA_HEAP_REPORT_PERIOD_SEC  ((5 * CMA_HEAP_CHECK_PERIOD_MS) / 1000) // 10 times of CMA_HEAP_CHECK_PERIOD_MS
 
+struct cma_wakeup_reason_t
+{
+    uint8_t reason;
+    uint8_t cls;
+    const char *name;
+};
+
+/* Codes of da16x_boot_get_wakeupmode, _WITH_RETENTION codes are wake-ups from sleep 3 */
+static const struct cma_wakeup_reason_t cma_wakeup_reason_table[] =
+{
+    { WAKEUP_RESET, CMA_WAKEUP_CLASS_RESET, "reset" },
+    { WAKEUP_SOURCE_EXT_SIGNAL, CMA_WAKEUP_CLASS_EXTERNAL, "external signal" },
+    { WAKEUP_EXT_SIG_WAKEUP_COUNTER, CMA_WAKEUP_CLASS_EXTERNAL, "external signal and RTC timer" },
+    { WAKEUP_SOURCE_WAKEUP_COUNTER, CMA_WAKEUP_CLASS_TIMER, "RTC timer or external signal from sleep2" },
+    { WAKEUP_SOURCE_POR, CMA_WAKEUP_CLASS_POWER_ON, "RTC_PWR_KEY from power off" },
+    { WAKEUP_SOURCE_POR_EXT_SIGNAL, CMA_WAKEUP_CLASS_POWER_ON, "RTC_PWR_KEY and external signal from power off" },
+    { WAKEUP_WATCHDOG, CMA_WAKEUP_CLASS_WATCHDOG, "watchdog" },
+    { WAKEUP_WATCHDOG_EXT_SIGNAL, CMA_WAKEUP_CLASS_WATCHDOG, "watchdog and external signal" },
+    { WAKEUP_SENSOR, CMA_WAKEUP_CLASS_SENSOR, "sensor" },
+    { WAKEUP_SENSOR_EXT_SIGNAL, CMA_WAKEUP_CLASS_SENSOR, "sensor and external signal" },
+    { WAKEUP_SENSOR_WAKEUP_COUNTER, CMA_WAKEUP_CLASS_SENSOR, "sensor and RTC timer" },
+    { WAKEUP_SENSOR_EXT_WAKEUP_COUNTER, CMA_WAKEUP_CLASS_SENSOR, "sensor, external signal and RTC timer" },
+    { WAKEUP_SENSOR_WATCHDOG, CMA_WAKEUP_CLASS_WATCHDOG, "sensor and watchdog" },
+    { WAKEUP_SENSOR_EXT_WATCHDOG, CMA_WAKEUP_CLASS_WATCHDOG, "sensor, external signal and watchdog" },
+    { WAKEUP_RESET_WITH_RETENTION, CMA_WAKEUP_CLASS_RESET, "reset from sleep3" },
+    { WAKEUP_COUNTER_WITH_RETENTION, CMA_WAKEUP_CLASS_TIMER, "RTC timer from sleep3" },
+    { WAKEUP_EXT_SIG_WAKEUP_COUNTER_WITH_RETENTION, CMA_WAKEUP_CLASS_EXTERNAL, "EXT KEY from sleep3" },
+    { WAKEUP_WATCHDOG_WITH_RETENTION, CMA_WAKEUP_CLASS_WATCHDOG, "watchdog from sleep3" },
+    { WAKEUP_WATCHDOG_EXT_SIGNAL_WITH_RETENTION, CMA_WAKEUP_CLASS_WATCHDOG, "watchdog and external signal from sleep3" },
+    { WAKEUP_SENSOR_WAKEUP_COUNTER_WITH_RETENTION, CMA_WAKEUP_CLASS_SENSOR, "sensor and RTC timer from sleep3" },
+    { WAKEUP_SENSOR_WATCHDOG_WITH_RETENTION, CMA_WAKEUP_CLASS_WATCHDOG, "sensor and watchdog from sleep3" },
+    { WAKEUP_SENSOR_EXT_WATCHDOG_WITH_RETENTION, CMA_WAKEUP_CLASS_WATCHDOG,
+      "sensor, external signal and watchdog from sleep3" },
+    { WAKEUP_SOURCE_UNKNOWN, CMA_WAKEUP_CLASS_UNKNOWN, "unknown" },
+};
+
 static OS_TIMER cma_heap_check_timer = NULL;
 static uint32_t cma_pre_lowest_heap;
 static uint32_t cma_heap_down_number;
@@ -144,53 +180,40 @@ void cma_printout_wakeup_reason(void)
 
     reason = da16x_boot_get_wakeupmode();
 
-    LOG(LOG_DBG, "Wakeup reason is 0x%x.", reason);
-    switch (reason) {
-        case WAKEUP_SOURCE_POR: //0x04 //Confirmed
-            LOG(LOG_DBG, "Wakeup reason is RTC_PWR_KEY from Power off.");
-            break;
-        case WAKEUP_COUNTER_WITH_RETENTION: //0x82 //Confirmed
-            LOG(LOG_DBG, "Wakeup reason is RTC timer from sleep3.");
-            break;
-
-        case WAKEUP_EXT_SIG_WAKEUP_COUNTER_WITH_RETENTION: //0x83 RTC_WAKEUP_KEY from slee3 confirmed.
-            LOG(LOG_DBG, "Wakeup reason is EXT KEY from sleep3.");
-            break;
-
-        case WAKEUP_RESET: //0x00
-            LOG(LOG_DBG, "Wakeup reason is RESET.");
-            break;
-        case WAKEUP_SENSOR_WAKEUP_COUNTER_WITH_RETENTION: //0x92
-            LOG(LOG_DBG, "Wakeup reason is RTC timer from sleep3.");
-            break;
-        case WAKEUP_SOURCE_EXT_SIGNAL: //0x01
-            LOG(LOG_DBG, "Wakeup reason is External siganl.");
-            break;
-        case WAKEUP_SOURCE_WAKEUP_COUNTER: //0x02
-            LOG(LOG_DBG, "Wakeup reason is RTC or external signal from Sleep2.");
-            break;
-
-        case WAKEUP_SOURCE_POR_EXT_SIGNAL: //0x05
-            LOG(LOG_DBG, "Wakeup reason is RTC_PWR_KEY from Power off.");
-            break;
-        case WAKEUP_WATCHDOG: //0x08
-            LOG(LOG_DBG, "Wakeup reason is Watchdog.");
-            break;
-        case WAKEUP_WATCHDOG_EXT_SIGNAL: //0x09
-        case WAKEUP_SENSOR_WATCHDOG: //0x24
-        case WAKEUP_SENSOR_EXT_WATCHDOG: //0x25
-        case WAKEUP_WATCHDOG_WITH_RETENTION: //0x88
-        case WAKEUP_WATCHDOG_EXT_SIGNAL_WITH_RETENTION: //0x90
-        case WAKEUP_SENSOR_WATCHDOG_WITH_RETENTION: //0x98
-        case WAKEUP_SENSOR_EXT_WATCHDOG_WITH_RETENTION: //0x99
-        case WAKEUP_RESET_WITH_RETENTION: //0x80
-        case WAKEUP_SOURCE_UNKNOWN: //0xff
-        case WAKEUP_SENSOR: //0x10
-        case WAKEUP_SENSOR_EXT_SIGNAL: //0x11
-        case WAKEUP_SENSOR_WAKEUP_COUNTER: //0x12
-        case WAKEUP_SENSOR_EXT_WAKEUP_COUNTER: //0x13
-            break;
-        default:
-            break;
+    LOG(LOG_DBG, "Wakeup reason is 0x%x, %s (%s).", reason, cma_wakeup_reason_name(reason),
+        cma_wakeup_class_name(cma_wakeup_reason_class(reason)));
+}
+
+static const struct cma_wakeup_reason_t *cmai_wakeup_reason_find(uint32_t reason)
+{
+    for (uint32_t i = 0; i < sizeof(cma_wakeup_reason_table) / sizeof(cma_wakeup_reason_table[0]); i++) {
+        if (cma_wakeup_reason_table[i].reason == reason)
+            return &cma_wakeup_reason_table[i];
     }
+
+    return NULL;
+}
+
+const char* cma_wakeup_reason_name(uint32_t reason)
+{
+    const struct cma_wakeup_reason_t *entry = cmai_wakeup_reason_find(reason);
+
+    return (entry != NULL) ? entry->name : "unknown";
+}
+
+CMA_WAKEUP_CLASS cma_wakeup_reason_class(uint32_t reason)
+{
+    const struct cma_wakeup_reason_t *entry = cmai_wakeup_reason_find(reason);
+
+    return (entry != NULL) ? (CMA_WAKEUP_CLASS)entry->cls : CMA_WAKEUP_CLASS_UNKNOWN;
+}
+
+const char* cma_wakeup_class_name(CMA_WAKEUP_CLASS cls)
+{
+    static const char *const names[] = { "power on", "reset", "timer", "external", "sensor", "watchdog", "unknown" };
+
+    if ((uint32_t)cls > CMA_WAKEUP_CLASS_UNKNOWN)
+        cls = CMA_WAKEUP_CLASS_UNKNOWN;
+
+    return names[cls];
 }